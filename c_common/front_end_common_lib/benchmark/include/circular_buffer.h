@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Host stand-in for the spinn_common circular buffer of words.
+#ifndef _CIRCULAR_BUFFER_H_
+#define _CIRCULAR_BUFFER_H_
+
+#include <common-typedefs.h>
+
+//! The buffer; the size is a power of two so indices wrap with a mask
+typedef struct _circular_buffer {
+    //! One less than the number of words the buffer holds
+    uint32_t buffer_size;
+    //! Where the next word is read from
+    uint32_t output;
+    //! Where the next word is written to
+    uint32_t input;
+    //! Number of words that could not be added
+    uint32_t overflows;
+    //! The words
+    uint32_t buffer[];
+} _circular_buffer, *circular_buffer;
+
+//! \brief Make a buffer
+//! \param[in] size: The number of words needed; rounded up to a power of two
+//! \return The buffer, or `NULL` if there is no memory for it
+circular_buffer circular_buffer_initialize(uint32_t size);
+
+//! \brief Get how many words are in a buffer
+//! \param[in] buffer: The buffer
+//! \return The number of words
+static inline uint32_t circular_buffer_size(circular_buffer buffer) {
+    return (buffer->input - buffer->output) & buffer->buffer_size;
+}
+
+//! \brief Add a word to a buffer
+//! \param[in] buffer: The buffer
+//! \param[in] item: The word to add
+//! \return Whether there was space for it
+static inline bool circular_buffer_add(circular_buffer buffer, uint32_t item) {
+    uint32_t next = (buffer->input + 1) & buffer->buffer_size;
+    if (next == buffer->output) {
+        buffer->overflows++;
+        return false;
+    }
+    buffer->buffer[buffer->input] = item;
+    buffer->input = next;
+    return true;
+}
+
+//! \brief Take the oldest word from a buffer
+//! \param[in] buffer: The buffer
+//! \param[out] item: Where to put the word
+//! \return Whether there was a word to take
+static inline bool circular_buffer_get_next(
+        circular_buffer buffer, uint32_t *item) {
+    if (buffer->input == buffer->output) {
+        return false;
+    }
+    *item = buffer->buffer[buffer->output];
+    buffer->output = (buffer->output + 1) & buffer->buffer_size;
+    return true;
+}
+
+#endif  // _CIRCULAR_BUFFER_H_
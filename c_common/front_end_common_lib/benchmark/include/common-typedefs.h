@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \dir
+//! \brief Host stand-ins for the SpiNNaker headers used by the recording
+//!     library
+//! \file
+//! \brief Host stand-in for common-typedefs.h without the ARM fixed point
+//!     types, which x86 compilers do not provide.
+//! \details The C library of the host has a timer_t of its own, which is a
+//!     pointer. The SpiNNaker one is defined here first and the guard of the
+//!     C library is set, so that recording_do_timestep_update() takes the
+//!     same argument as on chip; include this before any header of the C
+//!     library.
+#ifndef __COMMON_TYPEDEFS_H__
+#define __COMMON_TYPEDEFS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef use
+//! \brief Mark a variable as used
+//! \param[in] x: The variable
+#define use(x) do {} while ((x)!=(x))
+#endif
+
+//! An index into an array
+typedef uint32_t index_t;
+//! A count of something
+typedef uint32_t counter_t;
+//! A pointer to a word
+typedef uint32_t* address_t;
+
+#ifndef __timer_t_defined
+//! Stops the C library defining its own timer_t
+#define __timer_t_defined 1
+//! A time in timer ticks
+typedef uint32_t timer_t;
+#endif
+
+#endif  // __COMMON_TYPEDEFS_H__
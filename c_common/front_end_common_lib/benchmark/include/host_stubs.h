@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Controls for the host stand-ins of the SpiNNaker runtime.
+//! \details These let the benchmark play the parts of the DMA engine and of
+//!     the host: DMA transfers wait until they are completed here, SDP
+//!     messages the core sends are kept until taken here, and messages from
+//!     the host are delivered to the callback registered for their port.
+#ifndef __HOST_STUBS_H__
+#define __HOST_STUBS_H__
+
+#include <sark.h>
+
+//! Most SDP messages kept before spin1_send_sdp_msg() fails
+#define HOST_SDP_QUEUE_SIZE     16
+
+//! \brief Set the time spin1_get_simulation_time() returns
+//! \param[in] time: The simulation time
+void host_stubs_set_time(uint time);
+
+//! \brief Get the number of DMA transfers queued but not yet done
+//! \return The number of transfers waiting
+uint host_stubs_dma_pending(void);
+
+//! \brief Do the oldest DMA transfers and call their callbacks
+//! \param[in] n_transfers: The most transfers to do
+//! \return The number of transfers done
+uint host_stubs_dma_complete(uint n_transfers);
+
+//! \brief Get the number of DMA transfers done since the last reset
+//! \return The number of transfers
+uint host_stubs_dma_transfers(void);
+
+//! \brief Get the number of times the core waited for an interrupt
+//! \return The number of calls to spin1_wfi() since the last reset
+uint host_stubs_wfi_count(void);
+
+//! \brief Take the oldest SDP message the core sent
+//! \param[out] msg: Where to copy the message
+//! \return Whether there was a message
+bool host_stubs_sdp_take(sdp_msg_t *msg);
+
+//! \brief Deliver an SDP message from the host to the core
+//! \param[in] port: The SDP port it goes to
+//! \param[in] data: What goes in the message from cmd_rc onwards
+//! \param[in] length: The length of the data in bytes
+//! \return Whether a callback was registered for the port
+bool host_stubs_sdp_deliver(uint port, const void *data, uint length);
+
+//! \brief Free all the SDRAM allocated and forget the callbacks, messages and
+//!     transfers, ready for another run
+void host_stubs_reset(void);
+
+#endif  // __HOST_STUBS_H__
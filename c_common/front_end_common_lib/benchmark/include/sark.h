@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Host stand-in for the parts of SARK used by the recording library.
+//! \details recording.c keeps SDRAM addresses in 32-bit words, as they are
+//!     on chip, so host_stubs.c hands out SDRAM and SDP messages from the
+//!     lowest 4GB of the address space, and the benchmark is linked so that
+//!     its code is there too.
+#ifndef __SARK_H__
+#define __SARK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+//! Unsigned integer, as SARK spells it
+typedef unsigned int uint;
+//! Unsigned short, as SARK spells it
+typedef unsigned short ushort;
+//! Unsigned byte, as SARK spells it
+typedef unsigned char uchar;
+
+//! Software error code for rt_error()
+#define RTE_SWERR       6
+//! Flag to sark_xalloc() to lock the heap
+#define ALLOC_LOCK      1
+//! Flag to sark_xalloc() to tag the block with an ID
+#define ALLOC_ID        2
+
+//! Opaque heap; the allocator in host_stubs.c does not need its layout
+typedef struct heap_t heap_t;
+
+//! The subset of the system variables the recording library touches
+typedef struct sv_t {
+    heap_t *sdram_heap;     //!< The shared SDRAM heap
+} sv_t;
+
+//! The system variables
+extern sv_t *sv;
+
+//! The subset of the SARK vectors the recording library touches
+typedef struct sark_vec_t {
+    uchar app_id;           //!< The ID of the running application
+} sark_vec_t;
+
+//! The SARK vectors
+extern sark_vec_t *sark_vec;
+
+//! An SDP message, laid out as on chip
+typedef struct sdp_msg {
+    struct sdp_msg *next;   //!< Next in free list
+    ushort length;          //!< Length of the message after the checksum
+    ushort checksum;        //!< Checksum (if used)
+    uchar flags;            //!< Flag byte
+    uchar tag;              //!< IP tag
+    uchar dest_port;        //!< Destination port/CPU
+    uchar srce_port;        //!< Source port/CPU
+    ushort dest_addr;       //!< Destination address
+    ushort srce_addr;       //!< Source address
+    ushort cmd_rc;          //!< Command/Return code
+    ushort seq;             //!< Sequence number
+    uint arg1;              //!< Argument 1
+    uint arg2;              //!< Argument 2
+    uint arg3;              //!< Argument 3
+    uchar data[256];        //!< User data (256 bytes)
+    uint __PAD1;            //!< Private padding
+} sdp_msg_t;
+
+//! \brief Allocate a block from a SARK heap
+//! \param[in] heap: The heap; ignored, SDRAM is allocated on the host
+//! \param[in] size: The size of the block in bytes
+//! \param[in] tag: The tag of the block; ignored
+//! \param[in] flag: Locking and ID flags; ignored
+//! \return The block, or `NULL` if there is no memory
+void *sark_xalloc(heap_t *heap, uint size, uint tag, uint flag);
+
+//! \brief Stop with a runtime error; the benchmark exits with it
+//! \param[in] code: The error code
+void rt_error(uint code, ...) __attribute__((noreturn));
+
+#endif  // __SARK_H__
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Host stand-in for the parts of simulation.h used by the recording
+//!     library.
+//! \details The callbacks registered are those host_stubs.c calls when a
+//!     simulated DMA completes or an SDP message is delivered.
+#ifndef _SIMULATION_H_
+#define _SIMULATION_H_
+
+#include <common-typedefs.h>
+#include <spin1_api.h>
+
+//! \brief Register a callback for SDP messages on a port
+//! \param[in] sdp_port: The SDP port
+//! \param[in] sdp_callback: What to call with each message
+//! \return Whether the callback was registered
+bool simulation_sdp_callback_on(uint sdp_port, callback_t sdp_callback);
+
+//! \brief Register a callback for completed DMA transfers with a tag
+//! \param[in] tag: The DMA tag
+//! \param[in] callback: What to call as each transfer completes
+//! \return Whether the callback was registered
+bool simulation_dma_transfer_done_callback_on(uint tag, callback_t callback);
+
+#endif  // _SIMULATION_H_
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Host stand-in for the parts of spin1_api used by the recording
+//!     library.
+//! \details DMA transfers are queued and only happen when host_stubs.c is
+//!     told to complete them, or when the core waits for an interrupt, so
+//!     that the source of a transfer has to stay untouched until it is done,
+//!     as on chip.
+#ifndef __SPIN1_API_H__
+#define __SPIN1_API_H__
+
+#include <string.h>
+#include <sark.h>
+
+//! A callback as spin1_api calls it, with two arguments
+typedef void (*callback_t)(uint, uint);
+
+//! Copy memory; the core does it itself, so at once
+#define spin1_memcpy    memcpy
+
+//! \brief Allocate memory in DTCM
+//! \param[in] bytes: The size of the block
+//! \return The block, or `NULL` if there is no memory
+void *spin1_malloc(uint bytes);
+
+//! \brief Queue a DMA transfer
+//! \param[in] tag: The tag given to the callback when it completes
+//! \param[in] system_address: The address in SDRAM
+//! \param[in] tcm_address: The address in DTCM
+//! \param[in] direction: ::DMA_READ or ::DMA_WRITE
+//! \param[in] length: The number of bytes to transfer
+//! \return The ID of the transfer, or 0 if the queue is full
+uint spin1_dma_transfer(
+        uint tag, void *system_address, void *tcm_address, uint direction,
+        uint length);
+
+//! \brief Wait for an interrupt; on the host the oldest DMA transfer is
+//!     completed, as its interrupt would be the next to come
+void spin1_wfi(void);
+
+//! \brief Send an SDP message; on the host it is kept for the benchmark
+//! \param[in] msg: The message
+//! \param[in] timeout: Ignored
+//! \return 1 if the message was kept, 0 if too many are waiting
+uint spin1_send_sdp_msg(sdp_msg_t *msg, uint timeout);
+
+//! \brief Free an SDP message that was delivered to the core
+//! \param[in] msg: The message
+void spin1_msg_free(sdp_msg_t *msg);
+
+//! \brief Get the current simulation time
+//! \return The time set by host_stubs_set_time()
+uint spin1_get_simulation_time(void);
+
+//! \brief Get the ID of the core running the code
+//! \return Always core 1 on the host
+static inline uint spin1_get_core_id(void) {
+    return 1;
+}
+
+//! \brief Get the ID of the chip running the code
+//! \return Always chip (0, 0) on the host
+static inline uint spin1_get_chip_id(void) {
+    return 0;
+}
+
+#endif  // __SPIN1_API_H__
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Host stand-in for the spin1_api_params.h constants used by the
+//!     recording library.
+#ifndef __SPIN1_API_PARAMS_H__
+#define __SPIN1_API_PARAMS_H__
+
+//! Number of transfers the DMA queue holds
+#define DMA_QUEUE_SIZE  16
+
+//! DMA direction from SDRAM into DTCM
+#define DMA_READ        0
+//! DMA direction from DTCM out to SDRAM
+#define DMA_WRITE       1
+
+#endif  // __SPIN1_API_PARAMS_H__
@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Host implementations of the SARK, spin1_api and simulation
+//!     functions that the recording library calls.
+#define _GNU_SOURCE
+#include <common-typedefs.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <debug.h>
+#include <spin1_api.h>
+#include <spin1_api_params.h>
+#include <circular_buffer.h>
+#include <simulation.h>
+#include <host_stubs.h>
+
+//! Number of SDP ports
+#define N_SDP_PORTS             8
+
+//! Number of DMA tags that can have a callback
+#define N_DMA_TAGS              16
+
+//! \brief Header of a block of low memory, so that it can be freed on reset.
+//! \details Everything the recording library allocates comes from low
+//!     memory, so that a reset frees it all.
+typedef union low_block_t {
+    struct {
+        //! The block allocated before this one
+        union low_block_t *next;
+        //! The size of the whole block, including this header
+        size_t size;
+    };
+    //! Keeps the user part aligned as malloc would
+    long double align;
+} low_block_t;
+
+//! A DMA transfer waiting to be done
+typedef struct dma_transfer_t {
+    uint id;                //!< The ID returned for the transfer
+    uint tag;               //!< The tag given to the callback
+    void *system_address;   //!< The address in SDRAM
+    void *tcm_address;      //!< The address in DTCM
+    uint direction;         //!< ::DMA_READ or ::DMA_WRITE
+    uint length;            //!< The number of bytes
+} dma_transfer_t;
+
+//! The low memory blocks allocated, newest first
+static low_block_t *low_blocks = NULL;
+
+//! The simulation time
+static uint simulation_time = 0;
+
+//! The DMA transfers waiting, oldest at ::dma_first
+static dma_transfer_t dma_queue[DMA_QUEUE_SIZE];
+
+//! Index of the oldest waiting DMA transfer
+static uint dma_first = 0;
+
+//! Number of waiting DMA transfers
+static uint dma_n_pending = 0;
+
+//! The ID of the last DMA transfer queued
+static uint dma_last_id = 0;
+
+//! Number of DMA transfers done
+static uint dma_n_done = 0;
+
+//! Number of calls to spin1_wfi()
+static uint wfi_count = 0;
+
+//! What to call when a DMA transfer with each tag completes
+static callback_t dma_callbacks[N_DMA_TAGS];
+
+//! What to call when an SDP message arrives on each port
+static callback_t sdp_callbacks[N_SDP_PORTS];
+
+//! The SDP messages sent by the core and not yet taken, oldest at ::sdp_first
+static sdp_msg_t sdp_queue[HOST_SDP_QUEUE_SIZE];
+
+//! Index of the oldest SDP message sent
+static uint sdp_first = 0;
+
+//! Number of SDP messages sent and not yet taken
+static uint sdp_n_sent = 0;
+
+//! The message delivered to the core; in low memory, as the mailbox is a word
+static sdp_msg_t *sdp_mailbox = NULL;
+
+//! Whether the core has yet to free the message delivered to it
+static bool sdp_mailbox_busy = false;
+
+//! No SDRAM heap exists on the host; sark_xalloc() ignores the heap argument
+static sv_t host_sv = {NULL};
+
+sv_t *sv = &host_sv;
+
+//! The vectors, for the app ID
+static sark_vec_t host_sark_vec = {16};
+
+sark_vec_t *sark_vec = &host_sark_vec;
+
+//! \brief Allocate memory whose address fits in a word
+//! \param[in] size: The number of bytes wanted
+//! \return The memory, zeroed, or `NULL` if there is none
+static void *low_alloc(size_t size) {
+    size_t total = sizeof(low_block_t) + size;
+    low_block_t *block = mmap(
+            NULL, total, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (block == MAP_FAILED) {
+        return NULL;
+    }
+    block->next = low_blocks;
+    block->size = total;
+    low_blocks = block;
+    return &block[1];
+}
+
+void *sark_xalloc(heap_t *heap, uint size, uint tag, uint flag) {
+    use(heap);
+    use(tag);
+    use(flag);
+    return low_alloc(size);
+}
+
+void rt_error(uint code, ...) {
+    log_error("rt_error(%u) called", code);
+    exit(2);
+}
+
+void *spin1_malloc(uint bytes) {
+    return low_alloc(bytes);
+}
+
+circular_buffer circular_buffer_initialize(uint32_t size) {
+    uint32_t real_size = 1;
+    while (real_size < size) {
+        real_size <<= 1;
+    }
+    circular_buffer buffer = low_alloc(
+            sizeof(_circular_buffer) + real_size * sizeof(uint32_t));
+    if (buffer == NULL) {
+        return NULL;
+    }
+    buffer->buffer_size = real_size - 1;
+    buffer->output = 0;
+    buffer->input = 0;
+    buffer->overflows = 0;
+    return buffer;
+}
+
+bool simulation_sdp_callback_on(uint sdp_port, callback_t sdp_callback) {
+    if (sdp_port >= N_SDP_PORTS) {
+        log_error("SDP port %u is out of range", sdp_port);
+        return false;
+    }
+    sdp_callbacks[sdp_port] = sdp_callback;
+    return true;
+}
+
+bool simulation_dma_transfer_done_callback_on(uint tag, callback_t callback) {
+    if (tag >= N_DMA_TAGS) {
+        log_error("DMA tag %u is out of range", tag);
+        return false;
+    }
+    dma_callbacks[tag] = callback;
+    return true;
+}
+
+uint spin1_dma_transfer(
+        uint tag, void *system_address, void *tcm_address, uint direction,
+        uint length) {
+    if (dma_n_pending == DMA_QUEUE_SIZE) {
+        return 0;
+    }
+    dma_transfer_t *transfer =
+            &dma_queue[(dma_first + dma_n_pending) % DMA_QUEUE_SIZE];
+    dma_n_pending++;
+    transfer->id = ++dma_last_id;
+    transfer->tag = tag;
+    transfer->system_address = system_address;
+    transfer->tcm_address = tcm_address;
+    transfer->direction = direction;
+    transfer->length = length;
+    return transfer->id;
+}
+
+void spin1_wfi(void) {
+    wfi_count++;
+    host_stubs_dma_complete(1);
+}
+
+uint spin1_send_sdp_msg(sdp_msg_t *msg, uint timeout) {
+    use(timeout);
+    if (sdp_n_sent == HOST_SDP_QUEUE_SIZE) {
+        return 0;
+    }
+    spin1_memcpy(&sdp_queue[(sdp_first + sdp_n_sent) % HOST_SDP_QUEUE_SIZE],
+            msg, sizeof(sdp_msg_t));
+    sdp_n_sent++;
+    return 1;
+}
+
+void spin1_msg_free(sdp_msg_t *msg) {
+    if (msg != sdp_mailbox || !sdp_mailbox_busy) {
+        log_error("freeing an SDP message that was not delivered");
+        return;
+    }
+    sdp_mailbox_busy = false;
+}
+
+uint spin1_get_simulation_time(void) {
+    return simulation_time;
+}
+
+void host_stubs_set_time(uint time) {
+    simulation_time = time;
+}
+
+uint host_stubs_dma_pending(void) {
+    return dma_n_pending;
+}
+
+uint host_stubs_dma_complete(uint n_transfers) {
+    uint n_done = 0;
+    while (n_done < n_transfers && dma_n_pending > 0) {
+        // Take the transfer off the queue first, as the callback may add more
+        dma_transfer_t transfer = dma_queue[dma_first];
+        dma_first = (dma_first + 1) % DMA_QUEUE_SIZE;
+        dma_n_pending--;
+
+        if (transfer.direction == DMA_WRITE) {
+            spin1_memcpy(transfer.system_address, transfer.tcm_address,
+                    transfer.length);
+        } else {
+            spin1_memcpy(transfer.tcm_address, transfer.system_address,
+                    transfer.length);
+        }
+        dma_n_done++;
+        n_done++;
+        if (dma_callbacks[transfer.tag] != NULL) {
+            dma_callbacks[transfer.tag](transfer.id, transfer.tag);
+        }
+    }
+    return n_done;
+}
+
+uint host_stubs_dma_transfers(void) {
+    return dma_n_done;
+}
+
+uint host_stubs_wfi_count(void) {
+    return wfi_count;
+}
+
+bool host_stubs_sdp_take(sdp_msg_t *msg) {
+    if (sdp_n_sent == 0) {
+        return false;
+    }
+    spin1_memcpy(msg, &sdp_queue[sdp_first], sizeof(sdp_msg_t));
+    sdp_first = (sdp_first + 1) % HOST_SDP_QUEUE_SIZE;
+    sdp_n_sent--;
+    return true;
+}
+
+bool host_stubs_sdp_deliver(uint port, const void *data, uint length) {
+    if (port >= N_SDP_PORTS || sdp_callbacks[port] == NULL) {
+        return false;
+    }
+    if (sdp_mailbox == NULL) {
+        sdp_mailbox = low_alloc(sizeof(sdp_msg_t));
+        if (sdp_mailbox == NULL) {
+            log_error("no memory for an SDP message");
+            return false;
+        }
+    }
+    if (sdp_mailbox_busy) {
+        log_error("the last SDP message delivered was not freed");
+    }
+
+    // The length covers the SDP header of 8 bytes before cmd_rc
+    sdp_mailbox->length = 8 + length;
+    spin1_memcpy(&sdp_mailbox->cmd_rc, data, length);
+    sdp_mailbox->dest_port = (port << 5) | spin1_get_core_id();
+    sdp_mailbox_busy = true;
+    sdp_callbacks[port]((uint) (uintptr_t) sdp_mailbox, port);
+    return true;
+}
+
+void host_stubs_reset(void) {
+    while (low_blocks != NULL) {
+        low_block_t *block = low_blocks;
+        low_blocks = block->next;
+        munmap(block, block->size);
+    }
+    sdp_mailbox = NULL;
+    sdp_mailbox_busy = false;
+    simulation_time = 0;
+    dma_first = 0;
+    dma_n_pending = 0;
+    dma_n_done = 0;
+    wfi_count = 0;
+    sdp_first = 0;
+    sdp_n_sent = 0;
+    for (uint i = 0; i < N_DMA_TAGS; i++) {
+        dma_callbacks[i] = NULL;
+    }
+    for (uint i = 0; i < N_SDP_PORTS; i++) {
+        sdp_callbacks[i] = NULL;
+    }
+}
@@ -0,0 +1,1073 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \dir
+//! \brief Host-native build and benchmark of the recording library
+//! \file
+//! \brief Benchmark of the recording library built for the host.
+//!
+//! Each channel records the spikes of a population of neurons that fire at
+//! random at a set rate: once a timestep, a record of the time, the number of
+//! spikes and the ID of each neuron that spiked, or with `-p` a record for each
+//! spike, as models that record as they go make, or with `-r bits` a record of
+//! the time and a bit for each neuron. With `-B` the neurons fire in bursts
+//! rather than steadily. With `-e` the channels encode their records, and the
+//! host decodes them. Records are made through recording.c exactly as on chip,
+//! in the way chosen with `-m`: copied into SDRAM, written by DMA, gathered in
+//! DTCM and written once a timestep, or written by DMA straight from where the
+//! header and the rest of each record were made. DMA transfers are done at the
+//! end of each timestep, or when the core waits for one, which is counted as a
+//! stall.
+//!
+//! The benchmark then plays the host: it answers each read request with an
+//! acknowledgement the next timestep, saying how many reads it has queued, and,
+//! after a set latency, reads the data and tells the core what it read, as
+//! BufferManager does. Every record read back is checked, and whatever is left
+//! is read after recording_finalise() as it would be after a run.
+//!
+//! Reported are the data recorded per second of simulated time, the part of it
+//! that is stored in the channels once encoded, the records dropped because a
+//! channel was full, the read requests (triggers) sent per second of simulated
+//! time, the mean bytes the host read at a time, how full the fullest channel
+//! got and the stalls, so that the way of recording, buffer_size_before_request
+//! and time_between_triggers can be tuned for a recording rate without a board.
+#include <common-typedefs.h>
+#include <recording.h>
+#include <spin1_api.h>
+#include <spin1_api_params.h>
+#include <buffered_eieio_defs.h>
+#include <debug.h>
+#include <host_stubs.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//! The SDP port the recording library listens on, as BufferManager uses
+#define OUTPUT_BUFFERING_SDP_PORT   1
+
+//! Words in recording_data_t
+#define RECORDING_DATA_WORDS        7
+
+//! Words of a record covered by each bitmap of an encoded record
+#define ENCODING_GROUP_WORDS        32
+
+//! The bits that make an EIEIO header a command
+#define EIEIO_COMMAND               0x4000
+
+//! The bits of processor_and_request that hold the number of requests
+#define N_REQUESTS_MASK             0x7
+
+//! Words in a record before the IDs of the neurons that spiked
+#define RECORD_HEADER_WORDS         2
+
+//! Bytes in a record before the IDs of the neurons that spiked
+#define RECORD_HEADER_BYTES         (RECORD_HEADER_WORDS * sizeof(uint32_t))
+
+//! Parts of each record written by recording_record_v()
+#define N_SEGMENTS                  2
+
+//! Records that can be in flight by DMA at once, plus one being filled
+#define N_DMA_RECORDS               (DMA_QUEUE_SIZE + 1)
+
+//! Most reads in a request; the count has three bits
+#define MAX_REQUESTS                N_REQUESTS_MASK
+
+//! Most channels recorded
+#define MAX_CHANNELS                32
+
+//! Microseconds in a second
+#define US_PER_S                    1000000.0
+
+//! Milliseconds in a second
+#define MS_PER_S                    1000.0
+
+//! Nanoseconds in a millisecond
+#define NS_PER_MS                   1000000.0
+
+//! \brief The state of a channel as recording_finalise() leaves it at the
+//!     start of its region.
+//! \details Mirrors recording_channel_t in recording.c, as ChannelBufferState
+//!     does on the host.
+typedef struct channel_state_t {
+    uint8_t *start;             //!< The first byte of the buffer
+    uint8_t *current_write;     //!< Where the next write to the buffer will go
+    uint8_t *dma_current_write; //!< Where DMAs into the buffer go
+    uint8_t *current_read;      //!< Where we read from next
+    uint8_t *end;               //!< One byte past the end of the buffer
+    uint8_t region_id;          //!< The recording region's ID
+    uint8_t missing_info;       //!< Whether recordings were lost
+    //! Whether the most recent operation on the buffer was a read or a write
+    buffered_operations last_buffer_operation;
+    uint8_t encoding;           //!< How records are encoded
+} channel_state_t;
+
+//! How records are made
+typedef enum record_method_t {
+    //! recording_record(), which copies each record into SDRAM
+    RECORD_MEMCPY,
+    //! recording_record_and_notify(), which writes each record by DMA
+    RECORD_DMA,
+    //! recording_record_staged(), which gathers records in DTCM
+    RECORD_STAGED,
+    //! recording_record_v(), which writes the header and the rest of each
+    //! record by DMA from where they were made
+    RECORD_VECTOR,
+    //! The number of methods
+    N_RECORD_METHODS
+} record_method_t;
+
+//! Names of ::record_method_t, as given to `-m`
+static const char *method_names[] = {"memcpy", "dma", "staged", "vector"};
+
+//! Names of ::recording_encodings, as given to `-e`
+static const char *encoding_names[] = {"none", "zero_words"};
+
+//! The number of encodings
+#define N_ENCODINGS (RECORDING_ENCODING_ZERO_WORDS + 1)
+
+//! What a run is to do
+typedef struct benchmark_config_t {
+    uint32_t n_channels;            //!< Number of channels recorded
+    uint32_t n_neurons;             //!< Neurons recorded by each channel
+    uint32_t rate_hz;               //!< Mean firing rate of each neuron
+    uint32_t region_size;           //!< Size of each channel's buffer
+    uint32_t trigger_bytes;         //!< buffer_size_before_request
+    uint32_t time_between_triggers; //!< time_between_triggers
+    uint32_t latency;               //!< Timesteps the host takes to read
+    uint32_t n_steps;               //!< Timesteps to run for
+    uint32_t timestep_us;           //!< Length of a timestep
+    record_method_t method;         //!< How records are made
+    uint32_t staging_bytes;         //!< Size of each staging buffer
+    bool per_spike;                 //!< Whether each spike is a record
+    bool bitfield;                  //!< Whether records are bitfields
+    uint32_t burst_period;          //!< Timesteps between bursts, or 0
+    recording_encodings encoding;   //!< How the channels encode records
+} benchmark_config_t;
+
+//! What the benchmark as host knows of a channel
+typedef struct host_channel_t {
+    uint8_t *encoded;           //!< Data read but not yet decoded
+    uint32_t n_encoded;         //!< Bytes of data read but not yet decoded
+    uint8_t *data;              //!< Data read but not yet checked
+    uint32_t n_data;            //!< Bytes of data read but not yet checked
+    bool any_read;              //!< Whether a record has been read
+    uint64_t last_key;          //!< The time and last ID of the last record
+    uint32_t records_written;   //!< Records the core recorded
+    uint32_t records_read;      //!< Records read back and checked
+    uint64_t bytes_written;     //!< Bytes the core recorded
+    uint64_t bytes_read;        //!< Bytes read back
+} host_channel_t;
+
+//! A read the benchmark as host has still to do
+typedef struct host_read_t {
+    bool pending;               //!< Whether there is a read to do
+    uint32_t due;               //!< When the read is done
+    uint8_t sequence;           //!< The sequence number of the request
+    uint32_t n_requests;        //!< The number of parts to read
+    //! The parts to read
+    read_request_packet_data requests[MAX_REQUESTS];
+} host_read_t;
+
+//! The measurements of a run
+typedef struct benchmark_result_t {
+    uint64_t bytes_recorded;    //!< Bytes recorded
+    uint64_t bytes_stored;      //!< Bytes recorded once encoded
+    uint32_t records_dropped;   //!< Records dropped as their channel was full
+    uint32_t channels_missing;  //!< Channels that flagged missing_info
+    uint32_t triggers;          //!< Read requests sent by the core
+    uint32_t reads;             //!< Reads done by the host while running
+    uint64_t bytes_in_reads;    //!< Bytes read by those reads
+    uint32_t peak_fill;         //!< Most bytes waiting in one channel
+    uint32_t bad;               //!< Records lost or damaged
+    uint32_t stalls;            //!< Times the core waited for a DMA
+    double time_ms;             //!< Wall time of the run in milliseconds
+} benchmark_result_t;
+
+//! The host side of each channel
+static host_channel_t host_channels[MAX_CHANNELS];
+
+//! The read the host is to do next
+static host_read_t host_read;
+
+//! Whether the host owes the core an acknowledgement
+static bool ack_pending;
+
+//! When the acknowledgement is sent
+static uint32_t ack_due;
+
+//! The sequence number to acknowledge
+static uint8_t ack_sequence;
+
+//! The sequence number of the next request the host will read for
+static uint8_t next_sequence;
+
+//! The records being written by DMA, and the one being filled
+static uint32_t *dma_records[N_DMA_RECORDS];
+
+//! The next of ::dma_records to fill
+static uint32_t dma_record_next;
+
+//! The records of ::dma_records not yet written
+static volatile uint32_t dma_records_in_use;
+
+//! The spikes of a channel in a timestep, as a single record
+static uint32_t *spike_record;
+
+//! \brief The spikes of each channel in a timestep, made where they are
+//!     written from by recording_record_v()
+static uint32_t *channel_records[MAX_CHANNELS];
+
+//! The header of each record of one spike written by recording_record_v()
+static uint32_t spike_header[RECORD_HEADER_WORDS];
+
+//! The records made for recording_record_v() not yet written
+static volatile uint32_t vector_records_in_use;
+
+//! The measurements of the current run
+static benchmark_result_t result;
+
+//! Seed for the spikes; any non-zero value will do
+static uint32_t seed = 1;
+
+//! State of the spike generator
+static uint32_t random_state;
+
+//! \brief Get the next pseudo-random number (xorshift32)
+//! \return A 32-bit pseudo-random number
+static uint32_t next_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+//! \brief Called as a record written by DMA is done, so that the record can
+//!     be reused
+static void record_done(void) {
+    dma_records_in_use--;
+}
+
+//! \brief Called as a record written by recording_record_v() is done, so
+//!     that its parts can be remade
+static void vector_record_done(void) {
+    vector_records_in_use--;
+}
+
+//! \brief Fill in a record of the neurons of a channel that spike
+//! \param[out] record: The record
+//! \param[in] time: The timestep of the record
+//! \param[in] n_neurons: The number of neurons
+//! \param[in] threshold: The chance of each spiking, out of 2^32
+//! \return The size of the record in bytes
+static uint32_t make_record(
+        uint32_t *record, uint32_t time, uint32_t n_neurons,
+        uint32_t threshold) {
+    uint32_t n_spikes = 0;
+    for (uint32_t i = 0; i < n_neurons; i++) {
+        if (next_random() < threshold) {
+            record[RECORD_HEADER_WORDS + n_spikes++] = i;
+        }
+    }
+    record[0] = time;
+    record[1] = n_spikes;
+    return (RECORD_HEADER_WORDS + n_spikes) * sizeof(uint32_t);
+}
+
+//! \brief Fill in a record of the time and a bit for each neuron of a
+//!     channel, set if it spikes
+//! \param[out] record: The record
+//! \param[in] time: The timestep of the record
+//! \param[in] n_neurons: The number of neurons
+//! \param[in] threshold: The chance of each spiking, out of 2^32
+//! \return The size of the record in bytes
+static uint32_t make_bitfield_record(
+        uint32_t *record, uint32_t time, uint32_t n_neurons,
+        uint32_t threshold) {
+    uint32_t *bits = &record[1];
+    memset(bits, 0, ((n_neurons + 31) / 32) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n_neurons; i++) {
+        if (next_random() < threshold) {
+            bits[i / 32] |= 1u << (i % 32);
+        }
+    }
+    record[0] = time;
+    return (1 + (n_neurons + 31) / 32) * sizeof(uint32_t);
+}
+
+//! \brief Work out the size of a record as stored in its channel
+//! \param[in] record: The record, which is whole words
+//! \param[in] size: The size of the record in bytes
+//! \param[in] config: What the run is doing
+//! \return The size of the record once encoded as the channels are
+static uint32_t stored_size(
+        const uint32_t *record, uint32_t size,
+        const benchmark_config_t *config) {
+    if (config->encoding == RECORDING_ENCODING_NONE) {
+        return size;
+    }
+    uint32_t n_words = size / sizeof(uint32_t);
+    uint32_t n_stored = 1 +
+            (n_words + ENCODING_GROUP_WORDS - 1) / ENCODING_GROUP_WORDS;
+    for (uint32_t i = 0; i < n_words; i++) {
+        n_stored += (record[i] != 0);
+    }
+    return n_stored * sizeof(uint32_t);
+}
+
+//! \brief Get where a spike comes in the order that records are made
+//! \param[in] time: The time of the spike
+//! \param[in] id: The ID of the neuron, or -1 for none
+//! \return The key; records must be made in increasing order of key
+static inline uint64_t spike_key(uint32_t time, int64_t id) {
+    return ((uint64_t) time << 32) + (uint64_t) (id + 1);
+}
+
+//! \brief Check the complete records read back from a channel.
+//! \details Records are in order of time, and of neuron ID within a time,
+//!     whether they hold the spikes of a timestep or a spike each.
+//! \param[in] channel: The channel
+//! \param[in] n_neurons: The number of neurons of the channel
+static void check_spike_records(uint32_t channel, uint32_t n_neurons) {
+    host_channel_t *host = &host_channels[channel];
+    uint32_t offset = 0;
+    while (host->n_data - offset >= RECORD_HEADER_WORDS * sizeof(uint32_t)) {
+        uint32_t *record = (uint32_t *) &host->data[offset];
+        uint32_t n_spikes = record[1];
+        uint32_t size = (RECORD_HEADER_WORDS + n_spikes) * sizeof(uint32_t);
+        bool ok = n_spikes <= n_neurons;
+        if (ok && host->n_data - offset < size) {
+            // The rest of the record has not been read yet
+            break;
+        }
+        for (uint32_t i = 0; ok && i < n_spikes; i++) {
+            uint32_t id = record[RECORD_HEADER_WORDS + i];
+            ok = id < n_neurons &&
+                    (i == 0 || id > record[RECORD_HEADER_WORDS + i - 1]);
+        }
+        uint32_t *ids = &record[RECORD_HEADER_WORDS];
+        uint64_t first_key = spike_key(record[0], n_spikes ? ids[0] : -1);
+        ok = ok && (!host->any_read || first_key > host->last_key);
+        if (!ok) {
+            // Nothing after a damaged record can be trusted
+            log_error("channel %u: bad record at time %u", channel, record[0]);
+            result.bad++;
+            host->n_data = 0;
+            return;
+        }
+        host->any_read = true;
+        host->last_key = spike_key(
+                record[0], n_spikes ? ids[n_spikes - 1] : -1);
+        host->records_read++;
+        offset += size;
+    }
+    memmove(host->data, &host->data[offset], host->n_data - offset);
+    host->n_data -= offset;
+}
+
+//! \brief Check the complete bitfield records read back from a channel.
+//! \details Records are in order of time, one a timestep.
+//! \param[in] channel: The channel
+//! \param[in] n_neurons: The number of neurons of the channel
+static void check_bitfield_records(uint32_t channel, uint32_t n_neurons) {
+    host_channel_t *host = &host_channels[channel];
+    uint32_t n_words = (n_neurons + 31) / 32;
+    uint32_t size = (1 + n_words) * sizeof(uint32_t);
+    uint32_t offset = 0;
+    while (host->n_data - offset >= size) {
+        uint32_t *record = (uint32_t *) &host->data[offset];
+        uint64_t key = spike_key(record[0], -1);
+        bool ok = !host->any_read || key > host->last_key;
+
+        // Neurons past the last do not spike
+        if (n_neurons % 32 != 0) {
+            ok = ok && (record[n_words] >> (n_neurons % 32)) == 0;
+        }
+        if (!ok) {
+            log_error("channel %u: bad record at time %u", channel, record[0]);
+            result.bad++;
+            host->n_data = 0;
+            return;
+        }
+        host->any_read = true;
+        host->last_key = key;
+        host->records_read++;
+        offset += size;
+    }
+    memmove(host->data, &host->data[offset], host->n_data - offset);
+    host->n_data -= offset;
+}
+
+//! \brief Check the complete records read back from a channel
+//! \param[in] channel: The channel
+//! \param[in] config: What the run is doing
+static void check_records(uint32_t channel, const benchmark_config_t *config) {
+    if (config->bitfield) {
+        check_bitfield_records(channel, config->n_neurons);
+    } else {
+        check_spike_records(channel, config->n_neurons);
+    }
+}
+
+//! \brief Decode a record encoded with ::RECORDING_ENCODING_ZERO_WORDS
+//! \param[in] encoded: The encoded record, after its size
+//! \param[in] n_encoded: The words of encoded data read
+//! \param[out] record: Where to put the record
+//! \param[in] n_words: The words in the record
+//! \return The words of encoded data used, 0 if the record has not all been
+//!     read yet, or UINT32_MAX if it is damaged
+static uint32_t decode_record(
+        const uint32_t *encoded, uint32_t n_encoded, uint32_t *record,
+        uint32_t n_words) {
+    uint32_t used = 0;
+    for (uint32_t first = 0; first < n_words; first += ENCODING_GROUP_WORDS) {
+        uint32_t n_group = n_words - first;
+        if (n_group > ENCODING_GROUP_WORDS) {
+            n_group = ENCODING_GROUP_WORDS;
+        }
+        if (used >= n_encoded) {
+            return 0;
+        }
+        uint32_t bitmap = encoded[used++];
+        if (n_group < ENCODING_GROUP_WORDS && (bitmap >> n_group) != 0) {
+            return UINT32_MAX;
+        }
+        for (uint32_t i = 0; i < n_group; i++) {
+            if (!(bitmap & (1u << i))) {
+                record[first + i] = 0;
+            } else if (used < n_encoded) {
+                record[first + i] = encoded[used++];
+            } else {
+                return 0;
+            }
+        }
+    }
+    return used;
+}
+
+//! \brief Decode the complete records read back from a channel, and check
+//!     them
+//! \param[in] channel: The channel
+//! \param[in] config: What the run is doing
+static void decode_records(uint32_t channel, const benchmark_config_t *config) {
+    host_channel_t *host = &host_channels[channel];
+    uint32_t max_size =
+            (RECORD_HEADER_WORDS + config->n_neurons) * sizeof(uint32_t);
+    uint32_t offset = 0;
+    while (host->n_encoded - offset >= sizeof(uint32_t)) {
+        const uint32_t *encoded = (const uint32_t *) &host->encoded[offset];
+        uint32_t n_encoded = (host->n_encoded - offset) / sizeof(uint32_t);
+        uint32_t size = encoded[0];
+        uint32_t used = UINT32_MAX;
+        if (size <= max_size - host->n_data) {
+            used = decode_record(&encoded[1], n_encoded - 1,
+                    (uint32_t *) &host->data[host->n_data],
+                    (size + 3) / sizeof(uint32_t));
+        }
+        if (used == 0) {
+            // The rest of the record has not been read yet
+            break;
+        }
+        if (used == UINT32_MAX) {
+            log_error("channel %u: bad encoded record", channel);
+            result.bad++;
+            host->n_encoded = 0;
+            return;
+        }
+        host->n_data += size;
+        offset += (1 + used) * sizeof(uint32_t);
+        check_records(channel, config);
+    }
+    memmove(host->encoded, &host->encoded[offset], host->n_encoded - offset);
+    host->n_encoded -= offset;
+}
+
+//! \brief Read part of a channel's buffer, as the host would
+//! \param[in] channel: The channel
+//! \param[in] address: Where the data starts, as recording.c gives it
+//! \param[in] length: The number of bytes to read
+//! \param[in] config: What the run is doing
+static void host_read_data(
+        uint32_t channel, uint32_t address, uint32_t length,
+        const benchmark_config_t *config) {
+    host_channel_t *host = &host_channels[channel];
+    bool encoded = config->encoding != RECORDING_ENCODING_NONE;
+    uint8_t *buffer = encoded ? host->encoded : host->data;
+    uint32_t *n_buffer = encoded ? &host->n_encoded : &host->n_data;
+    if (channel >= config->n_channels ||
+            *n_buffer + length > config->region_size) {
+        log_error("channel %u: cannot read %u bytes", channel, length);
+        result.bad++;
+        return;
+    }
+    memcpy(&buffer[*n_buffer], (void *) (uintptr_t) address, length);
+    *n_buffer += length;
+    host->bytes_read += length;
+    if (encoded) {
+        decode_records(channel, config);
+    } else {
+        check_records(channel, config);
+    }
+}
+
+//! \brief Take a read request from the core and plan the reply
+//! \param[in] msg: The request
+//! \param[in] time: The current time
+//! \param[in] config: What the run is doing
+static void host_receive(
+        const sdp_msg_t *msg, uint32_t time,
+        const benchmark_config_t *config) {
+    const read_request_packet_header *hdr =
+            (const read_request_packet_header *) &msg->cmd_rc;
+    const read_request_packet_data *data =
+            (const read_request_packet_data *) &hdr[1];
+    if (hdr->eieio_header_command !=
+            (EIEIO_COMMAND | SPINNAKER_REQUEST_READ_DATA)) {
+        log_error("unexpected command 0x%04x", hdr->eieio_header_command);
+        result.bad++;
+        return;
+    }
+    result.triggers++;
+
+    // The acknowledgement stops the core asking again, whatever the request
+    ack_pending = true;
+    ack_due = time + 1;
+    ack_sequence = data[0].sequence;
+
+    // A request already being read is not read again
+    if (host_read.pending || data[0].sequence != next_sequence) {
+        return;
+    }
+    host_read.pending = true;
+    host_read.due = time + config->latency;
+    host_read.sequence = data[0].sequence;
+    host_read.n_requests = data[0].processor_and_request & N_REQUESTS_MASK;
+    memcpy(host_read.requests, data,
+            host_read.n_requests * sizeof(read_request_packet_data));
+}
+
+//! \brief Do what the host has to do this timestep
+//! \param[in] time: The current time
+//! \param[in] config: What the run is doing
+static void host_step(uint32_t time, const benchmark_config_t *config) {
+    sdp_msg_t msg;
+    while (host_stubs_sdp_take(&msg)) {
+        host_receive(&msg, time, config);
+    }
+
+    if (ack_pending && ack_due <= time) {
+        host_data_read_ack_packet ack = {
+            .header = {
+                .eieio_header_command = EIEIO_COMMAND | HOST_DATA_READ_ACK,
+                .sequence = ack_sequence
+            },
+            // A read being done holds up any new request
+            .reads_queued = (host_read.pending &&
+                    host_read.sequence != ack_sequence) ? 1 : 0
+        };
+        host_stubs_sdp_deliver(OUTPUT_BUFFERING_SDP_PORT, &ack, sizeof(ack));
+        ack_pending = false;
+    }
+
+    if (host_read.pending && host_read.due <= time) {
+        struct {
+            host_data_read_packet_header header;
+            host_data_read_packet_data data[MAX_REQUESTS];
+        } reply;
+        uint32_t n_read = 0;
+        for (uint32_t i = 0; i < host_read.n_requests; i++) {
+            const read_request_packet_data *request = &host_read.requests[i];
+            if (request->space_to_be_read == 0) {
+                continue;
+            }
+            host_read_data(request->channel, request->start_address,
+                    request->space_to_be_read, config);
+            reply.data[n_read].zero = 0;
+            reply.data[n_read].channel = request->channel;
+            reply.data[n_read].region = request->region;
+            reply.data[n_read].space_read = request->space_to_be_read;
+            result.bytes_in_reads += request->space_to_be_read;
+            n_read++;
+        }
+        if (n_read > 0) {
+            result.reads++;
+        }
+        reply.header.eieio_header_command = EIEIO_COMMAND | HOST_DATA_READ;
+        reply.header.request = n_read;
+        reply.header.sequence = host_read.sequence;
+        host_stubs_sdp_deliver(OUTPUT_BUFFERING_SDP_PORT, &reply,
+                sizeof(reply.header) + n_read * sizeof(reply.data[0]));
+        host_read.pending = false;
+        next_sequence = (next_sequence + 1) & MAX_SEQUENCE_NO;
+    }
+}
+
+//! \brief Read what is left in a channel after recording_finalise(), as the
+//!     host does after a run
+//! \param[in] channel: The channel
+//! \param[in] state: The state of the channel at the start of its region
+//! \param[in] config: What the run is doing
+static void host_read_remaining(
+        uint32_t channel, const channel_state_t *state,
+        const benchmark_config_t *config) {
+    uint8_t *read = state->current_read;
+    uint8_t *write = state->dma_current_write;
+    if (read < write) {
+        host_read_data(channel, (uintptr_t) read, write - read, config);
+    } else if (read > write ||
+            state->last_buffer_operation == BUFFER_OPERATION_WRITE) {
+        host_read_data(channel, (uintptr_t) read, state->end - read, config);
+        host_read_data(channel, (uintptr_t) state->start,
+                write - state->start, config);
+    }
+    if (state->missing_info) {
+        result.channels_missing++;
+    }
+}
+
+//! \brief Make a record in the way the run is to
+//! \param[in] channel: The channel to record in
+//! \param[in] record: The record
+//! \param[in] size: The size of the record in bytes
+//! \param[in] segments: The header and the rest of the record, where they
+//!     stay until written, for recording_record_v()
+//! \param[in] config: What the run is doing
+static void record_one(
+        uint32_t channel, uint32_t *record, uint32_t size,
+        const recording_segment_t segments[N_SEGMENTS],
+        const benchmark_config_t *config) {
+    bool recorded;
+    switch (config->method) {
+    case RECORD_DMA:
+        // The record has to stay put until written; wait for one to be
+        // free, as a model reusing buffers would
+        while (dma_records_in_use == N_DMA_RECORDS) {
+            spin1_wfi();
+        }
+        memcpy(dma_records[dma_record_next], record, size);
+        record = dma_records[dma_record_next];
+        dma_records_in_use++;
+        dma_record_next = (dma_record_next + 1) % N_DMA_RECORDS;
+        recorded = recording_record_and_notify(
+                channel, record, size, record_done);
+        break;
+    case RECORD_STAGED:
+        recorded = recording_record_staged(channel, record, size);
+        break;
+    case RECORD_VECTOR:
+        // The callback is called even if the record is dropped
+        vector_records_in_use++;
+        recorded = recording_record_v(
+                channel, segments, N_SEGMENTS, vector_record_done);
+        break;
+    default:
+        recorded = recording_record(channel, record, size);
+        break;
+    }
+    if (recorded) {
+        uint32_t stored = stored_size(record, size, config);
+        host_channels[channel].records_written++;
+        host_channels[channel].bytes_written += stored;
+        result.bytes_recorded += size;
+        result.bytes_stored += stored;
+    } else {
+        result.records_dropped++;
+    }
+}
+
+//! \brief Record a timestep of every channel
+//! \param[in] time: The current time
+//! \param[in] threshold: The chance of each neuron spiking, out of 2^32
+//! \param[in] config: What the run is doing
+static void record_step(
+        uint32_t time, uint32_t threshold, const benchmark_config_t *config) {
+    // The records of the last timestep must be written before being remade
+    while (vector_records_in_use > 0) {
+        spin1_wfi();
+    }
+    spike_header[0] = time;
+    spike_header[1] = 1;
+
+    for (uint32_t channel = 0; channel < config->n_channels; channel++) {
+        uint32_t *record = (config->method == RECORD_VECTOR) ?
+                channel_records[channel] : spike_record;
+        if (config->bitfield) {
+            uint32_t size = make_bitfield_record(
+                    record, time, config->n_neurons, threshold);
+            recording_segment_t segments[N_SEGMENTS] = {
+                {record, sizeof(uint32_t)},
+                {&record[1], size - sizeof(uint32_t)}};
+            record_one(channel, record, size, segments, config);
+            continue;
+        }
+        uint32_t size = make_record(
+                record, time, config->n_neurons, threshold);
+        if (!config->per_spike) {
+            recording_segment_t segments[N_SEGMENTS] = {
+                {record, RECORD_HEADER_BYTES},
+                {&record[RECORD_HEADER_WORDS], size - RECORD_HEADER_BYTES}};
+            record_one(channel, record, size, segments, config);
+            continue;
+        }
+        for (uint32_t i = 0; i < record[1]; i++) {
+            uint32_t *id = &record[RECORD_HEADER_WORDS + i];
+            uint32_t single[RECORD_HEADER_WORDS + 1] = {time, 1, *id};
+            recording_segment_t segments[N_SEGMENTS] = {
+                {spike_header, RECORD_HEADER_BYTES}, {id, sizeof(uint32_t)}};
+            record_one(channel, single, sizeof(single), segments, config);
+        }
+    }
+}
+
+//! \brief Run the recording library as set up and measure it
+//! \param[in] config: What the run is to do
+//! \return Whether every record recorded was read back intact
+static bool run_benchmark(const benchmark_config_t *config) {
+    uint32_t n_channels = config->n_channels;
+    memset(&result, 0, sizeof(result));
+    memset(&host_read, 0, sizeof(host_read));
+    ack_pending = false;
+    next_sequence = 0;
+    random_state = seed;
+    dma_record_next = 0;
+    dma_records_in_use = 0;
+    vector_records_in_use = 0;
+    size_t record_size =
+            (RECORD_HEADER_WORDS + config->n_neurons) * sizeof(uint32_t);
+    spike_record = malloc(record_size);
+    for (uint32_t i = 0; i < N_DMA_RECORDS; i++) {
+        dma_records[i] = malloc(record_size);
+    }
+
+    // Lay out the recording data as the host does; the region pointers are
+    // the size of a host pointer, and are kept aligned to it
+    size_t data_size = RECORDING_DATA_WORDS * sizeof(uint32_t) +
+            n_channels * (sizeof(channel_state_t *) + 2 * sizeof(uint32_t));
+    uint8_t *data_block = calloc(1, data_size + sizeof(void *));
+    uint32_t *words = (uint32_t *) &data_block[sizeof(void *) -
+            (RECORDING_DATA_WORDS * sizeof(uint32_t)) % sizeof(void *)];
+    channel_state_t **region_ptrs =
+            (channel_state_t **) &words[RECORDING_DATA_WORDS];
+    uint32_t *region_sizes = (uint32_t *) &region_ptrs[n_channels];
+    uint32_t *region_encodings = &region_sizes[n_channels];
+    words[0] = n_channels;
+    words[3] = OUTPUT_BUFFERING_SDP_PORT;
+    words[4] = config->trigger_bytes;
+    words[5] = config->time_between_triggers;
+    for (uint32_t i = 0; i < n_channels; i++) {
+        region_sizes[i] = config->region_size;
+        region_encodings[i] = config->encoding;
+        memset(&host_channels[i], 0, sizeof(host_channel_t));
+        host_channels[i].encoded = malloc(config->region_size);
+        channel_records[i] = (config->method == RECORD_VECTOR) ?
+                malloc(record_size) : NULL;
+        host_channels[i].data = malloc(config->region_size > record_size ?
+                config->region_size : record_size);
+    }
+
+    void *address = words;
+    uint32_t flags;
+    if (!recording_initialize(&address, &flags)) {
+        log_error("could not initialise recording");
+        exit(2);
+    }
+    for (uint32_t i = 0; config->method == RECORD_STAGED && i < n_channels;
+            i++) {
+        if (!recording_use_staging(i, config->staging_bytes)) {
+            exit(2);
+        }
+    }
+
+    // The chance of a neuron spiking in a timestep, out of 2^32
+    double p_spike = (double) config->rate_hz * config->timestep_us / US_PER_S;
+    uint32_t threshold = p_spike >= 1.0 ? UINT32_MAX :
+            (uint32_t) (p_spike * 4294967296.0);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    // In bursts, a tenth of the time at ten times the rate
+    uint32_t burst_steps = config->burst_period / 10;
+    uint32_t burst_threshold = p_spike * 10.0 >= 1.0 ? UINT32_MAX :
+            (uint32_t) (p_spike * 10.0 * 4294967296.0);
+
+    for (uint32_t time = 0; time < config->n_steps; time++) {
+        host_stubs_set_time(time);
+        if (config->burst_period == 0) {
+            record_step(time, threshold, config);
+        } else {
+            record_step(time, time % config->burst_period < burst_steps ?
+                    burst_threshold : 0, config);
+        }
+
+        // The DMA engine finishes well within a timestep
+        host_stubs_dma_complete(host_stubs_dma_pending());
+        recording_do_timestep_update(time);
+        host_step(time, config);
+
+        for (uint32_t i = 0; i < n_channels; i++) {
+            uint32_t fill = host_channels[i].bytes_written -
+                    host_channels[i].bytes_read;
+            if (fill > result.peak_fill) {
+                result.peak_fill = fill;
+            }
+        }
+    }
+    host_stubs_dma_complete(host_stubs_dma_pending());
+    recording_finalise();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result.stalls = host_stubs_wfi_count();
+    result.time_ms = (end.tv_sec - start.tv_sec) * MS_PER_S +
+            (end.tv_nsec - start.tv_nsec) / NS_PER_MS;
+
+    for (uint32_t i = 0; i < n_channels; i++) {
+        host_read_remaining(i, region_ptrs[i], config);
+        host_channel_t *host = &host_channels[i];
+        if (host->records_read != host->records_written ||
+                host->n_data > 0 || host->n_encoded > 0) {
+            log_error("channel %u: %u of %u records read back, %u bytes left",
+                    i, host->records_read, host->records_written,
+                    host->n_data + host->n_encoded);
+            result.bad++;
+        }
+        free(host->encoded);
+        free(host->data);
+        free(channel_records[i]);
+    }
+
+    free(data_block);
+    free(spike_record);
+    for (uint32_t i = 0; i < N_DMA_RECORDS; i++) {
+        free(dma_records[i]);
+    }
+    host_stubs_reset();
+    return result.bad == 0;
+}
+
+//! \brief Print the measurements of a run
+//! \param[in] config: What the run did
+static void print_result(const benchmark_config_t *config) {
+    double seconds = (double) config->n_steps * config->timestep_us / US_PER_S;
+    char method[16];
+    snprintf(method, sizeof(method), "%s%s", method_names[config->method],
+            config->per_spike ? "/spike" : config->bitfield ? "/bits" : "");
+    printf("%-12s %-10s %8u %8u %10u %8u %8u %12.1f %8.1f %10.2f %10.1f "
+            "%8u %8u %8.1f %8u %10.3f %s\n",
+            method, encoding_names[config->encoding], config->n_channels,
+            config->rate_hz, config->trigger_bytes,
+            config->time_between_triggers, config->latency,
+            result.bytes_recorded / seconds,
+            result.bytes_recorded == 0 ? 100.0 :
+                    100.0 * result.bytes_stored / result.bytes_recorded,
+            result.triggers / seconds,
+            result.reads == 0 ? 0.0 :
+                    (double) result.bytes_in_reads / result.reads,
+            result.records_dropped,
+            result.channels_missing,
+            100.0 * result.peak_fill / config->region_size, result.stalls,
+            result.time_ms, result.bad == 0 ? "ok" : "bad");
+    fflush(stdout);
+}
+
+//! \brief Find a method by name
+//! \param[in] name: The name, as in ::method_names
+//! \return The method, or ::N_RECORD_METHODS if none has the name
+static record_method_t find_method(const char *name) {
+    record_method_t method = RECORD_MEMCPY;
+    while (method < N_RECORD_METHODS &&
+            strcmp(name, method_names[method]) != 0) {
+        method++;
+    }
+    return method;
+}
+
+//! \brief Find an encoding by name
+//! \param[in] name: The name, as in ::encoding_names
+//! \return The encoding, or ::N_ENCODINGS if none has the name
+static uint32_t find_encoding(const char *name) {
+    uint32_t encoding = RECORDING_ENCODING_NONE;
+    while (encoding < N_ENCODINGS &&
+            strcmp(name, encoding_names[encoding]) != 0) {
+        encoding++;
+    }
+    return encoding;
+}
+
+//! \brief Print how to use the benchmark
+//! \param[in] program: The name of the program
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [-m method] [-g staging_bytes] [-p] [-r format]\n"
+            "       [-e encoding] [-B burst_period] [-c n_channels]\n"
+            "       [-n n_neurons] [-b buffer_bytes] "
+            "[-i time_between_triggers]\n"
+            "       [-l latency] [-t n_steps] [-u timestep_us] [-S seed]\n"
+            "       [-f rate_hz]... [-T trigger_bytes]...\n"
+            "  -m  how records are made: memcpy (recording_record()), dma\n"
+            "      (recording_record_and_notify()), staged\n"
+            "      (recording_record_staged()) or vector\n"
+            "      (recording_record_v())\n"
+            "  -g  bytes gathered in DTCM for each channel when staged\n"
+            "  -p  record each spike on its own rather than a timestep at "
+            "once\n"
+            "  -r  what a record of a timestep holds: ids (of the neurons\n"
+            "      that spiked) or bits (one for each neuron)\n"
+            "  -e  how the channels encode records: none or zero_words\n"
+            "  -B  fire in bursts, at ten times the rate for the first tenth\n"
+            "      of every burst_period timesteps and not at all otherwise\n"
+            "  -c  channels recorded, at most %u\n"
+            "  -n  neurons recorded by each channel\n"
+            "  -b  size of the buffer of each channel in bytes\n"
+            "  -i  timesteps between read requests (time_between_triggers)\n"
+            "  -l  timesteps the host takes to read after a request\n"
+            "  -t  timesteps to run for\n"
+            "  -u  length of a timestep in microseconds\n"
+            "  -S  seed for the spikes\n"
+            "  -f  mean firing rate of the neurons; each rate given is run\n"
+            "  -T  bytes in a channel that trigger a read request\n"
+            "      (buffer_size_before_request); each size given is run\n",
+            program, MAX_CHANNELS);
+}
+
+//! \brief Run the benchmark for each rate and trigger size given
+//! \param[in] argc: Number of arguments
+//! \param[in] argv: The arguments
+//! \return 0 if every record was read back intact, 1 if not, 2 on bad
+//!     arguments
+int main(int argc, char *argv[]) {
+    benchmark_config_t config = {
+        .n_channels = 4,
+        .n_neurons = 256,
+        .region_size = 65536,
+        .time_between_triggers = 50,
+        .latency = 10,
+        .n_steps = 10000,
+        .timestep_us = 1000,
+        .method = RECORD_MEMCPY,
+        .staging_bytes = 1024,
+        .per_spike = false,
+        .bitfield = false,
+        .burst_period = 0,
+        .encoding = RECORDING_ENCODING_NONE
+    };
+    uint32_t encoding;
+    uint32_t rates[argc];
+    int n_rates = 0;
+    uint32_t triggers[argc];
+    int n_triggers = 0;
+    int opt;
+
+    while ((opt = getopt(
+            argc, argv, "m:g:pr:e:B:c:n:b:i:l:t:u:S:f:T:")) != -1) {
+        switch (opt) {
+        case 'm':
+            config.method = find_method(optarg);
+            break;
+        case 'g':
+            config.staging_bytes = strtoul(optarg, NULL, 0);
+            break;
+        case 'p':
+            config.per_spike = true;
+            break;
+        case 'r':
+            if (strcmp(optarg, "bits") == 0) {
+                config.bitfield = true;
+            } else if (strcmp(optarg, "ids") != 0) {
+                usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 'e':
+            encoding = find_encoding(optarg);
+            if (encoding == N_ENCODINGS) {
+                usage(argv[0]);
+                return 2;
+            }
+            config.encoding = encoding;
+            break;
+        case 'B':
+            config.burst_period = strtoul(optarg, NULL, 0);
+            break;
+        case 'c':
+            config.n_channels = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            config.n_neurons = strtoul(optarg, NULL, 0);
+            break;
+        case 'b':
+            config.region_size = strtoul(optarg, NULL, 0);
+            break;
+        case 'i':
+            config.time_between_triggers = strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            config.latency = strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            config.n_steps = strtoul(optarg, NULL, 0);
+            break;
+        case 'u':
+            config.timestep_us = strtoul(optarg, NULL, 0);
+            break;
+        case 'S':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        case 'f':
+            rates[n_rates++] = strtoul(optarg, NULL, 0);
+            break;
+        case 'T':
+            triggers[n_triggers++] = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (config.method == N_RECORD_METHODS ||
+            (config.per_spike && config.bitfield) ||
+            config.n_channels < 1 || config.n_channels > MAX_CHANNELS ||
+            config.region_size < sizeof(uint32_t) ||
+            (config.region_size & (sizeof(uint32_t) - 1)) != 0 ||
+            config.n_steps < 1 || config.timestep_us < 1 || seed == 0 ||
+            optind != argc) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (n_rates == 0) {
+        rates[n_rates++] = 10;
+    }
+    if (n_triggers == 0) {
+        triggers[n_triggers++] = 16384;
+    }
+
+    printf("%-12s %-10s %8s %8s %10s %8s %8s %12s %8s %10s %10s %8s %8s %8s "
+            "%8s %10s %s\n",
+            "record", "encoding", "channels", "rate_hz", "trigger", "interval",
+            "latency", "bytes/s", "stored_%", "trigger/s", "bytes/read",
+            "dropped", "missing",
+            "peak_%", "stalls", "wall_ms", "result");
+    bool all_ok = true;
+    for (int r = 0; r < n_rates; r++) {
+        for (int t = 0; t < n_triggers; t++) {
+            config.rate_hz = rates[r];
+            config.trigger_bytes = triggers[t];
+            all_ok &= run_benchmark(&config);
+            print_result(&config);
+        }
+    }
+    return all_ok ? 0 : 1;
+}
@@ -37,6 +37,27 @@ typedef void (*recording_complete_callback_t)(void);
 //! \brief The type of channel indices.
 typedef uint8_t channel_index_t;
 
+//! \brief The ways the records of a channel can be encoded, as chosen for
+//!        each channel by the recording data given to recording_initialize()
+typedef enum recording_encodings {
+    //! Records are stored as they are given
+    RECORDING_ENCODING_NONE,
+    //! \brief Each record is stored as its size in bytes, then for each group
+    //!        of up to 32 of its words, a word with a bit set for each word
+    //!        of the group that is not zero, followed by those words.
+    //!
+    //! A record that is not whole words is padded with zeros to encode it.
+    //! Records of spike bitfields, which are mostly zeros, shrink to a few
+    //! words; other records grow by a word and a word per 32.
+    RECORDING_ENCODING_ZERO_WORDS
+} recording_encodings;
+
+//! \brief A part of a record made by recording_record_v()
+typedef struct recording_segment_t {
+    void *data;             //!< The data of the part
+    uint32_t size_bytes;    //!< The size of the part in bytes
+} recording_segment_t;
+
 //! \brief Describes a request to read
 typedef struct {
     uint16_t eieio_header_command;
@@ -74,6 +95,15 @@ typedef struct {
     uint8_t sequence;
 } host_data_read_ack_packet_header;
 
+//! \brief Describes an acknowledgement of a read that also says how busy the
+//!        host is; older hosts send just the header
+typedef struct {
+    host_data_read_ack_packet_header header;
+    //! \brief The reads the host has queued, for any core, ahead of the one
+    //!        being acknowledged
+    uint32_t reads_queued;
+} host_data_read_ack_packet;
+
 //! \brief records some data into a specific recording channel, calling a
 //!        callback function once complete. DO NOT CALL THIS DIRECTLY. Use
 //!        recording_record() or recording_record_and_notify().
@@ -83,6 +113,9 @@ typedef struct {
 //! \param[in] callback callback to call when the recording has completed
 //! \return boolean which is True if the data has been stored in the channel,
 //!         False otherwise.
+//!
+//! Records of a channel that is encoded are encoded as they are copied into
+//! the channel, so any callback is called before this returns.
 bool recording_do_record_and_notify(
         channel_index_t channel, void *data, size_t size_bytes,
         recording_complete_callback_t callback);
@@ -138,6 +171,57 @@ static inline bool recording_record_and_notify(
     return recording_do_record_and_notify(channel, data, size_bytes, callback);
 }
 
+//! \brief records data held in several parts into a specific recording
+//!        channel as one record, calling a callback function once complete
+//! \param[in] channel the channel to store the data into.
+//! \param[in] segments the parts of the record, in order.
+//! \param[in] n_segments the number of parts.
+//! \param[in] callback callback to call when the recording has completed, or
+//!            NULL to use direct, immediate copying.
+//! \return boolean which is True if the data has been stored in the channel,
+//!         False otherwise.
+//!
+//! Each part is written straight into the channel, by a chain of DMAs if
+//! there is a callback, so the parts need not be copied together first. They
+//! must then be in whole words and stay as they are until the callback is
+//! called, which is done once, after the last part is written. Records of a
+//! channel that is encoded, or that gathers them (recording_use_staging()),
+//! are copied at once, so any callback is called before this returns.
+bool recording_record_v(
+        channel_index_t channel, const recording_segment_t *segments,
+        uint32_t n_segments, recording_complete_callback_t callback);
+
+//! \brief Gathers the records of a channel in DTCM, to be written to the
+//!        channel together by recording_do_timestep_update().
+//!
+//! Many small records then cost a copy into DTCM each, rather than a DMA or a
+//! copy into SDRAM each, and the channel is written by one DMA (two if it
+//! wraps around) a timestep. Twice the size is taken from DTCM, so that one
+//! half can gather records while the other is written. Records of a channel
+//! that gathers them should all be made with recording_record_staged(); any
+//! made otherwise go ahead of those gathered, and if they take the space of
+//! those gathered, those are lost and the channel is marked as missing data.
+//! \param[in] channel the channel to gather records for.
+//! \param[in] size_bytes the most bytes gathered before they are written;
+//!            more than this in a timestep are written as the space runs out.
+//! \return boolean which is True if the buffer was made, False otherwise.
+bool recording_use_staging(channel_index_t channel, uint32_t size_bytes);
+
+//! \brief records some data into a specific recording channel by way of the
+//!        buffer made by recording_use_staging(), or directly as
+//!        recording_record() does if there is none.
+//! \param[in] channel the channel to store the data into.
+//! \param[in] data the data to store into the channel; it is copied at once.
+//! \param[in] size_bytes the number of bytes that this data will take up.
+//!            This may be any number of bytes, though whole words let the
+//!            channel be written by DMA.
+//! \return boolean which is True if there was space for the data in the
+//!         channel, False otherwise.
+//!
+//! Records of a channel that is encoded are encoded as they are gathered.
+bool recording_record_staged(
+        channel_index_t channel, void *data, size_t size_bytes);
+
 //! \brief Finishes recording - should only be called if recording_flags is
 //!        not 0
 void recording_finalise(void);
@@ -171,6 +255,9 @@ void recording_finalise(void);
 //!
 //!    // size of each region to be recorded
 //!    uint32_t size_of_region[n_regions];
+//!
+//!    // how the records of each region are encoded (recording_encodings)
+//!    uint32_t encoding_of_region[n_regions];
 //! }
 //! ```
 //! \param[out] recording_flags: Output of flags which can be used to check if
@@ -183,7 +270,15 @@ bool recording_initialize(
 void recording_reset(void);
 
 //! \brief Call once per timestep to ensure buffering is done - should only
-//!        be called if recording flags is not 0
+//!        be called if recording flags is not 0. Records gathered by
+//!        recording_record_staged() are written here.
+//!
+//! A read is asked of the host every time_between_triggers timesteps for the
+//! channels holding at least buffer_size_before_request bytes. How fast each
+//! channel fills and how long the host takes to read are also tracked, and a
+//! read is asked for sooner if a channel would otherwise fill before the
+//! host could read it. buffer_size_before_request can thus be set high, for
+//! fewer and larger reads, without bursts of recording overflowing.
 //! \param[in] time: the current simulation time
 void recording_do_timestep_update(timer_t time);
 
@@ -53,8 +53,38 @@ typedef struct recording_channel_t {
     //!
     //! This allows the read and write pointer to overlap sensibly.
     buffered_operations last_buffer_operation;
+    uint8_t encoding;           //!< How records are encoded
 } recording_channel_t;
 
+//! \brief A DTCM buffer in which records for a channel are gathered, to be
+//!     written to the channel together.
+//!
+//! There are two halves, so that records can be gathered in one while the
+//! other is being written by DMA.
+typedef struct recording_staging_t {
+    uint8_t *halves[2];         //!< The two halves of the buffer
+    uint32_t size;              //!< The size of each half in bytes
+    uint32_t n_bytes;           //!< The bytes gathered in the active half
+    uint8_t active;             //!< Which half records are gathered in
+    uint8_t n_in_flight;        //!< DMAs of the other half not yet done
+} recording_staging_t;
+
+//! \brief How recording_write_one_chunk() writes a chunk into a channel
+typedef enum write_method_t {
+    //! Copied at once
+    WRITE_COPY,
+    //! Written by DMA
+    WRITE_DMA,
+    //! Written by DMA if whole words, as the staging buffer of the channel
+    WRITE_STAGED
+} write_method_t;
+
+//! \brief How fast a channel is filling, worked out once a timestep
+typedef struct recording_fill_t {
+    uint32_t bytes_written;     //!< Bytes written since the last timestep
+    uint32_t rate;              //!< Bytes written a timestep, falling slowly
+} recording_fill_t;
+
 //! header of general structure describing all recordings
 typedef struct recording_data_t {
     //! The number of recording regions
@@ -84,6 +114,12 @@ static circular_buffer dma_complete_buffer;
 //! Array containing all possible channels. In DTCM.
 static recording_channel_t *g_recording_channels = NULL;
 
+//! Array of staging buffers, one per channel. In DTCM.
+static recording_staging_t *g_recording_staging = NULL;
+
+//! Array of how fast each channel is filling. In DTCM.
+static recording_fill_t *g_recording_fill = NULL;
+
 //! Array containing all possible channels. In SDRAM.
 static recording_channel_t **region_addresses = NULL;
 
@@ -113,6 +149,31 @@ static uint32_t buffer_size_before_trigger = 0;
 //! Independent of ::buffer_size_before_trigger
 static uint32_t time_between_triggers = 0;
 
+//! \brief The channel to look at first in the next buffer read message.
+//!
+//! Channels that do not fit in a message are left for the next, so that each
+//! gets its turn.
+static uint32_t next_trigger_channel = 0;
+
+//! The time as last given to recording_do_timestep_update()
+static uint32_t current_time = 0;
+
+//! \brief Timesteps the host takes to read for each read it has queued, in
+//!     units of 1/2^::LATENCY_SHIFT of a timestep
+static uint32_t read_latency = 0;
+
+//! The reads the host said it had queued when it last acknowledged
+static uint32_t host_reads_queued = 0;
+
+//! Whether a read has been asked for that the host has not yet done
+static bool read_pending = false;
+
+//! When the read not yet done was first asked for
+static uint32_t read_request_time = 0;
+
+//! When the fill rates of the channels were last updated
+static uint32_t last_fill_time = 0;
+
 //! A pointer to the last sequence number to write once recording is complete
 static uint32_t *last_sequence_number;
 
@@ -128,12 +189,40 @@ static read_request_packet_data *read_request_data;
 //! The time between buffer read messages
 #define MIN_TIME_BETWEEN_TRIGGERS 50
 
+//! \brief The most reads one buffer read message can ask for.
+//!
+//! The count shares a byte with the core ID, which has the top five bits.
+#define MAX_READ_REQUESTS 7
+
 //! n words outside struct per recording region used
 #define N_WORDS_USED_OUTSIDE_STRUCT_PER_REGION 2
 
 //! word to byte conversion
 #define WORD_TO_BYTE_CONVERSION 4
 
+//! The fraction bits of ::read_latency
+#define LATENCY_SHIFT 4
+
+//! The timesteps the host is thought to take to read before it has
+#define INITIAL_READ_LATENCY 10
+
+//! \brief The shift of the difference by which the estimate of read latency
+//!     falls towards a lower sample
+#define LATENCY_DECAY_SHIFT 3
+
+//! \brief The shift of the difference by which the estimate of the fill rate
+//!     of a channel falls towards a lower sample. This is slow, so that a
+//!     channel that records in bursts keeps room for the next burst.
+#define RATE_DECAY_SHIFT 7
+
+//! \brief Flag with the channel in ::dma_complete_buffer for a DMA that
+//!     writes a staging buffer
+#define STAGED_DMA 0x100
+
+//! The words of a record covered by each bitmap of a record encoded with
+//! ::RECORDING_ENCODING_ZERO_WORDS
+#define ENCODING_GROUP_WORDS 32
+
 //---------------------------------------
 //! \brief checks that a channel has been initialised
 //! \param[in] channel the channel to check
@@ -152,6 +241,20 @@ static inline bool close_channel(uint8_t channel) {
     return true;
 }
 
+//! \brief Move an estimate towards a new sample, rising at once to a higher
+//!     sample so that bursts are caught, but falling slowly
+//! \param[in] estimate: The estimate
+//! \param[in] sample: The new sample
+//! \param[in] decay_shift: The shift of the difference to fall by
+//! \return The new estimate
+static inline uint32_t recording_estimate(
+        uint32_t estimate, uint32_t sample, uint32_t decay_shift) {
+    if (sample >= estimate) {
+        return sample;
+    }
+    return estimate - ((estimate - sample) >> decay_shift);
+}
+
 //! \brief Handles a ::HOST_DATA_READ EIEIO message.
 //! \param[in] msg: The message to handle.
 static inline void recording_host_data_read(const eieio_msg_t msg) {
@@ -169,6 +272,15 @@ static inline void recording_host_data_read(const eieio_msg_t msg) {
     sequence_number = (sequence_number + 1) & MAX_SEQUENCE_NO;
     sequence_ack = false;
 
+    // The host took this long to read, waiting behind the reads it had queued
+    if (read_pending) {
+        read_pending = false;
+        uint32_t latency = ((current_time - read_request_time) <<
+                LATENCY_SHIFT) / (1 + host_reads_queued);
+        read_latency = recording_estimate(
+                read_latency, latency, LATENCY_DECAY_SHIFT);
+    }
+
     uint32_t i;
     for (i = 0; i < n_requests; i++) {
         uint8_t channel = ptr_data[i].channel;
@@ -195,7 +307,9 @@ static inline void recording_host_data_read(const eieio_msg_t msg) {
 
 //! \brief Handles a ::HOST_DATA_READ_ACK EIEIO message.
 //! \param[in] msg: The message to handle.
-static inline void recording_host_data_read_ack(const eieio_msg_t msg) {
+//! \param[in] length: Length of the message content, in bytes.
+static inline void recording_host_data_read_ack(
+        const eieio_msg_t msg, uint length) {
     const host_data_read_ack_packet_header *ptr_hdr =
             (const host_data_read_ack_packet_header *) msg;
 
@@ -207,6 +321,10 @@ static inline void recording_host_data_read_ack(const eieio_msg_t msg) {
     }
     log_debug("Sequence %d acked", sequence);
     sequence_ack = true;
+    if (length >= sizeof(host_data_read_ack_packet)) {
+        host_reads_queued =
+                ((const host_data_read_ack_packet *) msg)->reads_queued;
+    }
 }
 
 //! \brief Receives an EIEIO message intended for the recording code.
@@ -235,7 +353,7 @@ static inline void recording_eieio_packet_handler(
 
         case HOST_DATA_READ_ACK:
             log_debug("command: HOST_DATA_READ_ACK");
-            recording_host_data_read_ack(msg);
+            recording_host_data_read_ack(msg, length);
             break;
 
         default:
@@ -282,14 +400,30 @@ static uint32_t compute_available_space_in_channel(uint8_t channel) {
 //! \param[in] length: Length of data to record.
 //! \param[in] finished_write_pointer: Where we will write to next after this
 //!                                    write completes.
-//! \param[in] callback: Optional callback. If not `NULL`, the recording will be
-//!                      done asynchronously by DMA and this callback will be
-//!                      called once the write is finished. If `NULL`, the
-//!                      recording will be done synchronously.
+//! \param[in] callback: Optional callback, called once a write by DMA is
+//!                      finished.
+//! \param[in] method: How the chunk is written
 static void recording_write_one_chunk(
         uint8_t channel, void *data, void *write_pointer, uint32_t length,
-        void *finished_write_pointer, recording_complete_callback_t callback) {
-    if (callback != NULL) {
+        void *finished_write_pointer, recording_complete_callback_t callback,
+        write_method_t method) {
+    if (method == WRITE_STAGED && !_not_word_aligned((uint32_t) write_pointer)
+            && !_not_word_aligned((uint32_t) data)
+            && !_not_word_aligned(length)) {
+        // add to DMA complete tracker, marked so the half can be reused
+        // once it is done
+        g_recording_staging[channel].n_in_flight++;
+        circular_buffer_add(dma_complete_buffer, channel | STAGED_DMA);
+        circular_buffer_add(
+                dma_complete_buffer, (uint32_t) finished_write_pointer);
+        circular_buffer_add(dma_complete_buffer, (uint32_t) callback);
+
+        while (!spin1_dma_transfer(
+                RECORDING_DMA_COMPLETE_TAG_ID, write_pointer, data, DMA_WRITE,
+                length)) {
+            spin1_wfi();
+        }
+    } else if (method == WRITE_DMA) {
         // add to DMA complete tracker
         circular_buffer_add(dma_complete_buffer, (uint32_t) channel);
         circular_buffer_add(
@@ -313,14 +447,15 @@ static void recording_write_one_chunk(
 //! \param[in] channel: Which channel is being recorded to.
 //! \param[in] data: Pointer to what is being recorded.
 //! \param[in] length: Length of data to record.
-//! \param[in] callback: Optional callback. If not `NULL`, the recording will
-//!     be done asynchronously by DMA and this callback will be called once the
-//!     write is finished. If `NULL`, the recording will be done synchronously.
+//! \param[in] callback: Optional callback, called once a write by DMA is
+//!     finished.
+//! \param[in] method: How the recording is written; by ::WRITE_COPY it is
+//!     done synchronously.
 //! \return True if the recording was successfully written or enqueued for
 //!     writing.
 static inline bool recording_write_memory(
         uint8_t channel, void *data, uint32_t length,
-        recording_complete_callback_t callback) {
+        recording_complete_callback_t callback, write_method_t method) {
     uint8_t *buffer_region = g_recording_channels[channel].start;
     uint8_t *end_of_buffer_region = g_recording_channels[channel].end;
     uint8_t *write_pointer = g_recording_channels[channel].current_write;
@@ -343,7 +478,7 @@ static inline bool recording_write_memory(
         if (final_space >= length) {
             log_debug("Packet fits in final space of %u", final_space);
             recording_write_one_chunk(channel, data, write_pointer, length,
-                    write_pointer + length, callback);
+                    write_pointer + length, callback, method);
             write_pointer += length;
         } else {
             uint32_t total_space = final_space +
@@ -358,7 +493,7 @@ static inline bool recording_write_memory(
                     length, final_space);
 
             recording_write_one_chunk(channel, data, write_pointer, final_space,
-                    buffer_region, NULL);
+                    buffer_region, NULL, method);
 
             write_pointer = buffer_region;
             data += final_space;
@@ -367,7 +502,7 @@ static inline bool recording_write_memory(
             log_debug("Copying remaining %u bytes", final_len);
 
             recording_write_one_chunk(channel, data, write_pointer, final_len,
-                    write_pointer + final_len, callback);
+                    write_pointer + final_len, callback, method);
 
             write_pointer += final_len;
         }
@@ -382,7 +517,7 @@ static inline bool recording_write_memory(
 
         log_debug("Packet fits in middle space of %u", middle_space);
         recording_write_one_chunk(channel, data, write_pointer, length,
-                write_pointer + length, callback);
+                write_pointer + length, callback, method);
         write_pointer += length;
     } else {
         log_debug("reached end");
@@ -398,6 +533,7 @@ static inline bool recording_write_memory(
     g_recording_channels[channel].current_write = write_pointer;
     g_recording_channels[channel].last_buffer_operation =
             BUFFER_OPERATION_WRITE;
+    g_recording_fill[channel].bytes_written += length;
     return true;
 }
 
@@ -418,22 +554,46 @@ static void create_buffer_message(
     datum->space_to_be_read = space_to_be_read;
 }
 
+//! \brief Work out how long the host is expected to take to do a read asked
+//!     for now
+//! \return The number of timesteps, rounded up
+static inline uint32_t expected_read_latency(void) {
+    return (read_latency * (1 + host_reads_queued) +
+            (1 << LATENCY_SHIFT) - 1) >> LATENCY_SHIFT;
+}
+
+//! \brief Check whether a channel would fill within a number of timesteps
+//!     at the rate it has been filling
+//! \param[in] channel: The channel to check
+//! \param[in] horizon: The number of timesteps
+//! \return True if the channel would fill
+static inline bool channel_fills_within(uint8_t channel, uint32_t horizon) {
+    return compute_available_space_in_channel(channel) / (horizon + 1) <
+            g_recording_fill[channel].rate;
+}
+
 //! \brief Send a message to host ask for for our buffers to be flushed
 //! \param[in] flush_all: If true, all buffers will be flushed, otherwise only
-//!                       sufficiently full ones will be
+//!                       sufficiently full ones will be, and those that would
+//!                       soon have to be asked for early anyway
 static inline void recording_send_buffering_out_trigger_message(
         bool flush_all) {
     uint msg_size = 16 + sizeof(read_request_packet_header);
     uint n_requests = 0;
+    uint first_channel = next_trigger_channel;
+    // A step past where recording_read_urgent() would ask for them
+    uint32_t horizon = 3 * expected_read_latency();
 
-    for (uint channel = 0; channel < n_recording_regions; channel++) {
+    for (uint i = 0; i < n_recording_regions; i++) {
+        uint channel = (first_channel + i) % n_recording_regions;
         uint32_t space_total = (uint32_t) (
                 g_recording_channels[channel].end -
                 g_recording_channels[channel].start);
         uint32_t space_available = compute_available_space_in_channel(channel);
 
         if (has_been_initialised(channel) && (flush_all ||
-                space_total - space_available >= buffer_size_before_trigger)) {
+                space_total - space_available >= buffer_size_before_trigger ||
+                channel_fills_within(channel, horizon))) {
             uint8_t *buffer_region = g_recording_channels[channel].start;
             uint8_t *end_of_buffer_region = g_recording_channels[channel].end;
             uint8_t *write_pointer =
@@ -442,6 +602,22 @@ static inline void recording_send_buffering_out_trigger_message(
             buffered_operations last_buffer_operation =
                     g_recording_channels[channel].last_buffer_operation;
 
+            // Nothing can be read from an empty buffer, nor until the DMAs
+            // into an emptied buffer finish
+            if (write_pointer == read_pointer && (
+                    last_buffer_operation == BUFFER_OPERATION_READ ||
+                    g_recording_channels[channel].current_write !=
+                            write_pointer)) {
+                continue;
+            }
+
+            // A buffer that has wrapped around is read in two parts
+            uint n_parts = (read_pointer < write_pointer) ? 1 : 2;
+            if (n_requests + n_parts > MAX_READ_REQUESTS) {
+                next_trigger_channel = channel;
+                break;
+            }
+
             if (read_pointer < write_pointer) {
                 create_buffer_message(
                         &read_request_data[n_requests++], channel,
@@ -480,6 +656,51 @@ static inline void recording_send_buffering_out_trigger_message(
         read_request_msg.length = msg_size;
 
         spin1_send_sdp_msg(&read_request_msg, 1);
+        if (!read_pending) {
+            read_pending = true;
+            read_request_time = current_time;
+        }
+    }
+}
+
+//! \brief Check whether a read should be asked for before
+//!     ::time_between_triggers is up, as a channel would otherwise fill
+//!     before the host could read it
+//! \details A channel may have to wait for a read already asked for to be
+//!     done, or be left for the next request if there are too many reads
+//!     for one, so it is asked for while it has room for two reads' time.
+//! \param[in] time: The current time
+//! \return True if a read should be asked for now
+static bool recording_read_urgent(uint32_t time) {
+    uint32_t latency = expected_read_latency();
+
+    // Give the host time to answer a request before asking again
+    if (read_pending && time - last_time_buffering_trigger <= latency) {
+        return false;
+    }
+    for (uint32_t channel = 0; channel < n_recording_regions; channel++) {
+        if (has_been_initialised(channel) &&
+                channel_fills_within(channel, 2 * latency)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//! \brief Update how fast each channel is filling with what was written to
+//!     it since this was last done
+//! \param[in] time: The current time
+static void recording_update_fill_rates(uint32_t time) {
+    uint32_t elapsed = time - last_fill_time;
+    if (elapsed == 0) {
+        elapsed = 1;
+    }
+    last_fill_time = time;
+    for (uint32_t channel = 0; channel < n_recording_regions; channel++) {
+        recording_fill_t *fill = &g_recording_fill[channel];
+        fill->rate = recording_estimate(
+                fill->rate, fill->bytes_written / elapsed, RATE_DECAY_SHIFT);
+        fill->bytes_written = 0;
     }
 }
 
@@ -502,17 +723,220 @@ static void buffering_in_handler(uint mailbox, uint port) {
     log_debug("Done freeing message");
 }
 
-bool recording_do_record_and_notify(
-        uint8_t channel, void *data, uint32_t size_bytes,
+//! \brief Get a group of the words of a record to encode
+//! \param[in] segments: The parts of the record
+//! \param[in] n_segments: The number of parts
+//! \param[in] first_word: The index in the record of the first word of the
+//!     group
+//! \param[in] n_words: The number of words in the group
+//! \param[out] copy: Where the group is copied if it cannot be read in place
+//! \return The words of the group
+static inline const uint32_t *encoding_group(
+        const recording_segment_t *segments, uint32_t n_segments,
+        uint32_t first_word, uint32_t n_words, uint32_t *copy) {
+    // Find the part holding the start of the group
+    uint32_t offset = first_word * sizeof(uint32_t);
+    uint32_t i = 0;
+    while (offset >= segments[i].size_bytes) {
+        offset -= segments[i].size_bytes;
+        i++;
+    }
+    const uint8_t *group = &((const uint8_t *) segments[i].data)[offset];
+    uint32_t group_bytes = n_words * sizeof(uint32_t);
+    if (segments[i].size_bytes - offset >= group_bytes &&
+            !_not_word_aligned((uint32_t) group)) {
+        return (const uint32_t *) group;
+    }
+
+    // Only the last word of a record can be short; pad it with zeros
+    copy[n_words - 1] = 0;
+    uint8_t *to = (uint8_t *) copy;
+    for (; i < n_segments && group_bytes > 0; i++) {
+        uint32_t n_bytes = segments[i].size_bytes - offset;
+        if (n_bytes > group_bytes) {
+            n_bytes = group_bytes;
+        }
+        spin1_memcpy(to, &((const uint8_t *) segments[i].data)[offset],
+                n_bytes);
+        to += n_bytes;
+        group_bytes -= n_bytes;
+        offset = 0;
+    }
+    return copy;
+}
+
+//! \brief Encode a group of the words of a record
+//! \param[out] encoded: Where to put the bitmap and the words that are not
+//!     zero
+//! \param[in] words: The group
+//! \param[in] n_words: The number of words in the group
+//! \return The number of words put in \p encoded
+static inline uint32_t encode_group(
+        uint32_t *encoded, const uint32_t *words, uint32_t n_words) {
+    uint32_t bitmap = 0;
+    uint32_t n_encoded = 1;
+    for (uint32_t i = 0; i < n_words; i++) {
+        if (words[i] != 0) {
+            bitmap |= 1 << i;
+            encoded[n_encoded++] = words[i];
+        }
+    }
+    encoded[0] = bitmap;
+    return n_encoded;
+}
+
+//! \brief Work out the size of a record once encoded
+//! \param[in] segments: The parts of the record
+//! \param[in] n_segments: The number of parts
+//! \param[in] size_bytes: The size of the record in bytes
+//! \return The size of the encoded record in bytes
+static uint32_t recording_encoded_size(
+        const recording_segment_t *segments, uint32_t n_segments,
+        uint32_t size_bytes) {
+    uint32_t n_words = (size_bytes + 3) >> 2;
+    uint32_t copy[ENCODING_GROUP_WORDS];
+
+    // The size, and a bitmap per group
+    uint32_t n_encoded = 1 +
+            (n_words + ENCODING_GROUP_WORDS - 1) / ENCODING_GROUP_WORDS;
+    for (uint32_t first = 0; first < n_words; first += ENCODING_GROUP_WORDS) {
+        uint32_t n_group = n_words - first;
+        if (n_group > ENCODING_GROUP_WORDS) {
+            n_group = ENCODING_GROUP_WORDS;
+        }
+        const uint32_t *words =
+                encoding_group(segments, n_segments, first, n_group, copy);
+        for (uint32_t i = 0; i < n_group; i++) {
+            n_encoded += (words[i] != 0);
+        }
+    }
+    return n_encoded * sizeof(uint32_t);
+}
+
+//! \brief Encode a record into memory that need not be written by DMA
+//! \param[out] encoded: Where to put the encoded record; this must have
+//!     space for recording_encoded_size() bytes
+//! \param[in] segments: The parts of the record
+//! \param[in] n_segments: The number of parts
+//! \param[in] size_bytes: The size of the record in bytes
+static void recording_encode(
+        uint32_t *encoded, const recording_segment_t *segments,
+        uint32_t n_segments, uint32_t size_bytes) {
+    uint32_t n_words = (size_bytes + 3) >> 2;
+    uint32_t copy[ENCODING_GROUP_WORDS];
+    uint32_t n_encoded = 0;
+    encoded[n_encoded++] = size_bytes;
+    for (uint32_t first = 0; first < n_words; first += ENCODING_GROUP_WORDS) {
+        uint32_t n_group = n_words - first;
+        if (n_group > ENCODING_GROUP_WORDS) {
+            n_group = ENCODING_GROUP_WORDS;
+        }
+        n_encoded += encode_group(&encoded[n_encoded],
+                encoding_group(segments, n_segments, first, n_group, copy),
+                n_group);
+    }
+}
+
+//! \brief Encode a record into a channel a group at a time, so that no
+//!     buffer is needed for the whole encoded record
+//! \param[in] channel: The channel, which must have space for
+//!     recording_encoded_size() bytes
+//! \param[in] segments: The parts of the record
+//! \param[in] n_segments: The number of parts
+//! \param[in] size_bytes: The size of the record in bytes
+static void recording_write_encoded(
+        uint8_t channel, const recording_segment_t *segments,
+        uint32_t n_segments, uint32_t size_bytes) {
+    uint32_t n_words = (size_bytes + 3) >> 2;
+    uint32_t copy[ENCODING_GROUP_WORDS];
+
+    // The size, then a group's bitmap and words
+    uint32_t block[2 + ENCODING_GROUP_WORDS];
+    uint32_t n_block = 0;
+    block[n_block++] = size_bytes;
+    for (uint32_t first = 0; first < n_words; first += ENCODING_GROUP_WORDS) {
+        uint32_t n_group = n_words - first;
+        if (n_group > ENCODING_GROUP_WORDS) {
+            n_group = ENCODING_GROUP_WORDS;
+        }
+        n_block += encode_group(&block[n_block],
+                encoding_group(segments, n_segments, first, n_group, copy),
+                n_group);
+        recording_write_memory(channel, block, n_block * sizeof(uint32_t),
+                NULL, WRITE_COPY);
+        n_block = 0;
+    }
+    if (n_block > 0) {
+        // An empty record is just its size
+        recording_write_memory(channel, block, n_block * sizeof(uint32_t),
+                NULL, WRITE_COPY);
+    }
+}
+
+//! \brief Write the parts of a record one after another into a channel
+//! \param[in] channel: The channel, which must have space for the record
+//! \param[in] segments: The parts of the record
+//! \param[in] n_segments: The number of parts
+//! \param[in] callback: Optional callback. If not `NULL`, the parts are
+//!     written by a chain of DMAs and this is called once the last is
+//!     finished. If `NULL`, they are copied at once.
+static void recording_write_segments(
+        uint8_t channel, const recording_segment_t *segments,
+        uint32_t n_segments, recording_complete_callback_t callback) {
+    write_method_t method = (callback != NULL) ? WRITE_DMA : WRITE_COPY;
+
+    // Empty parts are not written, so the last that is not has the callback
+    uint32_t n_written = n_segments;
+    while (n_written > 0 && segments[n_written - 1].size_bytes == 0) {
+        n_written--;
+    }
+    if (n_written == 0) {
+        if (callback != NULL) {
+            callback();
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < n_written - 1; i++) {
+        if (segments[i].size_bytes > 0) {
+            recording_write_memory(channel, segments[i].data,
+                    segments[i].size_bytes, NULL, method);
+        }
+    }
+    recording_write_memory(channel, segments[n_written - 1].data,
+            segments[n_written - 1].size_bytes, callback, method);
+}
+
+//! \brief Record the parts of a record straight into a channel
+//! \param[in] channel: The channel to store the record into
+//! \param[in] segments: The parts of the record
+//! \param[in] n_segments: The number of parts
+//! \param[in] size_bytes: The size of the record in bytes
+//! \param[in] callback: Optional callback, called once the record is
+//!     written, or at once if it is not
+//! \return True if the record has been stored in the channel
+static bool recording_record_segments(
+        uint8_t channel, const recording_segment_t *segments,
+        uint32_t n_segments, uint32_t size_bytes,
         recording_complete_callback_t callback) {
     if (has_been_initialised(channel)) {
-        recording_channel_t *recording_channel = &g_recording_channels[channel];
         uint32_t space_available = compute_available_space_in_channel(channel);
 
-        // If there's space to record
-        if (space_available >= size_bytes) {
+        if (g_recording_channels[channel].encoding !=
+                RECORDING_ENCODING_NONE) {
+            // Encoded as it is copied, so it is done at once
+            if (space_available >= recording_encoded_size(
+                    segments, n_segments, size_bytes)) {
+                recording_write_encoded(
+                        channel, segments, n_segments, size_bytes);
+                if (callback != NULL) {
+                    callback();
+                }
+                return true;
+            }
+        } else if (space_available >= size_bytes) {
+            // If there's space to record
             // Copy data into recording channel
-            recording_write_memory(channel, data, size_bytes, callback);
+            recording_write_segments(channel, segments, n_segments, callback);
             return true;
         }
 
@@ -529,8 +953,161 @@ bool recording_do_record_and_notify(
     return false;
 }
 
+bool recording_do_record_and_notify(
+        channel_index_t channel, void *data, size_t size_bytes,
+        recording_complete_callback_t callback) {
+    recording_segment_t segment = {.data = data, .size_bytes = size_bytes};
+    return recording_record_segments(
+            channel, &segment, 1, size_bytes, callback);
+}
+
+bool recording_use_staging(channel_index_t channel, uint32_t size_bytes) {
+    if (!has_been_initialised(channel)) {
+        log_error("cannot stage records for channel %u, which is not in use",
+                channel);
+        return false;
+    }
+    recording_staging_t *staging = &g_recording_staging[channel];
+    if (staging->size > 0) {
+        log_error("channel %u is already staging records", channel);
+        return false;
+    }
+
+    // Keep the halves in whole words so that they can be written by DMA
+    size_bytes = (size_bytes + 3) & ~3;
+    uint8_t *halves = spin1_malloc(2 * size_bytes);
+    if (halves == NULL) {
+        log_error("Not enough space to stage %u bytes for channel %u",
+                size_bytes, channel);
+        return false;
+    }
+    staging->halves[0] = halves;
+    staging->halves[1] = &halves[size_bytes];
+    staging->size = size_bytes;
+    staging->n_bytes = 0;
+    staging->active = 0;
+    staging->n_in_flight = 0;
+    return true;
+}
+
+//! \brief Write the records gathered for a channel to the channel, and
+//!     gather any more in the other half of the staging buffer
+//! \param[in] channel: The channel to write
+static void recording_flush_staged(uint8_t channel) {
+    recording_staging_t *staging = &g_recording_staging[channel];
+    if (staging->n_bytes == 0) {
+        return;
+    }
+
+    // The other half was written a while ago, so is almost always done
+    while (staging->n_in_flight > 0) {
+        spin1_wfi();
+    }
+
+    // The space for these was checked as each record was added, but records
+    // written to the channel directly since may have taken it
+    if (!recording_write_memory(channel, staging->halves[staging->active],
+            staging->n_bytes, NULL, WRITE_STAGED)) {
+        if (!g_recording_channels[channel].missing_info) {
+            log_info("WARNING: recording channel %u out of space", channel);
+            g_recording_channels[channel].missing_info = 1;
+        }
+    }
+    staging->active ^= 1;
+    staging->n_bytes = 0;
+}
+
+//! \brief Gather the parts of a record in the staging buffer of a channel
+//! \param[in] channel: The channel to store the record into, which has a
+//!     staging buffer
+//! \param[in] segments: The parts of the record
+//! \param[in] n_segments: The number of parts
+//! \param[in] size_bytes: The size of the record in bytes
+//! \return True if there was space for the record in the channel
+static bool recording_stage(
+        uint8_t channel, const recording_segment_t *segments,
+        uint32_t n_segments, uint32_t size_bytes) {
+    recording_staging_t *staging = &g_recording_staging[channel];
+
+    // Records gathered but not written yet take space in the channel too
+    bool encoded =
+            g_recording_channels[channel].encoding != RECORDING_ENCODING_NONE;
+    uint32_t stored_bytes = size_bytes;
+    if (encoded) {
+        stored_bytes =
+                recording_encoded_size(segments, n_segments, size_bytes);
+    }
+    uint32_t space_available = compute_available_space_in_channel(channel);
+    if (space_available < staging->n_bytes + stored_bytes) {
+        if (!g_recording_channels[channel].missing_info) {
+            log_info("WARNING: recording channel %u out of space", channel);
+            g_recording_channels[channel].missing_info = 1;
+        }
+        return false;
+    }
+    if (staging->n_bytes + stored_bytes > staging->size) {
+        recording_flush_staged(channel);
+        if (stored_bytes > staging->size) {
+            // Too big to gather; it goes straight to the channel
+            return recording_record_segments(
+                    channel, segments, n_segments, size_bytes, NULL);
+        }
+    }
+    uint8_t *gathered = &staging->halves[staging->active][staging->n_bytes];
+    if (encoded) {
+        // Encoded records are whole words, so this stays word aligned
+        recording_encode(
+                (uint32_t *) gathered, segments, n_segments, size_bytes);
+    } else {
+        for (uint32_t i = 0; i < n_segments; i++) {
+            spin1_memcpy(gathered, segments[i].data, segments[i].size_bytes);
+            gathered += segments[i].size_bytes;
+        }
+    }
+    staging->n_bytes += stored_bytes;
+    return true;
+}
+
+bool recording_record_staged(
+        channel_index_t channel, void *data, size_t size_bytes) {
+    if (!has_been_initialised(channel)) {
+        return false;
+    }
+    if (g_recording_staging[channel].size == 0) {
+        return recording_record(channel, data, size_bytes);
+    }
+    recording_segment_t segment = {.data = data, .size_bytes = size_bytes};
+    return recording_stage(channel, &segment, 1, size_bytes);
+}
+
+bool recording_record_v(
+        channel_index_t channel, const recording_segment_t *segments,
+        uint32_t n_segments, recording_complete_callback_t callback) {
+    uint32_t size_bytes = 0;
+    for (uint32_t i = 0; i < n_segments; i++) {
+        if (callback != NULL && (_not_word_aligned(segments[i].size_bytes) ||
+                _not_word_aligned((uint32_t) segments[i].data))) {
+            recording_bad_offset(segments[i].data, segments[i].size_bytes);
+        }
+        size_bytes += segments[i].size_bytes;
+    }
+
+    if (has_been_initialised(channel) &&
+            g_recording_staging[channel].size > 0) {
+        // Gathered as the records of the channel are, so done at once
+        bool recorded =
+                recording_stage(channel, segments, n_segments, size_bytes);
+        if (callback != NULL) {
+            callback();
+        }
+        return recorded;
+    }
+    return recording_record_segments(
+            channel, segments, n_segments, size_bytes, callback);
+}
+
 __attribute__((noreturn)) void recording_bad_offset(
-	void *data, uint32_t size) {
+	void *data, size_t size) {
     log_error("DMA transfer of non-word data quantity in recording! "
 	    "(data=0x%08x, size=0x%x)", data, size);
     rt_error(RTE_SWERR);
@@ -558,10 +1135,13 @@ static void recording_buffer_state_data_write(void) {
 }
 
 void recording_finalise(void) {
-    uint8_t i;
-
     log_debug("Finalising recording channels");
 
+    // write anything still being gathered
+    for (uint32_t channel = 0; channel < n_recording_regions; channel++) {
+        recording_flush_staged(channel);
+    }
+
     // wait till all DMA's have been finished
     while (circular_buffer_size(dma_complete_buffer) != 0) {
         spin1_wfi();
@@ -574,9 +1154,6 @@ void recording_finalise(void) {
     for (uint32_t channel = 0; channel < n_recording_regions; channel++) {
         // If this channel's in use
         if (has_been_initialised(channel)) {
-            recording_channel_t *recording_channel =
-                    &g_recording_channels[channel];
-
             /* Calculate the number of bytes that have been written and write
              * back to SDRAM counter */
             if (g_recording_channels[channel].missing_info) {
@@ -603,9 +1180,14 @@ static void recording_dma_finished(uint unused, uint tag) {
     uint32_t channel_id;
     uint32_t dma_current_write;
     uint32_t callback_address;
-    circular_buffer_get_next(dma_complete_buffer, &channel_id);
-    circular_buffer_get_next(dma_complete_buffer, &dma_current_write);
-    circular_buffer_get_next(dma_complete_buffer, &callback_address);
+    if (!circular_buffer_get_next(dma_complete_buffer, &channel_id) ||
+            !circular_buffer_get_next(
+                    dma_complete_buffer, &dma_current_write) ||
+            !circular_buffer_get_next(
+                    dma_complete_buffer, &callback_address)) {
+        log_error("DMA complete with no record of the DMA");
+        return;
+    }
 
     recording_complete_callback_t callback =
             (recording_complete_callback_t) callback_address;
@@ -613,6 +1195,9 @@ static void recording_dma_finished(uint unused, uint tag) {
     // update recording region dma_current_write
     g_recording_channels[(uint8_t) channel_id].dma_current_write =
             (uint8_t *) dma_current_write;
+    if (channel_id & STAGED_DMA) {
+        g_recording_staging[(uint8_t) channel_id].n_in_flight--;
+    }
 
     if (callback != NULL) {
         callback();
@@ -633,8 +1218,11 @@ bool recording_initialize(
     uint32_t *sdram_region_sizes =
             (uint32_t *) &sdram_region_ptrs[n_recording_regions];
 
+    // Encodings are after the sizes
+    uint32_t *sdram_region_encodings = &sdram_region_sizes[n_recording_regions];
+
     // Update the pointer to after the data
-    *recording_data_address = &sdram_region_sizes[n_recording_regions];
+    *recording_data_address = &sdram_region_encodings[n_recording_regions];
 
     // build DMA address circular queue
     dma_complete_buffer = circular_buffer_initialize(DMA_QUEUE_SIZE * 4);
@@ -705,6 +1293,32 @@ bool recording_initialize(
         return false;
     }
     log_debug("Allocated recording channels to 0x%08x", g_recording_channels);
+    for (uint32_t i = 0; i < n_recording_regions; i++) {
+        uint32_t encoding = sdram_region_encodings[i];
+        if (encoding > RECORDING_ENCODING_ZERO_WORDS) {
+            log_error("Unknown encoding %u of recording region %u",
+                    encoding, i);
+            return false;
+        }
+        g_recording_channels[i].encoding = encoding;
+    }
+    g_recording_staging =
+            spin1_malloc(n_recording_regions * sizeof(recording_staging_t));
+    if (!g_recording_staging) {
+        log_error("Not enough space to create recording staging buffers");
+        return false;
+    }
+    for (uint32_t i = 0; i < n_recording_regions; i++) {
+        g_recording_staging[i].size = 0;
+        g_recording_staging[i].n_bytes = 0;
+        g_recording_staging[i].n_in_flight = 0;
+    }
+    g_recording_fill =
+            spin1_malloc(n_recording_regions * sizeof(recording_fill_t));
+    if (!g_recording_fill) {
+        log_error("Not enough space to track how fast channels fill");
+        return false;
+    }
 
     // Set up the channels and write the initial state data
     recording_reset();
@@ -770,14 +1384,33 @@ void recording_reset(void) {
             log_info("Recording channel %u left uninitialised", i);
         }
     }
+    for (uint32_t i = 0; i < n_recording_regions; i++) {
+        g_recording_staging[i].n_bytes = 0;
+        g_recording_fill[i].bytes_written = 0;
+        g_recording_fill[i].rate = 0;
+    }
     recording_buffer_state_data_write();
     sequence_number = 0;
     sequence_ack = false;
+    last_time_buffering_trigger = 0;
+    next_trigger_channel = 0;
+    current_time = 0;
+    read_latency = INITIAL_READ_LATENCY << LATENCY_SHIFT;
+    host_reads_queued = 0;
+    read_pending = false;
+    read_request_time = 0;
+    last_fill_time = 0;
 }
 
 void recording_do_timestep_update(uint32_t time) {
+    current_time = time;
+    for (uint32_t channel = 0; channel < n_recording_regions; channel++) {
+        recording_flush_staged(channel);
+    }
+    recording_update_fill_rates(time);
     if (!sequence_ack &&
-            (time - last_time_buffering_trigger > time_between_triggers)) {
+            (time - last_time_buffering_trigger > time_between_triggers ||
+                recording_read_urgent(time))) {
         log_debug("Sending buffering trigger message");
         recording_send_buffering_out_trigger_message(0);
         last_time_buffering_trigger = time;
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Host stand-in for the spinn_common bit_field.h operations used by
+//!     the compressors.
+#ifndef __BIT_FIELD_H__
+#define __BIT_FIELD_H__
+
+#include <common-typedefs.h>
+
+//! A bit field is an array of words
+typedef uint32_t* bit_field_t;
+
+//! \brief Test a bit in a bit field
+//! \param[in] b: The bit field
+//! \param[in] i: The bit to test
+//! \return Whether the bit is set
+static inline bool bit_field_test(bit_field_t b, index_t i) {
+    return (b[i >> 5] & (1u << (i & 0x1F))) != 0;
+}
+
+//! \brief Clear a bit in a bit field
+//! \param[in] b: The bit field
+//! \param[in] i: The bit to clear
+static inline void bit_field_clear(bit_field_t b, index_t i) {
+    b[i >> 5] &= ~(1u << (i & 0x1F));
+}
+
+//! \brief Set a bit in a bit field
+//! \param[in] b: The bit field
+//! \param[in] i: The bit to set
+static inline void bit_field_set(bit_field_t b, index_t i) {
+    b[i >> 5] |= (1u << (i & 0x1F));
+}
+
+//! \brief Clear every bit in a bit field
+//! \param[in] b: The bit field
+//! \param[in] s: The size of the bit field in words
+static inline void clear_bit_field(bit_field_t b, size_t s) {
+    for ( ; s > 0; s--) {
+        b[s - 1] = 0;
+    }
+}
+
+//! \brief Count the set bits in a bit field
+//! \param[in] b: The bit field
+//! \param[in] s: The size of the bit field in words
+//! \return The number of set bits
+static inline counter_t count_bit_field(bit_field_t b, size_t s) {
+    counter_t sum = 0;
+    for ( ; s > 0; s--) {
+        sum += __builtin_popcount(b[s - 1]);
+    }
+    return sum;
+}
+
+//! \brief Get the number of words needed to hold a number of bits
+//! \param[in] bits: The number of bits
+//! \return The number of words
+static inline size_t get_bit_field_size(size_t bits) {
+    return (bits >> 5) + ((bits & 0x1F) != 0);
+}
+
+#endif  // __BIT_FIELD_H__
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Interface of the host library of the bit field router compressor.
+//! \details The library runs the table generator and compressor of the
+//!     bit field compressor binaries on the host, one midpoint at a time,
+//!     for `HostBasedBitFieldRouterCompressor` to call through ctypes. The
+//!     structures passed are those of the SpiNNaker code, laid out the same
+//!     way on the host.
+//!
+//!     The library keeps its state in globals, as the binaries do, so only
+//!     one call may run at a time in a process; the Python side uses a
+//!     pool of processes to compress several chips at once.
+#ifndef __BIT_FIELD_HOST_COMPRESSOR_H__
+#define __BIT_FIELD_HOST_COMPRESSOR_H__
+
+#include <stdint.h>
+#include <filter_info.h>
+#include "common/routing_table.h"
+
+//! Marks the functions the Python binding calls
+#define HOST_COMPRESSOR_API __attribute__((visibility("default")))
+
+//! The version of this interface; change it when the calls or structures do
+#define HOST_COMPRESSOR_VERSION         1
+
+//! The table did not compress to the target length
+#define HOST_COMPRESSOR_FAILED          -1
+
+//! The compressor ran out of memory
+#define HOST_COMPRESSOR_FAILED_MALLOC   -2
+
+//! The time limit was hit without a table short enough to use
+#define HOST_COMPRESSOR_OUT_OF_TIME     -3
+
+//! The inputs were inconsistent or the compressor stopped itself
+#define HOST_COMPRESSOR_BAD_INPUT       -4
+
+//! \brief Get the version of the interface, so the binding can check it
+//!     matches
+//! \return The version of this header
+HOST_COMPRESSOR_API int host_compressor_version(void);
+
+//! \brief Get the name of the compression algorithm built in
+//! \return "pair" or "ordered_covering"
+HOST_COMPRESSOR_API const char *host_compressor_algorithm(void);
+
+//! \brief Merge the first bit fields into a routing table and compress it
+//! \details Does what one compressor core does for one midpoint of the
+//!     sorter's search: the entries of each key with bit fields are replaced
+//!     by entries that only go to the processors that want each atom, and
+//!     the table is compressed until it fits.
+//! \param[in] uncompressed: The entries of the uncompressed table; every
+//!     bit field key must be the key of one of them
+//! \param[in] n_entries: The number of uncompressed entries
+//! \param[in] bit_fields: The bit fields, best first
+//! \param[in] processor_ids: The processor each bit field filters for
+//! \param[in] n_bit_fields: The number of bit fields
+//! \param[in] mid_point: How many of the best bit fields to merge in
+//! \param[in] target_length: The most entries the table may end with
+//! \param[in] time_limit_ms: How long the compressor may run, or 0 for ever
+//! \param[out] compressed: Where to put the compressed entries
+//! \param[in] max_compressed: How many entries compressed can hold
+//! \return The number of compressed entries, or one of the
+//!     `HOST_COMPRESSOR_` failure codes
+HOST_COMPRESSOR_API int host_compressor_run(
+        const entry_t *uncompressed, uint32_t n_entries,
+        const filter_info_t *bit_fields, const int *processor_ids,
+        int n_bit_fields, int mid_point, int target_length,
+        int time_limit_ms, entry_t *compressed, uint32_t max_compressed);
+
+#endif  // __BIT_FIELD_HOST_COMPRESSOR_H__
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Host stand-in for common-typedefs.h without the ARM fixed point
+//!     types, which x86 compilers do not provide.
+#ifndef __COMMON_TYPEDEFS_H__
+#define __COMMON_TYPEDEFS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef use
+//! \brief Mark a variable as used
+//! \param[in] x: The variable
+#define use(x) do {} while ((x)!=(x))
+#endif
+
+//! An index into an array
+typedef uint32_t index_t;
+//! A count of something
+typedef uint32_t counter_t;
+//! A pointer to a word
+typedef uint32_t* address_t;
+
+#endif  // __COMMON_TYPEDEFS_H__
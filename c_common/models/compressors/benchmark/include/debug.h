@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Host stand-in for debug.h; logs straight to stderr.
+//! \details Select the level with `-DLOG_LEVEL=LOG_INFO` etc. The default
+//!     only shows warnings and errors so logging does not skew timings.
+#ifndef __DEBUG_H__
+#define __DEBUG_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+
+//! Logging level for errors
+#define LOG_ERROR       10
+//! Logging level for warnings
+#define LOG_WARNING     20
+//! Logging level for information
+#define LOG_INFO        30
+//! Logging level for debugging
+#define LOG_DEBUG       40
+
+#ifndef LOG_LEVEL
+//! The level of logging actually printed
+#define LOG_LEVEL       LOG_WARNING
+#endif
+
+//! \brief Print a log message if its level is enabled
+//! \param[in] level: The level of the message
+//! \param[in] message: The format of the message
+#define __log_host(level, message, ...) \
+    do {                                                  \
+        if (level <= LOG_LEVEL) {                         \
+            fprintf(stderr, message "\n", ##__VA_ARGS__); \
+        }                                                 \
+    } while (0)
+
+//! Log an error
+#define log_error(message, ...) \
+    __log_host(LOG_ERROR, message, ##__VA_ARGS__)
+//! Log a warning
+#define log_warning(message, ...) \
+    __log_host(LOG_WARNING, message, ##__VA_ARGS__)
+//! Log information
+#define log_info(message, ...) \
+    __log_host(LOG_INFO, message, ##__VA_ARGS__)
+//! Log a debugging message
+#define log_debug(message, ...) \
+    __log_host(LOG_DEBUG, message, ##__VA_ARGS__)
+
+#endif  // __DEBUG_H__
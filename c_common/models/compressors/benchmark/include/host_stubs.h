@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Controls for the host stand-ins of the SpiNNaker runtime.
+//! \details The allocator behind malloc_extras.h counts the bytes it hands
+//!     out so that the peak heap use of a compressor run can be reported,
+//!     and malloc_extras_terminate() jumps back to the benchmark instead of
+//!     ending the process.
+#ifndef __HOST_STUBS_H__
+#define __HOST_STUBS_H__
+
+#include <setjmp.h>
+#include <sark.h>
+
+//! Number of entries in the simulated multicast router
+#define HOST_ROUTER_ENTRIES     1024
+
+//! \brief Set where malloc_extras_terminate() jumps to.
+//! \details The jump delivers the result code plus one, so that
+//!     ::EXITED_CLEANLY can be told apart from the first return of setjmp.
+//! \param[in] target: The jump buffer, or `NULL` to exit the process instead
+void host_stubs_set_terminate_target(jmp_buf *target);
+
+//! \brief Get the bytes currently allocated through malloc_extras.h
+//! \return The live allocation in bytes
+size_t host_stubs_heap_in_use(void);
+
+//! \brief Get the most bytes allocated at once since the last reset
+//! \return The peak allocation in bytes
+size_t host_stubs_heap_peak(void);
+
+//! \brief Restart peak tracking from the current allocation
+void host_stubs_reset_heap_peak(void);
+
+//! \brief Limit the total allocation, to reproduce out-of-memory failures
+//! \param[in] max_bytes: The limit, or 0 for no limit
+void host_stubs_set_heap_limit(size_t max_bytes);
+
+//! \brief Set how many entries the simulated router reports as free
+//! \param[in] n_entries: The value rtr_alloc_max() returns
+void host_stubs_set_router_free(uint n_entries);
+
+//! \brief Get the number of entries written to the simulated router
+//! \return The number of successful rtr_mc_set() calls since the last reset
+uint host_stubs_router_writes(void);
+
+//! \brief Empty the simulated router
+void host_stubs_reset_router(void);
+
+#endif  // __HOST_STUBS_H__
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \dir
+//! \brief Host stand-ins for the SpiNNaker headers used by the compressors
+//! \file
+//! \brief Host stand-in for the parts of SARK used by the compressors.
+//! \details Only what the router compressors reference is provided; the
+//!     router is simulated by host_stubs.c.
+#ifndef __SARK_H__
+#define __SARK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+//! Unsigned integer, as SARK spells it
+typedef unsigned int uint;
+//! Unsigned byte, as SARK spells it
+typedef unsigned char uchar;
+
+#ifndef TRUE
+//! SARK boolean true
+#define TRUE    (0 == 0)
+//! SARK boolean false
+#define FALSE   (0 != 0)
+#endif
+
+//! Software error code for rt_error()
+#define RTE_SWERR       6
+//! Flag to sark_xfree() to lock the heap
+#define ALLOC_LOCK      1
+
+//! Opaque heap; the host allocator in host_stubs.c does not need its layout
+typedef struct heap_t heap_t;
+
+//! Per-core user registers, as visible through the system variables
+typedef struct vcpu_t {
+    uint user0;     //!< User register 0
+    uint user1;     //!< User register 1
+    uint user2;     //!< User register 2
+    uint user3;     //!< User register 3
+} vcpu_t;
+
+//! The subset of the system variables the compressors touch
+typedef struct sv_t {
+    heap_t *sdram_heap;     //!< The shared SDRAM heap
+    uint cpu_clk;           //!< The clock of the cores in MHz
+} sv_t;
+
+//! The system variables
+extern sv_t *sv;
+
+//! \brief The timer registers; the host timer never counts, so anything
+//!     timed with it takes no time
+extern volatile uint tc[];
+
+//! Index of the count register of timer 2
+#define T2_COUNT        9
+//! Index of the control register of timer 2
+#define T2_CONTROL      10
+
+//! The routes of the simulated multicast RAM
+extern uint host_router_routes[];
+//! The keys of the simulated multicast RAM
+extern uint host_router_keys[];
+//! The masks of the simulated multicast RAM
+extern uint host_router_masks[];
+
+//! Where the routes of the multicast RAM are
+#define RTR_MCRAM_BASE  host_router_routes
+//! Where the keys of the multicast RAM are
+#define RTR_MCKEY_BASE  host_router_keys
+//! Where the masks of the multicast RAM are
+#define RTR_MCMASK_BASE host_router_masks
+
+//! \brief Get the number of free router entries
+//! \return The size of the largest block the router can allocate
+uint rtr_alloc_max(void);
+
+//! \brief Allocate a block of router entries
+//! \param[in] size: The number of entries wanted
+//! \param[in] app_id: The application that will own them
+//! \return The index of the first entry, or 0 on failure
+uint rtr_alloc_id(uint size, uint app_id);
+
+//! \brief Write a single multicast router entry
+//! \param[in] entry: The index of the entry
+//! \param[in] key: The routing key
+//! \param[in] mask: The routing mask
+//! \param[in] route: The route word, including the app ID
+//! \return 1 on success, 0 on failure
+uint rtr_mc_set(uint entry, uint key, uint mask, uint route);
+
+//! \brief Free a block in a SARK heap
+//! \param[in] heap: The heap the block came from
+//! \param[in] ptr: The block to free
+//! \param[in] flag: Locking flag
+void sark_xfree(heap_t *heap, void *ptr, uint flag);
+
+#endif  // __SARK_H__
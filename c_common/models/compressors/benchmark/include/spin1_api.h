@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Host stand-in for the parts of spin1_api used by the compressors.
+#ifndef __SPIN1_API_H__
+#define __SPIN1_API_H__
+
+#include <string.h>
+#include <sark.h>
+
+//! Copy memory; there is no DMA engine on the host
+#define spin1_memcpy    memcpy
+
+//! The timer is simulated by the benchmark, so pausing it does nothing
+static inline void spin1_pause(void) {
+}
+
+//! The timer is simulated by the benchmark, so resuming it does nothing
+static inline void spin1_resume(uint sync) {
+    (void) sync;
+}
+
+//! \brief Get the ID of the core running the code
+//! \return Always core 1 on the host
+static inline uint spin1_get_core_id(void) {
+    return 1;
+}
+
+#endif  // __SPIN1_API_H__
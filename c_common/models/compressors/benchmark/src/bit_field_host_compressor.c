@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Host library of the bit field router compressor.
+//!
+//! Built as a shared library with the compressor selected at build time
+//! (`-DUSE_PAIR` for the pair compressor, otherwise ordered covering), and
+//! called through ctypes by `HostBasedBitFieldRouterCompressor`. Each call
+//! does for one midpoint what the sorter and a compressor core do on chip:
+//! sort the table and bit fields by key, generate the bit field entries
+//! with bit_field_table_generator.h and compress them with compressor.h.
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <spin1_api.h>
+#include <debug.h>
+#include <malloc_extras.h>
+#include <host_stubs.h>
+#include <bit_field_host_compressor.h>
+#include "common/constants.h"
+#include "bit_field_common/compressor_sorter_structs.h"
+#include "common/minimise.h"
+#include "compressor_includes/compressor.h"
+#include "bit_field_common/routing_tables.h"
+#include "bit_field_common/routing_tables_utils.h"
+#include "bit_field_common/bit_field_table_generator.h"
+
+#ifdef USE_PAIR
+//! Name of the algorithm built in
+#define ALGORITHM "pair"
+#else
+//! Name of the algorithm built in
+#define ALGORITHM "ordered_covering"
+#endif
+
+//! Milliseconds in a second
+#define MS_PER_S        1000
+
+//! Nanoseconds in a millisecond
+#define NS_PER_MS       1000000
+
+//! Nanoseconds in a second
+#define NS_PER_S        1000000000
+
+//! Set by the time limit thread, as the timer tick does on chip
+static volatile bool stop_compressing = false;
+
+//! Set by the compressor if an allocation failed
+static bool failed_by_malloc = false;
+
+//! Where a compressor calling malloc_extras_terminate() returns to
+static jmp_buf terminate_target;
+
+//! Guards ::run_finished
+static pthread_mutex_t time_limit_lock = PTHREAD_MUTEX_INITIALIZER;
+
+//! Signalled when the run finishes before the time limit
+static pthread_cond_t time_limit_cancel = PTHREAD_COND_INITIALIZER;
+
+//! Whether the run has finished, so the time limit is not needed
+static bool run_finished = false;
+
+//! \brief Wait for the time limit and then ask the compressor to stop
+//! \param[in] arg: Points to the time limit in milliseconds
+//! \return Nothing
+static void *time_limit_thread(void *arg) {
+    int time_limit_ms = *((int *) arg);
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += time_limit_ms / MS_PER_S;
+    deadline.tv_nsec += (time_limit_ms % MS_PER_S) * NS_PER_MS;
+    if (deadline.tv_nsec >= NS_PER_S) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= NS_PER_S;
+    }
+
+    pthread_mutex_lock(&time_limit_lock);
+    while (!run_finished) {
+        if (pthread_cond_timedwait(&time_limit_cancel, &time_limit_lock,
+                &deadline) == ETIMEDOUT) {
+            stop_compressing = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&time_limit_lock);
+    return NULL;
+}
+
+//! \brief Order entries by key, as sort_table_by_key() does on chip
+//! \param[in] a: The first entry
+//! \param[in] b: The second entry
+//! \return Negative, zero or positive as a is before, with or after b
+static int compare_entry_keys(const void *a, const void *b) {
+    uint32_t key_a = ((const entry_t *) a)->key_mask.key;
+    uint32_t key_b = ((const entry_t *) b)->key_mask.key;
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+//! The bit fields being sorted by compare_bit_field_keys()
+static const filter_info_t *sorting_bit_fields;
+
+//! \brief Order the indices of bit fields by key, as sort_by_key() does in
+//!     the sorter
+//! \details The sorter's heapsort leaves bit fields with the same key in
+//!     any order, which is fine as they are only ever used together; here
+//!     they are put in order of rank only so that runs are repeatable.
+//! \param[in] a: The first index
+//! \param[in] b: The second index
+//! \return Negative, zero or positive as a is before, with or after b
+static int compare_bit_field_keys(const void *a, const void *b) {
+    int index_a = *((const int *) a);
+    int index_b = *((const int *) b);
+    uint32_t key_a = sorting_bit_fields[index_a].key;
+    uint32_t key_b = sorting_bit_fields[index_b].key;
+    if (key_a != key_b) {
+        return (key_a > key_b) - (key_a < key_b);
+    }
+    return index_a - index_b;
+}
+
+//! \brief Build the sorted bit fields the table generator works from
+//! \param[in] table: The uncompressed table, sorted by key
+//! \param[in] bit_fields: The bit fields, best first
+//! \param[in] processor_ids: The processor of each bit field
+//! \param[out] sorted: The bit fields by key, with their rank as sort order;
+//!     the arrays are allocated here
+//! \return Whether there was memory and every bit field has a table entry
+static bool sort_bit_fields(
+        const table_t *table, const filter_info_t *bit_fields,
+        const int *processor_ids, sorted_bit_fields_t *sorted) {
+    int n_bit_fields = sorted->n_bit_fields;
+    int n = (n_bit_fields > 0) ? n_bit_fields : 1;
+    sorted->sort_order = MALLOC(n * sizeof(int));
+    sorted->processor_ids = MALLOC(n * sizeof(int));
+    sorted->bit_fields = MALLOC(n * sizeof(filter_info_t *));
+    sorted->n_redundant_packets = NULL;
+    if (sorted->sort_order == NULL || sorted->processor_ids == NULL ||
+            sorted->bit_fields == NULL) {
+        log_error("failed to allocate memory for %d bit fields",
+                n_bit_fields);
+        return false;
+    }
+
+    for (int i = 0; i < n_bit_fields; i++) {
+        sorted->sort_order[i] = i;
+    }
+    sorting_bit_fields = bit_fields;
+    qsort(sorted->sort_order, n_bit_fields, sizeof(int),
+            compare_bit_field_keys);
+
+    // The generator only moves on to the next bit field when it reaches an
+    // entry with its key, so every key must have an entry
+    uint32_t rt_i = 0;
+    for (int i = 0; i < n_bit_fields; i++) {
+        int rank = sorted->sort_order[i];
+        uint32_t key = bit_fields[rank].key;
+        while (rt_i < table->size && table->entries[rt_i].key_mask.key < key) {
+            rt_i++;
+        }
+        if (rt_i == table->size || table->entries[rt_i].key_mask.key != key) {
+            log_error("bit field key 0x%08x has no routing table entry", key);
+            return false;
+        }
+        sorted->bit_fields[i] = (filter_info_t *) &bit_fields[rank];
+        sorted->processor_ids[i] = processor_ids[rank];
+    }
+    return true;
+}
+
+//! \brief Free what sort_bit_fields() allocated
+//! \param[in] sorted: The sorted bit fields to free the arrays of
+static void free_sorted_bit_fields(sorted_bit_fields_t *sorted) {
+    FREE(sorted->sort_order);
+    FREE(sorted->processor_ids);
+    FREE(sorted->bit_fields);
+}
+
+//! \brief Compress the routing table, stopping at the time limit
+//! \param[in] target_length: The most entries the table may end with
+//! \param[in] time_limit_ms: The time limit, or 0 for none
+//! \return The number of entries compressed to, or a failure code
+static int compress_with_time_limit(int target_length, int time_limit_ms) {
+    host_stubs_set_router_free(target_length);
+    stop_compressing = false;
+    failed_by_malloc = false;
+    minimise_best_length = FAILED_TO_FIND;
+
+    pthread_t timer;
+    run_finished = false;
+    bool timed = (time_limit_ms > 0) &&
+            (pthread_create(&timer, NULL, time_limit_thread,
+            &time_limit_ms) == 0);
+
+    host_stubs_set_terminate_target(&terminate_target);
+    int terminated = setjmp(terminate_target);
+    bool success = false;
+    if (!terminated) {
+        success = run_compressor(false, &failed_by_malloc, &stop_compressing);
+    }
+    host_stubs_set_terminate_target(NULL);
+
+    if (timed) {
+        pthread_mutex_lock(&time_limit_lock);
+        run_finished = true;
+        pthread_cond_signal(&time_limit_cancel);
+        pthread_mutex_unlock(&time_limit_lock);
+        pthread_join(timer, NULL);
+    }
+
+    int n_entries = routing_table_get_n_entries();
+    if (terminated) {
+        return HOST_COMPRESSOR_BAD_INPUT;
+    } else if (success) {
+        return n_entries;
+    } else if (failed_by_malloc) {
+        return HOST_COMPRESSOR_FAILED_MALLOC;
+    } else if (stop_compressing) {
+        // What was compressed may be good enough, as in the sorter
+        if ((minimise_best_length == n_entries) &&
+                (n_entries <= target_length)) {
+            return n_entries;
+        }
+        return HOST_COMPRESSOR_OUT_OF_TIME;
+    }
+    return HOST_COMPRESSOR_FAILED;
+}
+
+HOST_COMPRESSOR_API int host_compressor_version(void) {
+    return HOST_COMPRESSOR_VERSION;
+}
+
+HOST_COMPRESSOR_API const char *host_compressor_algorithm(void) {
+    return ALGORITHM;
+}
+
+HOST_COMPRESSOR_API int host_compressor_run(
+        const entry_t *uncompressed, uint32_t n_entries,
+        const filter_info_t *bit_fields, const int *processor_ids,
+        int n_bit_fields, int mid_point, int target_length,
+        int time_limit_ms, entry_t *compressed, uint32_t max_compressed) {
+    if (mid_point < 0 || mid_point > n_bit_fields || n_bit_fields < 0 ||
+            target_length < 0) {
+        log_error("bad mid point %d of %d bit fields or target length %d",
+                mid_point, n_bit_fields, target_length);
+        return HOST_COMPRESSOR_BAD_INPUT;
+    }
+
+    // The sorter keeps the uncompressed table in key order
+    table_t *table = MALLOC(sizeof(table_t) + n_entries * sizeof(entry_t));
+    if (table == NULL) {
+        log_error("failed to allocate memory for %u entries", n_entries);
+        return HOST_COMPRESSOR_FAILED_MALLOC;
+    }
+    table->size = n_entries;
+    memcpy(table->entries, uncompressed, n_entries * sizeof(entry_t));
+    qsort(table->entries, n_entries, sizeof(entry_t), compare_entry_keys);
+
+    sorted_bit_fields_t sorted = {.n_bit_fields = n_bit_fields};
+    int result = HOST_COMPRESSOR_BAD_INPUT;
+    multi_table_t tables = {.n_sub_tables = 0};
+    if (!sort_bit_fields(table, bit_fields, processor_ids, &sorted)) {
+        goto finished;
+    }
+
+    // As on chip, a table there is not the memory for whole is made an
+    // original entry at a time, merging as it goes
+    uint32_t max_size = bit_field_table_generator_max_size(
+            mid_point, table, &sorted);
+    if (!routing_tables_utils_malloc(
+            &tables, (max_size > 0) ? max_size : 1)) {
+        if (!bit_field_table_generator_stream_start(
+                mid_point, table, &sorted)) {
+            result = HOST_COMPRESSOR_FAILED_MALLOC;
+            goto finished;
+        }
+        max_size = bit_field_table_generator_streamed_size(
+                mid_point, table, &sorted);
+        if (!routing_tables_utils_malloc(
+                &tables, (max_size > 0) ? max_size : 1)) {
+            result = HOST_COMPRESSOR_FAILED_MALLOC;
+            goto finished;
+        }
+    }
+    routing_tables_init(&tables);
+    bit_field_table_generator_create_bit_field_router_tables(
+            mid_point, table, &sorted);
+    bit_field_table_generator_stream_end();
+#ifndef USE_PAIR
+    bit_field_table_generator_sort_by_generality();
+#endif
+
+    result = compress_with_time_limit(target_length, time_limit_ms);
+    if (result > (int) max_compressed) {
+        log_error("%d compressed entries do not fit in space for %u",
+                result, max_compressed);
+        result = HOST_COMPRESSOR_BAD_INPUT;
+    }
+    for (int i = 0; i < result; i++) {
+        compressed[i] = *routing_table_get_entry(i);
+    }
+
+finished:
+    bit_field_table_generator_stream_end();
+    routing_tables_utils_free_all(&tables);
+    free_sorted_bit_fields(&sorted);
+    FREE(table);
+    return result;
+}
@@ -0,0 +1,498 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \dir
+//! \brief Host-native build and benchmark of the on-chip router compressors
+//! \file
+//! \brief Benchmark of a router compressor built for the host.
+//!
+//! Runs the compressor selected at build time (`-DUSE_PAIR` for the pair
+//! compressor, `-DUSE_ADAPTIVE` for pair then ordered covering if needed,
+//! otherwise ordered covering) over each routing table given,
+//! exactly as the simple compressor binaries would on chip, and reports the
+//! wall time, the final number of entries and the peak heap use.
+//!
+//! Tables are read from files holding the same image that
+//! `Compression._build_data()` writes to SDRAM for the simple compressors:
+//! a header_t (app ID, compress as much as possible flag, table size)
+//! followed by that many entry_t (key, mask, route, source), all as
+//! little-endian words. Synthetic tables can be generated with `-s`.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <spin1_api.h>
+#include <debug.h>
+#include <malloc_extras.h>
+#include <host_stubs.h>
+#include "compressor_includes/compressor.h"
+#include "compressor_includes/table_partition.h"
+#include "simple/rt_single.h"
+
+#if defined(USE_ADAPTIVE)
+//! Name of the algorithm under test
+#define ALGORITHM "adaptive"
+#elif defined(USE_PAIR)
+//! Name of the algorithm under test
+#define ALGORITHM "pair"
+#else
+//! Name of the algorithm under test
+#define ALGORITHM "ordered_covering"
+#endif
+
+//! Number of distinct route words used by synthetic tables
+#define SYNTHETIC_ROUTES        64
+
+//! Most routes a single synthetic population uses
+#define ROUTES_PER_POPULATION   4
+
+//! Bits of key space given to each synthetic population
+#define POPULATION_KEY_BITS     11
+
+//! Link bits of a route word
+#define LINK_BITS               6
+
+//! Processor bits of a route word, after the links
+#define PROCESSOR_BITS          18
+
+//! Milliseconds in a second
+#define MS_PER_S                1000.0
+
+//! Nanoseconds in a millisecond
+#define NS_PER_MS               1000000.0
+
+//! The outcome of one compression run
+typedef enum run_outcome {
+    //! The table was compressed to fit the router
+    RUN_OK,
+    //! No more merges were possible and the table still does not fit
+    RUN_FAILED,
+    //! A memory allocation failed
+    RUN_FAILED_MALLOC,
+    //! The time limit was hit
+    RUN_OUT_OF_TIME,
+    //! The time limit was hit but the table left is usable
+    RUN_PARTIAL,
+    //! The compressor called malloc_extras_terminate()
+    RUN_TERMINATED
+} run_outcome;
+
+//! Printable names of ::run_outcome
+static const char *outcome_names[] = {
+    "ok", "failed", "failed_malloc", "out_of_time", "partial", "terminated"
+};
+
+//! The measurements of a single run
+typedef struct run_result_t {
+    //! How the run ended
+    run_outcome outcome;
+    //! Number of entries left in the table
+    int final_size;
+    //! Wall time of the run in milliseconds
+    double time_ms;
+    //! Most bytes allocated by the compressor, excluding the table itself
+    size_t peak_heap;
+} run_result_t;
+
+//! Set by the interval timer, as the timer tick does on chip
+static volatile bool stop_compressing = false;
+
+//! Set by the compressor if an allocation failed
+static bool failed_by_malloc = false;
+
+//! Where a compressor calling malloc_extras_terminate() returns to
+static jmp_buf terminate_target;
+
+//! Seed for synthetic tables; any non-zero value will do
+static uint32_t seed = 1;
+
+//! State of the synthetic table generator
+static uint32_t random_state;
+
+//! \brief Get the next pseudo-random number (xorshift32)
+//! \return A 32-bit pseudo-random number
+static uint32_t next_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+//! \brief Signal handler for the time limit
+//! \param[in] signal: unused
+static void time_limit_reached(int signal) {
+    use(signal);
+    stop_compressing = true;
+}
+
+//! \brief Arm or disarm the time limit
+//! \param[in] time_limit_ms: The limit, or 0 to disarm
+static void set_time_limit(int time_limit_ms) {
+    struct itimerval timer = {{0, 0}, {0, 0}};
+    timer.it_value.tv_sec = time_limit_ms / 1000;
+    timer.it_value.tv_usec = (time_limit_ms % 1000) * 1000;
+    setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+//! \brief Get the monotonic time
+//! \return The time in milliseconds from an arbitrary start
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * MS_PER_S + ts.tv_nsec / NS_PER_MS;
+}
+
+//! \brief Read a table image from a file
+//! \param[in] filename: The file to read
+//! \return The table image, or `NULL` if the file is not a table image
+static header_t *read_table_file(const char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL) {
+        perror(filename);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long n_bytes = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    header_t *header = NULL;
+    if (n_bytes >= (long) sizeof(header_t)) {
+        header = malloc(n_bytes);
+    }
+    if (header == NULL || fread(header, 1, n_bytes, f) != (size_t) n_bytes) {
+        fprintf(stderr, "%s: cannot read table\n", filename);
+        free(header);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+
+    if (sizeof(header_t) + header->table_size * sizeof(entry_t)
+            != (size_t) n_bytes) {
+        fprintf(stderr, "%s: size %u does not match file length %ld\n",
+                filename, header->table_size, n_bytes);
+        free(header);
+        return NULL;
+    }
+    return header;
+}
+
+//! \brief Make a synthetic table that looks like a bit-field expanded one
+//! \details Populations get their own aligned block of keys. A quarter are
+//!     routed by one entry for the whole block; the rest have one entry per
+//!     atom, each taking one of a few routes, as bit-field tables do.
+//!     The table depends only on the seed and the size.
+//! \param[in] n_entries: The number of entries wanted
+//! \return The table image
+static header_t *synthetic_table(uint32_t n_entries) {
+    random_state = seed + n_entries;
+    header_t *header = malloc(sizeof(header_t) + n_entries * sizeof(entry_t));
+    if (header == NULL) {
+        return NULL;
+    }
+    header->app_id = 0;
+    header->compress_as_much_as_possible = 0;
+    header->table_size = n_entries;
+
+    uint32_t routes[SYNTHETIC_ROUTES];
+    for (int i = 0; i < SYNTHETIC_ROUTES; i++) {
+        routes[i] = (1 << (next_random() % LINK_BITS)) |
+                ((next_random() & ((1 << PROCESSOR_BITS) - 1)) << LINK_BITS);
+    }
+
+    uint32_t entry = 0;
+    for (uint32_t pop = 0; entry < n_entries; pop++) {
+        uint32_t base = pop << POPULATION_KEY_BITS;
+        uint32_t pop_routes[ROUTES_PER_POPULATION];
+        for (int i = 0; i < ROUTES_PER_POPULATION; i++) {
+            pop_routes[i] = routes[next_random() % SYNTHETIC_ROUTES];
+        }
+
+        if (next_random() % 4 == 0) {
+            // One entry for the whole population; single link routes can
+            // come from the opposite link so they can be defaulted
+            uint32_t link = next_random() % LINK_BITS;
+            entry_t *e = &header->entries[entry++];
+            e->key_mask.key = base;
+            e->key_mask.mask = ~((1 << POPULATION_KEY_BITS) - 1);
+            e->route = (next_random() % 2) ? (1 << link) : pop_routes[0];
+            e->source = 1 << ((link + 3) % LINK_BITS);
+            continue;
+        }
+
+        // Most atoms are wanted by every target core, so take the first
+        // route half of the time
+        uint32_t n_atoms = 16 + next_random() % 240;
+        for (uint32_t atom = 0; atom < n_atoms && entry < n_entries; atom++) {
+            uint32_t r = next_random() % (2 * ROUTES_PER_POPULATION);
+            entry_t *e = &header->entries[entry++];
+            e->key_mask.key = base + atom;
+            e->key_mask.mask = 0xFFFFFFFF;
+            e->route = pop_routes[(r < ROUTES_PER_POPULATION) ? 0 : r & 3];
+            e->source = 0;
+        }
+    }
+
+    // Ordered covering expects the table in order of generality, so move the
+    // whole-population entries after the per-atom ones
+    uint32_t write = 0;
+    entry_t *entries = header->entries;
+    for (uint32_t read = 0; read < n_entries; read++) {
+        if (entries[read].key_mask.mask == 0xFFFFFFFF) {
+            entry_t temp = entries[read];
+            memmove(&entries[write + 1], &entries[write],
+                    (read - write) * sizeof(entry_t));
+            entries[write++] = temp;
+        }
+    }
+    return header;
+}
+
+//! \brief Run the compressor once over a table image
+//! \param[in] header: The table image
+//! \param[in] compress_as_much_as_possible: Whether to go past the router size
+//! \param[in] time_limit_ms: The time limit, or 0 for none
+//! \param[in] partition: The partition of the table to compress
+//! \param[in] n_partitions: How many cores the table is split over, as the
+//!     bit field compressors do when sharing a table; 1 for the whole table
+//! \param[out] result: The measurements
+static void run_once(
+        header_t *header, int compress_as_much_as_possible,
+        int time_limit_ms, int partition, int n_partitions,
+        run_result_t *result) {
+    // The table copy belongs to the input, not to the compressor
+    read_table(header);
+    host_stubs_reset_heap_peak();
+    size_t table_bytes = host_stubs_heap_in_use();
+
+    stop_compressing = false;
+    failed_by_malloc = false;
+    host_stubs_set_terminate_target(&terminate_target);
+
+    set_time_limit(time_limit_ms);
+    volatile double start = now_ms();
+    int terminated = setjmp(terminate_target);
+    bool success = false;
+    if (!terminated) {
+        table_partition_keep(partition, n_partitions);
+        success = run_compressor(compress_as_much_as_possible,
+                &failed_by_malloc, &stop_compressing);
+    }
+    double end = now_ms();
+    set_time_limit(0);
+    host_stubs_set_terminate_target(NULL);
+
+    result->time_ms = end - start;
+    result->final_size = routing_table_get_n_entries();
+    result->peak_heap = host_stubs_heap_peak() - table_bytes;
+    if (terminated) {
+        result->outcome = RUN_TERMINATED;
+    } else if (success) {
+        result->outcome = RUN_OK;
+    } else if (failed_by_malloc) {
+        result->outcome = RUN_FAILED_MALLOC;
+    } else if (stop_compressing &&
+            (minimise_best_length == result->final_size)) {
+        result->outcome = RUN_PARTIAL;
+    } else if (stop_compressing) {
+        result->outcome = RUN_OUT_OF_TIME;
+    } else {
+        result->outcome = RUN_FAILED;
+    }
+    FREE(table);
+}
+
+//! \brief Run the compressor over each partition of a table in turn
+//! \details The partitions would run at the same time on different cores,
+//!     so the time is that of the slowest and the size is the total.
+//! \param[in] header: The table image
+//! \param[in] compress_as_much_as_possible: Whether to go past the router size
+//! \param[in] time_limit_ms: The time limit, or 0 for none
+//! \param[in] n_partitions: How many cores the table is split over
+//! \param[out] result: The combined measurements
+static void run_partitions(
+        header_t *header, int compress_as_much_as_possible,
+        int time_limit_ms, int n_partitions, run_result_t *result) {
+    run_result_t part;
+    run_once(header, compress_as_much_as_possible, time_limit_ms,
+            0, n_partitions, result);
+    for (int p = 1; p < n_partitions; p++) {
+        run_once(header, compress_as_much_as_possible, time_limit_ms,
+                p, n_partitions, &part);
+        result->final_size += part.final_size;
+        if (part.time_ms > result->time_ms) {
+            result->time_ms = part.time_ms;
+        }
+        if (part.peak_heap > result->peak_heap) {
+            result->peak_heap = part.peak_heap;
+        }
+        if (result->outcome == RUN_OK) {
+            result->outcome = part.outcome;
+        }
+    }
+    if (result->outcome == RUN_OK &&
+            result->final_size > (int) rtr_alloc_max()) {
+        result->outcome = RUN_FAILED;
+    }
+}
+
+//! \brief Benchmark one table and print a line of results
+//! \param[in] name: The name to report the table under
+//! \param[in] header: The table image
+//! \param[in] force_as_much: Compress as much as possible whatever the image
+//!     says
+//! \param[in] repeats: How many times to run
+//! \param[in] time_limit_ms: The time limit per run, or 0 for none
+//! \param[in] n_partitions: How many cores to split the table over; the
+//!     time reported is that of the slowest
+//! \return Whether every run compressed the table to fit the router
+static bool benchmark_table(
+        const char *name, header_t *header, bool force_as_much, int repeats,
+        int time_limit_ms, int n_partitions) {
+    // Shared tables are compressed as much as possible, as each part
+    // only has to fit together with the others
+    int as_much = force_as_much || header->compress_as_much_as_possible ||
+            n_partitions > 1;
+    run_result_t result;
+    double best_ms = 0.0;
+    double total_ms = 0.0;
+    size_t peak_heap = 0;
+    bool all_ok = true;
+
+    for (int i = 0; i < repeats; i++) {
+        run_partitions(header, as_much, time_limit_ms, n_partitions, &result);
+        if (i == 0 || result.time_ms < best_ms) {
+            best_ms = result.time_ms;
+        }
+        total_ms += result.time_ms;
+        if (result.peak_heap > peak_heap) {
+            peak_heap = result.peak_heap;
+        }
+        all_ok = all_ok && (result.outcome == RUN_OK);
+    }
+
+    printf("%-24s %-16s %8u %8d %12.3f %12.3f %12zu %s\n",
+            name, ALGORITHM, header->table_size, result.final_size,
+            best_ms, total_ms / repeats, peak_heap,
+            outcome_names[result.outcome]);
+    fflush(stdout);
+    return all_ok;
+}
+
+//! \brief Print how to use the benchmark
+//! \param[in] program: The name of the program
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [-a] [-r repeats] [-t time_limit_ms] [-m heap_bytes]\n"
+            "       [-f router_free] [-p n_cores] [-S seed] "
+            "[-s n_entries]... [table_file]...\n"
+            "  -a  compress as much as possible, whatever the table says\n"
+            "  -r  runs per table; the best and mean times are reported\n"
+            "  -t  stop each run after this long, as the on-chip timer does\n"
+            "  -m  fail allocations beyond this many bytes\n"
+            "  -f  free router entries to report (default %u)\n"
+            "  -p  split each table over this many cores, as the bit field\n"
+            "      compressors do when they share a table\n"
+            "  -S  seed for synthetic tables\n"
+            "  -s  benchmark a synthetic table of this many entries\n",
+            program, rtr_alloc_max());
+}
+
+//! \brief Run the benchmark over the tables given on the command line
+//! \param[in] argc: Number of arguments
+//! \param[in] argv: The arguments
+//! \return 0 if every table compressed to fit the router, 1 if not, 2 on
+//!     bad arguments
+int main(int argc, char *argv[]) {
+    bool force_as_much = false;
+    int repeats = 1;
+    int time_limit_ms = 0;
+    int n_partitions = 1;
+    uint32_t synthetic_sizes[argc];
+    int n_synthetic = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "ar:t:m:f:p:S:s:")) != -1) {
+        switch (opt) {
+        case 'a':
+            force_as_much = true;
+            break;
+        case 'r':
+            repeats = atoi(optarg);
+            break;
+        case 't':
+            time_limit_ms = atoi(optarg);
+            break;
+        case 'm':
+            host_stubs_set_heap_limit(strtoul(optarg, NULL, 0));
+            break;
+        case 'f':
+            host_stubs_set_router_free(strtoul(optarg, NULL, 0));
+            break;
+        case 'p':
+            n_partitions = atoi(optarg);
+            break;
+        case 'S':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            synthetic_sizes[n_synthetic++] = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (repeats < 1 || seed == 0 || n_partitions < 1 ||
+            n_partitions > TABLE_PARTITION_MAX ||
+            (optind == argc && n_synthetic == 0)) {
+        usage(argv[0]);
+        return 2;
+    }
+    signal(SIGALRM, time_limit_reached);
+
+    printf("%-24s %-16s %8s %8s %12s %12s %12s %s\n",
+            "table", "algorithm", "entries", "final", "best_ms", "mean_ms",
+            "peak_heap", "result");
+    bool all_ok = true;
+    for (int i = 0; i < n_synthetic; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "synthetic_%u", synthetic_sizes[i]);
+        header_t *header = synthetic_table(synthetic_sizes[i]);
+        if (header == NULL) {
+            return 2;
+        }
+        all_ok &= benchmark_table(
+                name, header, force_as_much, repeats, time_limit_ms,
+                n_partitions);
+        free(header);
+    }
+    for (int i = optind; i < argc; i++) {
+        header_t *header = read_table_file(argv[i]);
+        if (header == NULL) {
+            return 2;
+        }
+        all_ok &= benchmark_table(
+                argv[i], header, force_as_much, repeats, time_limit_ms,
+                n_partitions);
+        free(header);
+    }
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Host implementations of the SARK and malloc_extras functions that
+//!     the router compressors call.
+#include <stdlib.h>
+#include <debug.h>
+#include <malloc_extras.h>
+#include <host_stubs.h>
+
+//! \brief Header stored in front of every block so frees can be counted
+typedef union block_header_t {
+    //! Size of the user part of the block in bytes
+    size_t size;
+    //! Keeps the user part aligned as malloc would
+    long double align;
+} block_header_t;
+
+//! Bytes currently handed out
+static size_t heap_in_use = 0;
+
+//! Most bytes handed out at once since the last reset
+static size_t heap_peak = 0;
+
+//! Allocation limit, or 0 if unlimited
+static size_t heap_limit = 0;
+
+//! Where malloc_extras_terminate() jumps to
+static jmp_buf *terminate_target = NULL;
+
+//! What rtr_alloc_max() reports
+static uint router_free = HOST_ROUTER_ENTRIES - 1;
+
+//! Count of entries written by rtr_mc_set()
+static uint router_writes = 0;
+
+//! The simulated timers
+volatile uint tc[16];
+
+//! The routes of the simulated router multicast RAM
+uint host_router_routes[HOST_ROUTER_ENTRIES];
+
+//! The keys of the simulated router multicast RAM
+uint host_router_keys[HOST_ROUTER_ENTRIES];
+
+//! The masks of the simulated router multicast RAM
+uint host_router_masks[HOST_ROUTER_ENTRIES];
+
+//! No SDRAM heap exists on the host; sark_xfree() ignores the heap argument
+static sv_t host_sv = {NULL, 200};
+
+sv_t *sv = &host_sv;
+
+void host_stubs_set_terminate_target(jmp_buf *target) {
+    terminate_target = target;
+}
+
+size_t host_stubs_heap_in_use(void) {
+    return heap_in_use;
+}
+
+size_t host_stubs_heap_peak(void) {
+    return heap_peak;
+}
+
+void host_stubs_reset_heap_peak(void) {
+    heap_peak = heap_in_use;
+}
+
+void host_stubs_set_heap_limit(size_t max_bytes) {
+    heap_limit = max_bytes;
+}
+
+void host_stubs_set_router_free(uint n_entries) {
+    router_free = n_entries;
+}
+
+uint host_stubs_router_writes(void) {
+    return router_writes;
+}
+
+void host_stubs_reset_router(void) {
+    router_writes = 0;
+}
+
+//! \brief Allocate and count a block
+//! \param[in] bytes: The number of bytes wanted
+//! \return The block, or `NULL` if over the limit or out of memory
+static void *counted_malloc(uint bytes) {
+    if (heap_limit != 0 && heap_in_use + bytes > heap_limit) {
+        return NULL;
+    }
+    block_header_t *block = malloc(sizeof(block_header_t) + bytes);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->size = bytes;
+    heap_in_use += bytes;
+    if (heap_in_use > heap_peak) {
+        heap_peak = heap_in_use;
+    }
+    return &block[1];
+}
+
+//! \brief Free a block allocated by counted_malloc()
+//! \param[in] ptr: The block
+static void counted_free(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    block_header_t *block = &((block_header_t *) ptr)[-1];
+    heap_in_use -= block->size;
+    free(block);
+}
+
+//=============================================================================
+// malloc_extras.h
+
+void malloc_extras_turn_off_safety(void) {
+}
+
+void malloc_extras_turn_on_print(void) {
+}
+
+void malloc_extras_turn_off_print(void) {
+}
+
+heap_t *malloc_extras_get_stolen_heap(void) {
+    return NULL;
+}
+
+void malloc_extras_terminate(uint result_code) {
+    if (terminate_target == NULL) {
+        exit(result_code);
+    }
+    longjmp(*terminate_target, result_code + 1);
+}
+
+bool malloc_extras_check(void *ptr) {
+    use(ptr);
+    return true;
+}
+
+void malloc_extras_check_all_marked(int marker) {
+    use(marker);
+}
+
+void malloc_extras_check_all(void) {
+}
+
+bool malloc_extras_initialise_with_fake_heap(heap_t *heap_location) {
+    use(heap_location);
+    return true;
+}
+
+bool malloc_extras_initialise_and_build_fake_heap(
+        available_sdram_blocks *sizes_region) {
+    use(sizes_region);
+    return true;
+}
+
+bool malloc_extras_initialise_no_fake_heap_data(void) {
+    return true;
+}
+
+void malloc_extras_free_marked(void *ptr, int marker) {
+    use(marker);
+    counted_free(ptr);
+}
+
+void malloc_extras_free(void *ptr) {
+    counted_free(ptr);
+}
+
+void *malloc_extras_sdram_malloc_wrapper(uint bytes) {
+    return counted_malloc(bytes);
+}
+
+void *malloc_extras_malloc(uint bytes) {
+    return counted_malloc(bytes);
+}
+
+uint malloc_extras_max_available_block_size(void) {
+    if (heap_limit == 0) {
+        return 0xFFFFFFFF;
+    }
+    return heap_limit - heap_in_use;
+}
+
+//=============================================================================
+// sark.h
+
+uint rtr_alloc_max(void) {
+    return router_free;
+}
+
+uint rtr_alloc_id(uint size, uint app_id) {
+    use(app_id);
+    if (size > router_free) {
+        return 0;
+    }
+    // Entry 0 is where SARK keeps its own route, so blocks start at 1
+    return 1;
+}
+
+uint rtr_mc_set(uint entry, uint key, uint mask, uint route) {
+    if (entry >= HOST_ROUTER_ENTRIES) {
+        return 0;
+    }
+    host_router_routes[entry] = route;
+    host_router_keys[entry] = key;
+    host_router_masks[entry] = mask;
+    router_writes++;
+    return 1;
+}
+
+void sark_xfree(heap_t *heap, void *ptr, uint flag) {
+    use(heap);
+    use(flag);
+    counted_free(ptr);
+}
@@ -0,0 +1,30 @@
+# Copyright (c) 2020 The University of Manchester
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+APP = bit_field_adaptive_compressor
+
+SOURCES = bit_field_compressor.c
+
+FEC_OPT = $(OSPACE)
+
+include ../fec_models.mk
+
+CFLAGS += -DUSE_ADAPTIVE
+
+# No bounds checks on routing table lookups in the compressor inner loops,
+# unless built with ROUTING_TABLES_CHECKED set; see "make checked"
+ifndef ROUTING_TABLES_CHECKED
+    CFLAGS += -DROUTING_TABLES_UNCHECKED
+endif
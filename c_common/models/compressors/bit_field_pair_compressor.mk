@@ -21,4 +21,10 @@ FEC_OPT = $(OSPACE)
 
 include ../fec_models.mk
 
-CFLAGS += -DUSE_PAIR
\ No newline at end of file
+CFLAGS += -DUSE_PAIR
+
+# No bounds checks on routing table lookups in the compressor inner loops,
+# unless built with ROUTING_TABLES_CHECKED set; see "make checked"
+ifndef ROUTING_TABLES_CHECKED
+    CFLAGS += -DROUTING_TABLES_UNCHECKED
+endif
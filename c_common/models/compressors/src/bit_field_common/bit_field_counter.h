@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Word at a time access to the atoms of a bitfield.
+//! \details A bitfield holds one bit per atom, 32 to a word. Only the atoms
+//!     of the filter are meaningful; the bits after them in the last word
+//!     are masked off so they are never counted or routed.
+#ifndef __BIT_FIELD_COUNTER_H__
+#define __BIT_FIELD_COUNTER_H__
+
+#include <bit_field.h>
+#include <filter_info.h>
+
+//! The number of atoms held in each word of a bitfield
+#define ATOMS_PER_WORD 32
+
+//! \brief Get the number of words that hold the atoms of a filter
+//! \param[in] n_atoms: The number of atoms in the filter
+//! \return The number of words
+static inline uint32_t bit_field_counter_n_words(uint32_t n_atoms) {
+    return (n_atoms + ATOMS_PER_WORD - 1) / ATOMS_PER_WORD;
+}
+
+//! \brief Get a word of a bitfield with the bits past the last atom cleared
+//! \param[in] data: The words of the bitfield
+//! \param[in] word: The index of the word to get
+//! \param[in] n_atoms: The number of atoms in the bitfield
+//! \return The bits of the atoms in the word; bit i is atom 32 * word + i
+static inline uint32_t bit_field_counter_word(
+        const uint32_t *data, uint32_t word, uint32_t n_atoms) {
+    uint32_t bits = data[word];
+    uint32_t n_left = n_atoms - (word * ATOMS_PER_WORD);
+    if (n_left < ATOMS_PER_WORD) {
+        bits &= (1u << n_left) - 1;
+    }
+    return bits;
+}
+
+//! \brief Count the atoms of a filter whose packets are wanted
+//! \param[in] filter_info: The filter to count in
+//! \return The number of atoms with their bit set
+static inline uint32_t bit_field_counter_n_set(
+        const filter_info_t *filter_info) {
+    uint32_t n_atoms = filter_info->n_atoms;
+    uint32_t n_words = bit_field_counter_n_words(n_atoms);
+    uint32_t n_set = 0;
+    for (uint32_t w = 0; w < n_words; w++) {
+        n_set += __builtin_popcount(
+                bit_field_counter_word(filter_info->data, w, n_atoms));
+    }
+    return n_set;
+}
+
+//! \brief Count the atoms of a filter whose packets are not wanted
+//! \param[in] filter_info: The filter to count in
+//! \return The number of packets the filter would drop
+static inline uint32_t bit_field_counter_n_redundant(
+        const filter_info_t *filter_info) {
+    return filter_info->n_atoms - bit_field_counter_n_set(filter_info);
+}
+
+#endif  // __BIT_FIELD_COUNTER_H__
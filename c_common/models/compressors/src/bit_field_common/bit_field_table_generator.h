@@ -20,8 +20,11 @@
 #ifndef __BIT_FIELD_TABLE_GENERATOR_H__
 #define __BIT_FIELD_TABLE_GENERATOR_H__
 
+#include <malloc_extras.h>
 #include "../common/constants.h"
+#include "../common/key_mask_scan.h"
 #include "routing_tables.h"
+#include "bit_field_counter.h"
 #include <filter_info.h>
 
 //! max number of links on a router
@@ -30,6 +33,13 @@
 //! neuron level mask
 #define NEURON_LEVEL_MASK       0xFFFFFFFF
 
+//! \brief Where the entries of an original entry are made when streaming,
+//!     to be merged before they go in the table; NULL when not streaming
+static entry_t *stream_entries = NULL;
+
+//! The number of entries in ::stream_entries
+static uint32_t stream_n_entries = 0;
+
 //! \brief Count the number of unique keys in the list up to the midpoint.
 //! \details Works on the assumption that the list is grouped (sorted) by key
 //! \param[in] sorted_bit_fields: the pointer to the sorted bit field struct.
@@ -55,15 +65,70 @@ int count_unique_keys(
     return count;
 }
 
+//! \brief Add an entry made from an original entry
+//! \details When streaming the entry goes in ::stream_entries, otherwise on
+//!     the end of the table
+//! \param[in] key: The key of the new entry
+//! \param[in] mask: The mask of the new entry
+//! \param[in] route: The route of the new entry
+//! \param[in] source: The source of the new entry
+static inline void generator_add_entry(
+        uint32_t key, uint32_t mask, uint32_t route, uint32_t source) {
+    if (stream_entries == NULL) {
+        routing_tables_append_new_entry(key, mask, route, source);
+        return;
+    }
+    entry_t *entry = &stream_entries[stream_n_entries++];
+    entry->key_mask.key = key;
+    entry->key_mask.mask = mask;
+    entry->route = route;
+    entry->source = source;
+}
+
+//! \brief Add the entries for a run of atoms that all have the same route
+//! \details The run is covered by the fewest aligned power-of-two blocks of
+//!     keys, each one entry.
+//! \param[in] key: The key of the first atom of the run
+//! \param[in] n_atoms: The number of atoms in the run
+//! \param[in] route: The route of every atom in the run
+//! \param[in] source: The source of the entries
+//! \param[in] append: Whether to add the entries or only count them
+//! \return The number of entries the run needs
+static inline uint32_t generate_run(
+        uint32_t key, uint32_t n_atoms, uint32_t route, uint32_t source,
+        bool append) {
+    uint32_t n_entries = 0;
+    while (n_atoms > 0) {
+        // The biggest block the key is aligned to that fits in the run
+        uint32_t block = 1u << (31 - __builtin_clz(n_atoms));
+        uint32_t aligned = key & -key;
+        if ((aligned != 0) && (aligned < block)) {
+            block = aligned;
+        }
+        if (append) {
+            generator_add_entry(
+                    key, NEURON_LEVEL_MASK & ~(block - 1), route, source);
+        }
+        n_entries++;
+        key += block;
+        n_atoms -= block;
+    }
+    return n_entries;
+}
+
 //! \brief Generate a routing tables by merging an entry and a list of
 //!     bitfields by processor.
+//! \details Consecutive atoms that go to the same processors are put in as
+//!     aligned blocks of keys rather than an entry per atom.
 //! \param[in] original_entry: The Routing Table entry in the original table
 //! \param[in] filters: List of the bitfields to me merged in
 //! \param[in] bit_field_processors: List of the processors for each bitfield
 //! \param[in] bf_found: Number of bitfields found.
-void generate_table(
+//! \param[in] append: Whether to add the entries or only count them
+//! \return The number of entries made
+uint32_t generate_table(
         entry_t original_entry, filter_info_t **restrict filters,
-        uint32_t *restrict bit_field_processors, int bf_found) {
+        uint32_t *restrict bit_field_processors, int bf_found, bool append) {
     uint32_t n_atoms = filters[0]->n_atoms;
 
     uint32_t stripped_route = original_entry.route;
@@ -77,80 +142,174 @@ void generate_table(
                 bit_field_processors[i] + MAX_LINKS_PER_ROUTER);
     }
 
-    // iterate though each atom and set the route when needed
-    for (uint32_t atom = 0; atom < n_atoms; atom++) {
-        // Assigning to a uint32 creates a copy
-        uint32_t new_route = stripped_route;
+    // The route bit of each bitfield's processor
+    uint32_t processor_bits[MAX_PROCESSORS];
+    for (int bf_index = 0; bf_index < bf_found; bf_index++) {
+        processor_bits[bf_index] =
+                1u << (MAX_LINKS_PER_ROUTER + bit_field_processors[bf_index]);
+    }
+
+    // The run of atoms with the same route not yet added
+    uint32_t run_start = 0;
+    uint32_t run_route = 0;
+    uint32_t n_entries = 0;
+
+    // iterate though the atoms a word of each bitfield at a time
+    uint32_t n_words = bit_field_counter_n_words(n_atoms);
+    for (uint32_t word = 0; word < n_words; word++) {
+        uint32_t first_atom = word * ATOMS_PER_WORD;
+        uint32_t n_word_atoms = n_atoms - first_atom;
+        uint32_t all_atoms = 0xFFFFFFFF;
+        if (n_word_atoms < ATOMS_PER_WORD) {
+            all_atoms = (1u << n_word_atoms) - 1;
+        } else {
+            n_word_atoms = ATOMS_PER_WORD;
+        }
 
-        // iterate through the bitfield processor's and see if they need this
-        // atom
+        // If no bitfield changes within the word, neither does the route
+        uint32_t words[MAX_PROCESSORS];
+        uint32_t word_route = stripped_route;
+        bool uniform = true;
         for (int bf_index = 0; bf_index < bf_found; bf_index++) {
-            log_debug("data address is %x", filters[bf_index]->data);
-            if (bit_field_test(filters[bf_index]->data, atom)) {
-                log_debug(
-                        "setting for atom %d from bitfield index %d so proc %d",
-                        atom, bf_index, bit_field_processors[bf_index]);
-                bit_field_set(&new_route,
-                        MAX_LINKS_PER_ROUTER + bit_field_processors[bf_index]);
+            words[bf_index] = bit_field_counter_word(
+                    filters[bf_index]->data, word, n_atoms);
+            if (words[bf_index] == all_atoms) {
+                word_route |= processor_bits[bf_index];
+            } else if (words[bf_index] != 0) {
+                uniform = false;
             }
         }
 
-        routing_tables_append_new_entry(
-                original_entry.key_mask.key + atom,
-                NEURON_LEVEL_MASK, new_route, original_entry.source);
+        for (uint32_t bit = 0; bit < n_word_atoms; bit++) {
+            // Assigning to a uint32 creates a copy
+            uint32_t new_route = word_route;
+
+            // add the processors whose bitfields need this atom
+            if (!uniform) {
+                new_route = stripped_route;
+                for (int bf_index = 0; bf_index < bf_found; bf_index++) {
+                    if (words[bf_index] & (1u << bit)) {
+                        new_route |= processor_bits[bf_index];
+                    }
+                }
+            }
+
+            uint32_t atom = first_atom + bit;
+            if ((atom > 0) && (new_route != run_route)) {
+                n_entries += generate_run(
+                        original_entry.key_mask.key + run_start,
+                        atom - run_start, run_route, original_entry.source,
+                        append);
+                run_start = atom;
+            }
+            run_route = new_route;
+
+            // The rest of a uniform word is the same route
+            if (uniform) {
+                break;
+            }
+        }
     }
-    log_debug("key %d atoms %d size %d",
-            original_entry.key_mask.key, n_atoms,
-            routing_table_get_n_entries());
+    n_entries += generate_run(
+            original_entry.key_mask.key + run_start, n_atoms - run_start,
+            run_route, original_entry.source, append);
+
+    log_debug("key %d atoms %d entries %d",
+            original_entry.key_mask.key, n_atoms, n_entries);
+    return n_entries;
 }
 
-//! \brief Take a midpoint and read the sorted bitfields,
-//!     computing the max size of the routing table.
-//! \param[in] mid_point: where in the sorted bitfields to go to
-//! \param[in] uncompressed_table: the uncompressed router table
-//! \param[in] sorted_bit_fields: the pointer to the sorted bit field struct.
-//! \return size of table(s) to be generated in entries
-static inline uint32_t bit_field_table_generator_max_size(
-        int mid_point, table_t *restrict uncompressed_table,
-        sorted_bit_fields_t *restrict sorted_bit_fields) {
-    // semantic sugar to avoid referencing
-    filter_info_t **restrict bit_fields = sorted_bit_fields->bit_fields;
-    int *restrict sort_order = sorted_bit_fields->sort_order;
+//! \brief Whether an entry would catch keys of a streamed entry with a
+//!     different route
+//! \param[in] key_mask: The key and mask of the entry
+//! \param[in] route: The route of the entry
+//! \return Whether any streamed entry with another route intersects it
+static inline bool stream_merge_blocked(key_mask_t key_mask, uint32_t route) {
+    uint32_t i = key_mask_scan_run(stream_entries, stream_n_entries, key_mask);
+    while (i < stream_n_entries) {
+        if (stream_entries[i].route != route) {
+            return true;
+        }
+        i++;
+        i += key_mask_scan_run(
+                &stream_entries[i], stream_n_entries - i, key_mask);
+    }
+    return false;
+}
 
-    // Start with the size of the uncompressed table
-    uint32_t max_size = uncompressed_table->size;
-    log_debug("keys %d",  max_size);
-
-    // Check every bitfield to see if is to be used
-    // Only need each key once to track last used as tables is sorted by key
-    uint32_t used_key = FAILED_TO_FIND;
-    for (int bf_i = sorted_bit_fields->n_bit_fields -1;  bf_i >= 0; bf_i--) {
-        if (sort_order[bf_i] < mid_point) {
-            if (used_key != bit_fields[bf_i]->key) {
-                used_key = bit_fields[bf_i]->key;
-
-                // One entry per atom but we can remove the uncompressed one
-                max_size += bit_fields[bf_i]->n_atoms -1;
-                log_debug("key %d size %d",
-                        used_key, bit_fields[bf_i]->n_atoms);
+//! \brief Merge the entries made from an original entry, as the pair
+//!     compressor would
+//! \details Two entries with the same route are merged if no entry with
+//!     another route intersects the result. As every entry made from an
+//!     original entry is inside it, and the original entries do not
+//!     intersect, the table stays orthogonal, so the compressor can still
+//!     work on it in any order.
+static void stream_merge_entries(void) {
+    for (uint32_t left = 0; left < stream_n_entries; left++) {
+        entry_t *entry = &stream_entries[left];
+        uint32_t index = left + 1;
+        while (index < stream_n_entries) {
+            entry_t *other = &stream_entries[index];
+            if (other->route == entry->route) {
+                key_mask_t merged = key_mask_merge(
+                        entry->key_mask, other->key_mask);
+                if (!stream_merge_blocked(merged, entry->route)) {
+                    entry->key_mask = merged;
+                    if (entry->source != other->source) {
+                        entry->source = 0;
+                    }
+                    *other = stream_entries[--stream_n_entries];
+
+                    // The bigger entry may now merge with ones passed over
+                    index = left + 1;
+                    continue;
+                }
             }
+            index++;
         }
     }
-    log_debug("Using mid_point %d, counted size of table is %d",
-            mid_point, max_size);
-    return max_size;
+}
+
+//! \brief Make the entries of an original entry and merge them before they
+//!     go in the table
+//! \param[in] original_entry: The Routing Table entry in the original table
+//! \param[in] filters: List of the bitfields to me merged in
+//! \param[in] bit_field_processors: List of the processors for each bitfield
+//! \param[in] bf_found: Number of bitfields found.
+//! \param[in] append: Whether to add the entries or only count them
+//! \return The number of entries left once merged
+static uint32_t stream_table(
+        entry_t original_entry, filter_info_t **restrict filters,
+        uint32_t *restrict bit_field_processors, int bf_found, bool append) {
+    stream_n_entries = 0;
+    generate_table(original_entry, filters, bit_field_processors, bf_found,
+            true);
+    stream_merge_entries();
+    if (append) {
+        for (uint32_t i = 0; i < stream_n_entries; i++) {
+            routing_tables_append_entry(stream_entries[i]);
+        }
+    }
+    return stream_n_entries;
 }
 
 //! \brief Take a midpoint and read the sorted bitfields up to that point,
-//!     generating bitfield routing tables and loading them into SDRAM for
-//!     transfer to a compressor processor
+//!     generating the bitfield routing table entries inside a block of the
+//!     key space
 //! \param[in] mid_point: where in the sorted bitfields to go to
 //! \param[in] uncompressed_table: the uncompressed router table
 //! \param[in] sorted_bit_fields: the pointer to the sorted bit field struct.
-static inline void bit_field_table_generator_create_bit_field_router_tables(
+//! \param[in] cube: the fixed bits of the block; only entries of the
+//!     uncompressed table wholly inside it are used
+//! \param[in] append: Whether to add the entries or only count them
+//! \param[out] max_entries: Where to put the most entries made from any one
+//!     original entry before merging; may be NULL
+//! \return The number of entries made
+static uint32_t generate_cube_tables(
         int mid_point,
         table_t *restrict uncompressed_table,
-        sorted_bit_fields_t *restrict sorted_bit_fields) {
+        sorted_bit_fields_t *restrict sorted_bit_fields, key_mask_t cube,
+        bool append, uint32_t *max_entries) {
     // semantic sugar to avoid referencing
     filter_info_t **restrict bit_fields = sorted_bit_fields->bit_fields;
     int *restrict processor_ids = sorted_bit_fields->processor_ids;
@@ -162,15 +321,18 @@ static inline void bit_field_table_generator_create_bit_field_router_tables(
     filter_info_t * filters[MAX_PROCESSORS];
     uint32_t bit_field_processors[MAX_PROCESSORS];
     int bf_i = 0;
-    log_debug("pre size %d", routing_table_get_n_entries());
+    uint32_t n_entries = 0;
+    uint32_t most_entries = 1;
 
     for (uint32_t rt_i = 0; rt_i < original_size; rt_i++) {
         uint32_t key = original[rt_i].key_mask.key;
         log_debug("key %d", key);
         int bf_found = 0;
+        bool inside = ((original[rt_i].key_mask.mask & cube.mask) ==
+                cube.mask) && ((key & cube.mask) == cube.key);
 
         while ((bf_i < n_bit_fields) && (bit_fields[bf_i]->key == key)) {
-            if (sort_order[bf_i] < mid_point) {
+            if (inside && (sort_order[bf_i] < mid_point)) {
                 filters[bf_found] = bit_fields[bf_i];
                 bit_field_processors[bf_found] = processor_ids[bf_i];
                 bf_found++;
@@ -178,14 +340,198 @@ static inline void bit_field_table_generator_create_bit_field_router_tables(
             bf_i++;
         }
 
-        if (bf_found > 0) {
-            generate_table(original[rt_i], filters, bit_field_processors,
-                    bf_found);
+        if (!inside) {
+            continue;
+        }
+        if ((bf_found > 0) && (stream_entries != NULL)) {
+            n_entries += stream_table(original[rt_i], filters,
+                    bit_field_processors, bf_found, append);
+        } else if (bf_found > 0) {
+            uint32_t n_made = generate_table(original[rt_i], filters,
+                    bit_field_processors, bf_found, append);
+            if (n_made > most_entries) {
+                most_entries = n_made;
+            }
+            n_entries += n_made;
         } else {
-            routing_tables_append_entry(original[rt_i]);
+            if (append) {
+                routing_tables_append_entry(original[rt_i]);
+            }
+            n_entries++;
+        }
+    }
+    if (max_entries != NULL) {
+        *max_entries = most_entries;
+    }
+    return n_entries;
+}
+
+//! \brief Take a midpoint and read the sorted bitfields,
+//!     computing the max size of the routing table.
+//! \details This is the exact number of entries that will be generated.
+//! \param[in] mid_point: where in the sorted bitfields to go to
+//! \param[in] uncompressed_table: the uncompressed router table
+//! \param[in] sorted_bit_fields: the pointer to the sorted bit field struct.
+//! \return size of table(s) to be generated in entries
+static inline uint32_t bit_field_table_generator_max_size(
+        int mid_point, table_t *restrict uncompressed_table,
+        sorted_bit_fields_t *restrict sorted_bit_fields) {
+    key_mask_t whole_key_space = {0, 0};
+    uint32_t max_size = generate_cube_tables(mid_point, uncompressed_table,
+            sorted_bit_fields, whole_key_space, false, NULL);
+    log_debug("Using mid_point %d, counted size of table is %d",
+            mid_point, max_size);
+    return max_size;
+}
+
+//! \brief Start making tables an original entry at a time, merging the
+//!     entries of each before they go in the table.
+//! \details The table then never holds all the entries the bitfields
+//!     expand to, only what is left of them once merged, so it needs much
+//!     less memory. Until bit_field_table_generator_stream_end() is called,
+//!     bit_field_table_generator_streamed_size() and the table makers work
+//!     this way.
+//! \param[in] mid_point: where in the sorted bitfields to go to
+//! \param[in] uncompressed_table: the uncompressed router table
+//! \param[in] sorted_bit_fields: the pointer to the sorted bit field struct.
+//! \return Whether there was memory to make the entries of an original
+//!     entry in
+static inline bool bit_field_table_generator_stream_start(
+        int mid_point, table_t *restrict uncompressed_table,
+        sorted_bit_fields_t *restrict sorted_bit_fields) {
+    key_mask_t whole_key_space = {0, 0};
+    uint32_t max_entries;
+    generate_cube_tables(mid_point, uncompressed_table, sorted_bit_fields,
+            whole_key_space, false, &max_entries);
+    stream_entries = MALLOC(max_entries * sizeof(entry_t));
+    if (stream_entries == NULL) {
+        log_error("failed to allocate memory to stream %d entries",
+                max_entries);
+        return false;
+    }
+    return true;
+}
+
+//! \brief Go back to making tables whole
+static inline void bit_field_table_generator_stream_end(void) {
+    if (stream_entries != NULL) {
+        FREE(stream_entries);
+        stream_entries = NULL;
+    }
+}
+
+//! \brief Take a midpoint and read the sorted bitfields, computing the size
+//!     of the routing table made an original entry at a time.
+//! \details Must be between bit_field_table_generator_stream_start() and
+//!     bit_field_table_generator_stream_end(). This is the exact number of
+//!     entries that will be generated, but takes as long as making them.
+//! \param[in] mid_point: where in the sorted bitfields to go to
+//! \param[in] uncompressed_table: the uncompressed router table
+//! \param[in] sorted_bit_fields: the pointer to the sorted bit field struct.
+//! \return size of table(s) to be generated in entries
+static inline uint32_t bit_field_table_generator_streamed_size(
+        int mid_point, table_t *restrict uncompressed_table,
+        sorted_bit_fields_t *restrict sorted_bit_fields) {
+    key_mask_t whole_key_space = {0, 0};
+    uint32_t size = generate_cube_tables(mid_point, uncompressed_table,
+            sorted_bit_fields, whole_key_space, false, NULL);
+    log_info("Using mid_point %d, streamed size of table is %d",
+            mid_point, size);
+    return size;
+}
+
+//! \brief Take a midpoint and read the sorted bitfields, computing the
+//!     number of entries made inside a block of the key space
+//! \param[in] mid_point: where in the sorted bitfields to go to
+//! \param[in] uncompressed_table: the uncompressed router table
+//! \param[in] sorted_bit_fields: the pointer to the sorted bit field struct.
+//! \param[in] cube: the fixed bits of the block; only entries of the
+//!     uncompressed table wholly inside it are counted
+//! \return The number of entries that
+//!     bit_field_table_generator_create_cube_tables() would make
+static inline uint32_t bit_field_table_generator_cube_size(
+        int mid_point,
+        table_t *restrict uncompressed_table,
+        sorted_bit_fields_t *restrict sorted_bit_fields, key_mask_t cube) {
+    return generate_cube_tables(mid_point, uncompressed_table,
+            sorted_bit_fields, cube, false, NULL);
+}
+
+//! \brief Take a midpoint and read the sorted bitfields up to that point,
+//!     generating the bitfield routing table entries inside a block of the
+//!     key space and loading them into SDRAM
+//! \param[in] mid_point: where in the sorted bitfields to go to
+//! \param[in] uncompressed_table: the uncompressed router table
+//! \param[in] sorted_bit_fields: the pointer to the sorted bit field struct.
+//! \param[in] cube: the fixed bits of the block; only entries of the
+//!     uncompressed table wholly inside it are used
+static inline void bit_field_table_generator_create_cube_tables(
+        int mid_point,
+        table_t *restrict uncompressed_table,
+        sorted_bit_fields_t *restrict sorted_bit_fields, key_mask_t cube) {
+    log_debug("pre size %d", routing_table_get_n_entries());
+    generate_cube_tables(mid_point, uncompressed_table, sorted_bit_fields,
+            cube, true, NULL);
+    log_debug("post size %d", routing_table_get_n_entries());
+}
+
+//! \brief Take a midpoint and read the sorted bitfields up to that point,
+//!     generating bitfield routing tables and loading them into SDRAM for
+//!     transfer to a compressor processor
+//! \param[in] mid_point: where in the sorted bitfields to go to
+//! \param[in] uncompressed_table: the uncompressed router table
+//! \param[in] sorted_bit_fields: the pointer to the sorted bit field struct.
+static inline void bit_field_table_generator_create_bit_field_router_tables(
+        int mid_point,
+        table_t *restrict uncompressed_table,
+        sorted_bit_fields_t *restrict sorted_bit_fields) {
+    key_mask_t whole_key_space = {0, 0};
+    bit_field_table_generator_create_cube_tables(mid_point,
+            uncompressed_table, sorted_bit_fields, whole_key_space);
+}
+
+//! The number of generalities a key_mask can have; 0 to 32 Xs
+#define N_GENERALITIES          33
+
+//! \brief Put the table made in order of generality, as ordered covering
+//!     expects
+//! \details The blocks made from the bitfields are in key order, so their
+//!     generalities are mixed. The entries do not overlap, so they can be
+//!     put in any order without changing the routes. This counts the
+//!     entries of each generality and then swaps each entry into the range
+//!     of its generality, so needs no memory for the table.
+static void bit_field_table_generator_sort_by_generality(void) {
+    uint32_t next[N_GENERALITIES];
+    uint32_t end[N_GENERALITIES];
+    for (uint32_t g = 0; g < N_GENERALITIES; g++) {
+        end[g] = 0;
+    }
+    uint32_t n_entries = routing_table_get_n_entries();
+    routing_table_cursor_t cursor;
+    routing_table_cursor_init(&cursor, 0, n_entries);
+    entry_t *entry;
+    while ((entry = routing_table_cursor_next(&cursor)) != NULL) {
+        end[key_mask_count_xs(entry->key_mask)]++;
+    }
+    uint32_t start = 0;
+    for (uint32_t g = 0; g < N_GENERALITIES; g++) {
+        next[g] = start;
+        start += end[g];
+        end[g] = start;
+    }
+
+    // Each swap puts one entry where it belongs
+    for (uint32_t g = 0; g < N_GENERALITIES; g++) {
+        while (next[g] < end[g]) {
+            uint32_t h = key_mask_count_xs(
+                    routing_table_get_entry(next[g])->key_mask);
+            if (h == g) {
+                next[g]++;
+            } else {
+                swap_entries(next[g], next[h]);
+                next[h]++;
+            }
         }
-        log_debug("key %d size %d",
-                original[rt_i].key_mask.key, routing_table_get_n_entries());
     }
 }
 
@@ -110,6 +110,8 @@ typedef struct sorted_bit_fields_t {
     filter_info_t** bit_fields;
     //! the sort order based on best contribution to reducing redundancy
     int* sort_order;
+    //! how many packets each bitfield filters out; counted once when read
+    uint32_t* n_redundant_packets;
 } sorted_bit_fields_t;
 
 //! \brief SDRAM area to communicate between sorter and compressor
@@ -120,6 +122,27 @@ typedef struct comms_sdram_t {
     instructions_to_compressor sorter_instruction;
     //! how many bit fields were used to make those tables
     int mid_point;
+    //! \brief How many compressors share the table of this mid_point
+    //! \details Each minimises one partition of the table, as made by
+    //!     table_partition_keep(); 1 if this compressor has the whole table
+    int n_partitions;
+    //! Which of the partitions of the table this compressor minimises
+    int partition;
+    //! \brief The length of the best table the compressor has so far
+    //! \details Updated as the compressor runs. If it runs out of time with
+    //!     this not #FAILED_TO_FIND, the routing tables hold that table.
+    int n_best_entries;
+    //! \brief Whether to make the table an original entry at a time
+    //! \details The entries made from each are merged before the next, as
+    //!     there was not the memory for the table they make whole; see
+    //!     bit_field_table_generator_stream_start()
+    bool stream_tables;
+    //! \brief The most SDRAM the compressor may keep compressed blocks of
+    //!     the key space in between runs; see cube_cache.h
+    uint32_t cube_cache_bytes;
+    //! \brief The compressor_path_t of the algorithm that made the last
+    //!     table the compressor returned
+    uint32_t compressor_path;
     //! Pointer to the shared version of the uncompressed routing table
     table_t* uncompressed_router_table;
     //! Pointer to the uncompressed tables metadata
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Cache of compressed blocks of the key space, kept between the
+//!     midpoints a compressor is asked to try.
+//! \details The key space is cut into cubes that no entry of the
+//!     uncompressed table crosses (see table_partition.h), and each cube is
+//!     compressed on its own. The entries of a cube only depend on the
+//!     bitfields with keys in the cube, so when no such bitfield lies
+//!     between the last midpoint and the next, the compressed cube from the
+//!     last midpoint can be used again as it is. The cubes come from the
+//!     heap the sorter makes the tables in, so no more is kept between runs
+//!     than the sorter allows, and none once the compressor is stopped.
+#ifndef __CUBE_CACHE_H__
+#define __CUBE_CACHE_H__
+
+#include <debug.h>
+#include <malloc_extras.h>
+#include "../common/constants.h"
+#include "../common/routing_table.h"
+#include "../compressor_includes/table_partition.h"
+#include "compressor_sorter_structs.h"
+#include "routing_tables.h"
+
+//! The number of cubes to cut the key space into
+#define CUBE_CACHE_CUBES 16
+
+//! \brief The compressed entries of one cube
+typedef struct cube_cache_entry_t {
+    //! The fixed bits of the cube
+    key_mask_t cube;
+
+    //! The midpoint the entries were made for, or #FAILED_TO_FIND if none
+    int mid_point;
+
+    //! The number of compressed entries
+    uint32_t n_entries;
+
+    //! The compressor_path_t of the algorithm that compressed the entries
+    uint32_t compressor_path;
+
+    //! The compressed entries, in SDRAM
+    entry_t *entries;
+} cube_cache_entry_t;
+
+//! \brief The cache of all the cubes
+typedef struct cube_cache_t {
+    //! The number of cubes; 0 until the cache is initialised
+    int n_cubes;
+
+    //! The bytes of SDRAM holding compressed entries
+    uint32_t n_bytes;
+
+    //! The cubes, in an order that depends only on the uncompressed table
+    cube_cache_entry_t cubes[CUBE_CACHE_CUBES];
+} cube_cache_t;
+
+//! The cache of this compressor
+static cube_cache_t cube_cache;
+
+//! \brief Cut the key space into cubes, if not already done
+//! \param[in] uncompressed_table: The table the cubes must not cut across
+static void cube_cache_init(const table_t *uncompressed_table) {
+    if (cube_cache.n_cubes > 0) {
+        return;
+    }
+    cube_cache.n_bytes = 0;
+    table_partition_cube_t cubes[CUBE_CACHE_CUBES];
+    cube_cache.n_cubes = table_partition_cubes(
+            uncompressed_table, cubes, CUBE_CACHE_CUBES);
+    for (int c = 0; c < cube_cache.n_cubes; c++) {
+        cube_cache.cubes[c].cube = cubes[c].key_mask;
+        cube_cache.cubes[c].mid_point = FAILED_TO_FIND;
+        cube_cache.cubes[c].n_entries = 0;
+        cube_cache.cubes[c].compressor_path = 0;
+        cube_cache.cubes[c].entries = NULL;
+    }
+    log_info("Cached compression uses %d blocks of the key space",
+            cube_cache.n_cubes);
+}
+
+//! \brief Check if the compressed entries of a cube can be used for a
+//!     midpoint
+//! \param[in] c: The index of the cube
+//! \param[in] mid_point: The midpoint wanted
+//! \param[in] sorted_bit_fields: The bitfields the midpoints refer to
+//! \return Whether the cached entries are those the midpoint would make
+static bool cube_cache_is_valid(
+        int c, int mid_point, sorted_bit_fields_t *sorted_bit_fields) {
+    cube_cache_entry_t *entry = &cube_cache.cubes[c];
+    if (entry->mid_point == FAILED_TO_FIND) {
+        return false;
+    }
+
+    // Any bitfield of the cube that one midpoint uses and the other does not
+    // changes the entries
+    int low = entry->mid_point;
+    int high = mid_point;
+    if (low > high) {
+        low = mid_point;
+        high = entry->mid_point;
+    }
+    for (int i = 0; i < sorted_bit_fields->n_bit_fields; i++) {
+        int order = sorted_bit_fields->sort_order[i];
+        if ((order >= low) && (order < high) &&
+                ((sorted_bit_fields->bit_fields[i]->key & entry->cube.mask)
+                == entry->cube.key)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//! \brief Free the compressed entries of a cube
+//! \param[in] c: The index of the cube
+static void cube_cache_forget(int c) {
+    cube_cache_entry_t *entry = &cube_cache.cubes[c];
+    if (entry->entries != NULL) {
+        FREE(entry->entries);
+        entry->entries = NULL;
+        cube_cache.n_bytes -= entry->n_entries * sizeof(entry_t);
+    }
+    entry->n_entries = 0;
+    entry->compressor_path = 0;
+    entry->mid_point = FAILED_TO_FIND;
+}
+
+//! \brief Free the compressed entries of every cube
+//! \details The cubes themselves are kept, as they only depend on the
+//!     uncompressed table.
+static void cube_cache_free(void) {
+    for (int c = 0; c < cube_cache.n_cubes; c++) {
+        cube_cache_forget(c);
+    }
+}
+
+//! \brief Free the compressed entries of the cubes that cannot be used for
+//!     a midpoint, before it needs the memory
+//! \param[in] mid_point: The midpoint about to be made
+//! \param[in] sorted_bit_fields: The bitfields the midpoints refer to
+static void cube_cache_free_stale(
+        int mid_point, sorted_bit_fields_t *sorted_bit_fields) {
+    for (int c = 0; c < cube_cache.n_cubes; c++) {
+        if (!cube_cache_is_valid(c, mid_point, sorted_bit_fields)) {
+            cube_cache_forget(c);
+        }
+    }
+}
+
+//! \brief Free the compressed entries of cubes, the last first, until
+//!     those left fit in a number of bytes
+//! \param[in] max_bytes: The most bytes to keep
+static void cube_cache_trim(uint32_t max_bytes) {
+    for (int c = cube_cache.n_cubes - 1;
+            (c >= 0) && (cube_cache.n_bytes > max_bytes); c--) {
+        cube_cache_forget(c);
+    }
+}
+
+//! \brief Keep the compressed entries now in the routing table as those of
+//!     a cube
+//! \param[in] c: The index of the cube
+//! \param[in] mid_point: The midpoint the entries were made for
+//! \param[in] compressor_path: The algorithm that compressed them
+//! \return Whether there was memory to keep them
+static bool cube_cache_store(int c, int mid_point, uint32_t compressor_path) {
+    cube_cache_entry_t *entry = &cube_cache.cubes[c];
+    cube_cache_forget(c);
+
+    uint32_t n_entries = routing_table_get_n_entries();
+    if (n_entries > 0) {
+        entry->entries = MALLOC_SDRAM(n_entries * sizeof(entry_t));
+        if (entry->entries == NULL) {
+            log_error("failed to allocate memory to cache %d entries",
+                    n_entries);
+            return false;
+        }
+        for (uint32_t i = 0; i < n_entries; i++) {
+            entry->entries[i] = *routing_table_get_entry(i);
+        }
+        cube_cache.n_bytes += n_entries * sizeof(entry_t);
+    }
+    entry->n_entries = n_entries;
+    entry->compressor_path = compressor_path;
+    entry->mid_point = mid_point;
+    return true;
+}
+
+//! \brief Add the cached entries of a cube to the end of the routing table
+//! \param[in] c: The index of the cube
+static void cube_cache_append(int c) {
+    cube_cache_entry_t *entry = &cube_cache.cubes[c];
+    for (uint32_t i = 0; i < entry->n_entries; i++) {
+        routing_tables_append_entry(entry->entries[i]);
+    }
+}
+
+#endif  // __CUBE_CACHE_H__
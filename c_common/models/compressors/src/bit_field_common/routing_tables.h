@@ -34,13 +34,19 @@ multi_table_t multi_table;
 //! \brief Gets a pointer to where this entry is stored
 //!
 //! Will not check if there is an entry with this id but will RTE if the id
-//! is too large
+//! is too large, unless built with ROUTING_TABLES_UNCHECKED, as the
+//! compressors are unless built with `make checked`
 //! \param[in] entry_id_to_find: Id of entry to find pointer to
 //! \param[in] marker: int that should be different in every call so we can
 //!     detect where MUNDY was reading past the end of the table
 //! \return pointer to the entry's location
 entry_t* routing_tables_get_entry_marked(uint32_t entry_id_to_find, int marker) {
     uint32_t table_id = entry_id_to_find >> TABLE_SHIFT;
+#ifdef ROUTING_TABLES_UNCHECKED
+    use(marker);
+    return &multi_table.sub_tables[table_id]->entries[
+            entry_id_to_find & LOCAL_ID_ADD];
+#else
     if (table_id >= multi_table.n_sub_tables) {
         log_error("Id %d to big for %d tables marker %d",
                 entry_id_to_find, multi_table.n_sub_tables, marker);
@@ -55,12 +61,35 @@ entry_t* routing_tables_get_entry_marked(uint32_t entry_id_to_find, int marker)
         malloc_extras_terminate(RTE_SWERR);
     }
     return &multi_table.sub_tables[table_id]->entries[local_id];
+#endif
 }
 
 entry_t* routing_table_get_entry(uint32_t entry_id_to_find) {
     return routing_tables_get_entry_marked(entry_id_to_find, -1);
 }
 
+void routing_table_cursor_fill(routing_table_cursor_t *cursor) {
+    // A run is the rest of the sub-table holding the next entry
+    uint32_t table_id = cursor->next_index >> TABLE_SHIFT;
+    uint32_t local_id = cursor->next_index & LOCAL_ID_ADD;
+    uint32_t n_local = (LOCAL_ID_ADD + 1) - local_id;
+    if (n_local > cursor->end_index - cursor->next_index) {
+        n_local = cursor->end_index - cursor->next_index;
+    }
+#ifndef ROUTING_TABLES_UNCHECKED
+    if ((table_id >= multi_table.n_sub_tables) || (local_id + n_local >
+            multi_table.sub_tables[table_id]->size)) {
+        log_error("Ids %d to %d not all in %d tables",
+                cursor->next_index, cursor->end_index,
+                multi_table.n_sub_tables);
+        malloc_extras_terminate(RTE_SWERR);
+    }
+#endif
+    cursor->entry = &multi_table.sub_tables[table_id]->entries[local_id];
+    cursor->stop = cursor->entry + n_local;
+    cursor->next_index += n_local;
+}
+
 //! \brief Gets a pointer to where to append an entry to the routing table.
 //! \return pointer to the entry's location
 entry_t* routing_tables_append_get_entry(void) {
@@ -154,6 +183,16 @@ void routing_tables_save(multi_table_t *restrict tables) {
             tables->n_sub_tables, tables->n_entries);
 }
 
+//! \brief Empties the tables so they can be filled again
+//! \details Keeps the memory of the tables; does not touch the saved
+//!     metadata until routing_tables_save() is called.
+void routing_tables_clear(void) {
+    for (uint32_t i = 0; i < multi_table.n_sub_tables; i++) {
+        multi_table.sub_tables[i]->size = 0;
+    }
+    multi_table.n_entries = 0;
+}
+
 void routing_table_remove_from_size(int size_to_remove) {
     if (size_to_remove > multi_table.n_entries) {
         log_error("Remove %d large than n_entries %d",
@@ -163,6 +202,20 @@ void routing_table_remove_from_size(int size_to_remove) {
     multi_table.n_entries -= size_to_remove;
 }
 
+void routing_table_restore_size(int size_to_restore) {
+    // The entries are still there if the sub-tables still hold them
+    uint32_t n_held = 0;
+    for (uint32_t i = 0; i < multi_table.n_sub_tables; i++) {
+        n_held += multi_table.sub_tables[i]->size;
+    }
+    if (multi_table.n_entries + size_to_restore > (int) n_held) {
+        log_error("Restore %d to %d entries when only %d are held",
+                size_to_restore, multi_table.n_entries, n_held);
+        malloc_extras_terminate(RTE_SWERR);
+    }
+    multi_table.n_entries += size_to_restore;
+}
+
 //! \brief Clones an original table into this format.
 //! \details Will _not_ free the space any previous tables held.
 //!     Makes a Deep copy of the original.
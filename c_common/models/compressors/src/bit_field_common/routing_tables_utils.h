@@ -50,8 +50,8 @@ static void routing_tables_utils_free(
         // Already freed or never malloced
         return;
     }
-    for (uint32_t i = start_point; i > tables->n_sub_tables; i++) {
-        FREE_MARKED(tables->sub_tables[i]->entries, 70999);
+    // The entries of a sub table are part of the same block
+    for (uint32_t i = start_point; i < tables->n_sub_tables; i++) {
         FREE_MARKED(tables->sub_tables[i], 70100);
     }
     FREE_MARKED(tables->sub_tables, 70101);
@@ -27,8 +27,10 @@
 #include "bit_field_common/bit_field_table_generator.h"
 #include "common/minimise.h"
 #include "compressor_includes/compressor.h"
+#include "compressor_includes/table_partition.h"
 #include "bit_field_common/routing_tables.h"
 #include "bit_field_common/bit_field_table_generator.h"
+#include "bit_field_common/cube_cache.h"
 
 /*****************************************************************************/
 
@@ -71,6 +73,154 @@ bool hack_malloc_failed = false;
 #endif
 // ---------------------------------------------------------------------
 
+//! \brief Whether this run builds and compresses the table a cube at a time,
+//!     reusing the cubes of earlier runs where it can
+//! \details Not for the no bitfields run, which may start before the
+//!     bitfields are read, nor for a table shared with other compressors.
+//!     Nor for a table made an original entry at a time, as the table only
+//!     has room for that, and cubes compressed before may be bigger.
+//! \return Whether the cube cache is used
+static inline bool use_cube_cache(void) {
+    return (comms_sdram->mid_point > 0) && (comms_sdram->n_partitions <= 1) &&
+            !comms_sdram->stream_tables;
+}
+
+//! \brief Put a table made for the compressor in the order the algorithm
+//!     needs
+//! \details Ordered covering, alone or after pair, needs the table in order
+//!     of generality, but it is made in key order; pair sorts the table
+//!     itself.
+static inline void order_generated_table(void) {
+#ifndef USE_PAIR
+    bit_field_table_generator_sort_by_generality();
+#endif
+}
+
+//! \brief Add the compressed entries of a cube to the end of the table
+//! \details ::compressor_path becomes the latest of the algorithms used for
+//!     the cubes added, in the order of ::compressor_path_t.
+//! \param[in] c: The index of the cube
+static inline void append_cube(int c) {
+    cube_cache_append(c);
+    if (cube_cache.cubes[c].compressor_path > compressor_path) {
+        compressor_path = cube_cache.cubes[c].compressor_path;
+    }
+}
+
+//! \brief Put the table together part way through the cubes
+//! \details Cubes already done for this midpoint, up to the one stopped at,
+//!     are used as they are; the rest go in uncompressed. This is for when
+//!     the time runs out, or the table fits before all are done.
+//! \param[in] stopped_cube: The last cube done; if time ran out, its
+//!     entries have been stored in the cache, but not as being for any
+//!     midpoint
+static void assemble_partial_cubes(int stopped_cube) {
+    routing_tables_clear();
+    compressor_path = COMPRESSOR_PATH_NONE;
+    for (int c = 0; c < cube_cache.n_cubes; c++) {
+        if ((c <= stopped_cube) || cube_cache_is_valid(
+                c, comms_sdram->mid_point, comms_sdram->sorted_bit_fields)) {
+            append_cube(c);
+        } else {
+            bit_field_table_generator_create_cube_tables(
+                    comms_sdram->mid_point,
+                    comms_sdram->uncompressed_router_table,
+                    comms_sdram->sorted_bit_fields, cube_cache.cubes[c].cube);
+        }
+    }
+    minimise_best_length = routing_table_get_n_entries();
+}
+
+//! \brief Compress the table a cube at a time, reusing cached cubes
+//! \details Each cube is compressed as much as possible, as it only has to
+//!     fit together with the others. Unless asked to compress as much as
+//!     possible, this stops as soon as the cubes done and those left as
+//!     they are fit in the router together.
+//! \return Whether the cubes compressed; if so the routing table then
+//!     holds all of them
+static bool run_compressor_by_cube(void) {
+    cube_cache_free_stale(
+            comms_sdram->mid_point, comms_sdram->sorted_bit_fields);
+
+    // Work out how big the table would be with only the cached cubes
+    // compressed
+    uint32_t sizes[CUBE_CACHE_CUBES];
+    uint32_t n_entries = 0;
+    int n_reused = 0;
+    for (int c = 0; c < cube_cache.n_cubes; c++) {
+        if (cube_cache_is_valid(c, comms_sdram->mid_point,
+                comms_sdram->sorted_bit_fields)) {
+            sizes[c] = cube_cache.cubes[c].n_entries;
+            n_reused++;
+        } else {
+            sizes[c] = bit_field_table_generator_cube_size(
+                    comms_sdram->mid_point,
+                    comms_sdram->uncompressed_router_table,
+                    comms_sdram->sorted_bit_fields, cube_cache.cubes[c].cube);
+        }
+        n_entries += sizes[c];
+    }
+    log_info("Reused %d of %d compressed blocks of the key space",
+            n_reused, cube_cache.n_cubes);
+
+    uint32_t max_length = rtr_alloc_max();
+    for (int c = 0; c < cube_cache.n_cubes; c++) {
+        if (!compress_as_much_as_possible && (n_entries <= max_length)) {
+            log_info("Table of %d entries fits without compressing blocks "
+                    "%d onwards", n_entries, c);
+            assemble_partial_cubes(c - 1);
+            return true;
+        }
+        if (cube_cache_is_valid(c, comms_sdram->mid_point,
+                comms_sdram->sorted_bit_fields)) {
+            continue;
+        }
+        routing_tables_clear();
+        bit_field_table_generator_create_cube_tables(
+                comms_sdram->mid_point, comms_sdram->uncompressed_router_table,
+                comms_sdram->sorted_bit_fields, cube_cache.cubes[c].cube);
+        order_generated_table();
+        if (!run_compressor(true, &failed_by_malloc, &stop_compressing)) {
+            // Keep what was done if time ran out with the cube usable
+            if (!failed_by_malloc &&
+                    (comms_sdram->sorter_instruction == RUN) &&
+                    (minimise_best_length == routing_table_get_n_entries()) &&
+                    cube_cache_store(c, FAILED_TO_FIND, compressor_path)) {
+                assemble_partial_cubes(c);
+            }
+            return false;
+        }
+        if (!cube_cache_store(
+                c, comms_sdram->mid_point, compressor_path)) {
+            failed_by_malloc = true;
+            return false;
+        }
+        n_entries -= sizes[c] - cube_cache.cubes[c].n_entries;
+    }
+
+    routing_tables_clear();
+    compressor_path = COMPRESSOR_PATH_NONE;
+    for (int c = 0; c < cube_cache.n_cubes; c++) {
+        append_cube(c);
+    }
+    return true;
+}
+
+//! \brief Keep the table as it was when the time ran out, if it is usable
+//! \details The sorter decides whether it is good enough.
+static void keep_partial_result(void) {
+    int n_entries = routing_table_get_n_entries();
+    if (minimise_best_length != n_entries) {
+        log_info("No usable table when the time ran out");
+        comms_sdram->n_best_entries = FAILED_TO_FIND;
+        return;
+    }
+    log_info("Keeping the table of %d entries made before the time ran out",
+            n_entries);
+    routing_tables_save(comms_sdram->routing_tables);
+    comms_sdram->n_best_entries = n_entries;
+}
+
 //! \brief Handle the compression process
 void start_compression_process(void) {
     log_debug("in compression phase");
@@ -97,18 +247,33 @@ void start_compression_process(void) {
     }
 #endif
 
-    // run compression
-    bool success = run_compressor(
-        compress_as_much_as_possible, &failed_by_malloc, &stop_compressing);
+    // run compression; a partition only has to fit together with the
+    // others, so is compressed as much as possible
+    bool success;
+    if (use_cube_cache()) {
+        success = run_compressor_by_cube();
+
+        // The table has been made, so only keep what the sorter allows
+        cube_cache_trim(comms_sdram->cube_cache_bytes);
+    } else {
+        success = run_compressor(
+            compress_as_much_as_possible || (comms_sdram->n_partitions > 1),
+            &failed_by_malloc, &stop_compressing);
+    }
 
     // turn off timer and set us into pause state
     spin1_pause();
 
+    // The sorter reports the algorithm of the table it picks to the host
+    comms_sdram->compressor_path = compressor_path;
+
     // Decode whether we succeeded or failed.
     int max_length = rtr_alloc_max();
     if (success && (routing_table_get_n_entries() <= max_length)) {
         log_info("Passed minimise_run() with success code: %d", success);
+        log_info("Compressed by algorithm %d", compressor_path);
         routing_tables_save(comms_sdram->routing_tables);
+        comms_sdram->n_best_entries = routing_table_get_n_entries();
         comms_sdram->compressor_state = SUCCESSFUL_COMPRESSION;
         return;
     }
@@ -120,10 +285,12 @@ void start_compression_process(void) {
         comms_sdram->compressor_state = FAILED_MALLOC;
     } else if (comms_sdram->sorter_instruction != RUN) {  // control killed it
         log_debug("force fail response");
+        cube_cache_free();
         comms_sdram->compressor_state = FORCED_BY_COMPRESSOR_CONTROL;
         log_debug("send ack");
     } else if (stop_compressing) {  // ran out of time
         log_debug("time fail response");
+        keep_partial_result();
         comms_sdram->compressor_state = RAN_OUT_OF_TIME;
     } else { // after finishing compression, still could not fit into table.
         log_debug("failed by space response");
@@ -133,16 +300,42 @@ void start_compression_process(void) {
 
 //! \brief Initialise the abstraction layer of many routing tables as single
 //!     big table.
-void setup_routing_tables(void) {
+//! \return Whether there was the memory to make the table
+bool setup_routing_tables(void) {
     routing_tables_init(comms_sdram->routing_tables);
 
+    // The table is then built a cube at a time as it is compressed
+    if (use_cube_cache()) {
+        cube_cache_init(comms_sdram->uncompressed_router_table);
+        return true;
+    }
+
+    // Cubes kept from before would only take memory this table needs
+    cube_cache_free();
+
     if (comms_sdram->mid_point == 0) {
         routing_tables_clone_table(comms_sdram->uncompressed_router_table);
+    } else if (comms_sdram->stream_tables) {
+        // The sorter only had the memory for the table once merged
+        if (!bit_field_table_generator_stream_start(comms_sdram->mid_point,
+                comms_sdram->uncompressed_router_table,
+                comms_sdram->sorted_bit_fields)) {
+            return false;
+        }
+        bit_field_table_generator_create_bit_field_router_tables(
+                comms_sdram->mid_point, comms_sdram->uncompressed_router_table,
+                comms_sdram->sorted_bit_fields);
+        bit_field_table_generator_stream_end();
     } else {
         bit_field_table_generator_create_bit_field_router_tables(
                 comms_sdram->mid_point, comms_sdram->uncompressed_router_table,
                 comms_sdram->sorted_bit_fields);
     }
+
+    // If sharing the table with other compressors, keep only our partition
+    table_partition_keep(comms_sdram->partition, comms_sdram->n_partitions);
+    order_generated_table();
+    return true;
 }
 
 //! \brief Run the compressor process as requested
@@ -156,6 +349,10 @@ void run_compression_process(void) {
         log_info("Run with %d tables and no bitfields",
             comms_sdram->routing_tables->n_sub_tables);
     }
+    if (comms_sdram->n_partitions > 1) {
+        log_info("Sharing the table as partition %d of %d",
+            comms_sdram->partition, comms_sdram->n_partitions);
+    }
     log_debug("setting up fake heap for sdram usage");
     malloc_extras_initialise_with_fake_heap(comms_sdram->fake_heap_data);
     log_debug("set up fake heap for sdram usage");
@@ -164,8 +361,13 @@ void run_compression_process(void) {
     failed_by_malloc = false;
     stop_compressing = false;
     counter = 0;
+    minimise_best_length = FAILED_TO_FIND;
+    comms_sdram->n_best_entries = FAILED_TO_FIND;
 
-    setup_routing_tables();
+    if (!setup_routing_tables()) {
+        comms_sdram->compressor_state = FAILED_MALLOC;
+        return;
+    }
 
     log_info("starting compression attempt with %d entries",
             routing_table_get_n_entries());
@@ -254,6 +456,7 @@ static inline bool process_force(compressor_states compressor_state) {
        log_info("Force detected so changing result to ack");
        // The results other than MALLOC no longer matters
        comms_sdram->compressor_state = FORCED_BY_COMPRESSOR_CONTROL;
+       cube_cache_free();
        return true;
    case PREPARED:
    case UNUSED:
@@ -308,6 +511,7 @@ static void wait_for_instructions(uint unused0, uint unused1) {
         break;
     case DO_NOT_USE:
         log_info("DO_NOT_USE detected exiting wait");
+        cube_cache_free();
         return;
     }
     if (users_match) {
@@ -330,6 +534,11 @@ static void timer_callback(uint unused0, uint unused1) {
     use(unused1);
     counter++;
 
+    // Checkpoint the progress; the cubes are only put together at the end
+    if (!use_cube_cache()) {
+        comms_sdram->n_best_entries = minimise_best_length;
+    }
+
     if (counter >= max_counter) {
         stop_compressing = true;
         log_info("passed timer point");
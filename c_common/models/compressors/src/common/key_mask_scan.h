@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Scanning a range of the routing table for key_masks that
+//!     intersect one.
+//! \details The compressors spend much of their time looking for the first
+//!     entry of a range that would match any of the same keys as a key_mask.
+//!     The entries are held as key, mask, route and source together, but the
+//!     check only needs the key and mask. On host builds for x86 the keys and
+//!     masks of a block of entries are pulled apart into a register each, so
+//!     that a block is checked with one compare: 4 entries with SSE2, or 8
+//!     with AVX2 (build with `-mavx2`). Other builds, including those for
+//!     SpiNNaker, check one entry at a time.
+#ifndef __KEY_MASK_SCAN_H__
+#define __KEY_MASK_SCAN_H__
+
+#include "routing_table.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__)
+//! The number of entries checked at once
+#define KEY_MASK_SCAN_BLOCK 8
+
+//! \brief Find which of a block of entries intersect a key_mask
+//! \param[in] entries: The block of entries
+//! \param[in] km: The key_mask to check against
+//! \return A bit set for each entry that may intersect, in no set order
+static inline uint32_t _key_mask_scan_block(
+        const entry_t *entries, key_mask_t km) {
+    const __m256i *words = (const __m256i *) entries;
+    __m256i e01 = _mm256_loadu_si256(&words[0]);
+    __m256i e23 = _mm256_loadu_si256(&words[1]);
+    __m256i e45 = _mm256_loadu_si256(&words[2]);
+    __m256i e67 = _mm256_loadu_si256(&words[3]);
+
+    // Each 128-bit half holds an entry; interleave them down to the keys
+    // of all eight entries in one register and their masks in another
+    __m256i km02 = _mm256_unpacklo_epi32(e01, e23);
+    __m256i km46 = _mm256_unpacklo_epi32(e45, e67);
+    __m256i keys = _mm256_unpacklo_epi64(km02, km46);
+    __m256i masks = _mm256_unpackhi_epi64(km02, km46);
+
+    __m256i equal = _mm256_cmpeq_epi32(
+            _mm256_and_si256(keys, _mm256_set1_epi32(km.mask)),
+            _mm256_and_si256(masks, _mm256_set1_epi32(km.key)));
+    return _mm256_movemask_ps(_mm256_castsi256_ps(equal));
+}
+#elif defined(__SSE2__)
+//! The number of entries checked at once
+#define KEY_MASK_SCAN_BLOCK 4
+
+//! \brief Find which of a block of entries intersect a key_mask
+//! \param[in] entries: The block of entries
+//! \param[in] km: The key_mask to check against
+//! \return A bit set for each entry that may intersect, in no set order
+static inline uint32_t _key_mask_scan_block(
+        const entry_t *entries, key_mask_t km) {
+    const __m128i *words = (const __m128i *) entries;
+    __m128i km01 = _mm_unpacklo_epi32(
+            _mm_loadu_si128(&words[0]), _mm_loadu_si128(&words[1]));
+    __m128i km23 = _mm_unpacklo_epi32(
+            _mm_loadu_si128(&words[2]), _mm_loadu_si128(&words[3]));
+    __m128i keys = _mm_unpacklo_epi64(km01, km23);
+    __m128i masks = _mm_unpackhi_epi64(km01, km23);
+
+    __m128i equal = _mm_cmpeq_epi32(
+            _mm_and_si128(keys, _mm_set1_epi32(km.mask)),
+            _mm_and_si128(masks, _mm_set1_epi32(km.key)));
+    return _mm_movemask_ps(_mm_castsi128_ps(equal));
+}
+#endif
+
+//! \brief Find the first of a run of entries that intersects a key_mask
+//! \param[in] entries: The run of entries
+//! \param[in] n_entries: The number of entries in the run
+//! \param[in] km: The key_mask to check against
+//! \return The index in the run of the first entry that intersects, or
+//!     n_entries if none do
+static inline uint32_t key_mask_scan_run(
+        const entry_t *entries, uint32_t n_entries, key_mask_t km) {
+    uint32_t i = 0;
+#ifdef KEY_MASK_SCAN_BLOCK
+    for (; i + KEY_MASK_SCAN_BLOCK <= n_entries; i += KEY_MASK_SCAN_BLOCK) {
+        if (_key_mask_scan_block(&entries[i], km) != 0) {
+            // The block holds one; find which is first
+            break;
+        }
+    }
+#endif
+    for (; i < n_entries; i++) {
+        if (key_mask_intersect(entries[i].key_mask, km)) {
+            return i;
+        }
+    }
+    return n_entries;
+}
+
+//! \brief Find the first of a range of table entries that intersects a
+//!     key_mask
+//! \param[in] km: The key_mask to check against
+//! \param[in] start: The index of the first entry to check
+//! \param[in] end: One past the index of the last entry to check
+//! \return The index of the first entry that intersects, or end if none do
+static inline uint32_t key_mask_scan_table(
+        key_mask_t km, uint32_t start, uint32_t end) {
+    if (start >= end) {
+        return end;
+    }
+    routing_table_cursor_t cursor;
+    routing_table_cursor_init(&cursor, start, end);
+    uint32_t index = start;
+    while (index < end) {
+        routing_table_cursor_fill(&cursor);
+        uint32_t n_run = cursor.stop - cursor.entry;
+        uint32_t found = key_mask_scan_run(cursor.entry, n_run, km);
+        if (found < n_run) {
+            return index + found;
+        }
+        index += n_run;
+    }
+    return end;
+}
+
+#endif  // __KEY_MASK_SCAN_H__
@@ -21,6 +21,15 @@
 #ifndef __MINIMISE_H__
 #define __MINIMISE_H__
 
+//! \brief The length of the table minimise_run() could stop with now
+//! \details Updated by minimise_run() each time the table is in a state that
+//!     it could be left in, so that an interrupt can read it to report
+//!     progress. When minimise_run() is asked to stop, it leaves the table at
+//!     this length and still routing every key the way the table it was given
+//!     did, so the partial result can still be used. -1 if the table is not
+//!     in such a state.
+static volatile int minimise_best_length = -1;
+
 //! \brief Apply the ordered covering algorithm to a routing table
 //! \details Minimise the table until either the table is shorter than the
 //!     target length or no more merges are possible.
@@ -28,6 +37,7 @@
 //! \param[out] failed_by_malloc: Flag stating that it failed due to malloc
 //! \param[out] stop_compressing: Variable saying if the compressor should stop
 //!    and return false; _set by interrupt_ DURING the run of this method!
+//!    The table is then left as described for ::minimise_best_length
 //! \return Whether successful or not.
 bool minimise_run(
         int target_length, bool *failed_by_malloc,
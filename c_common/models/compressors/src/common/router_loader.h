@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Loading of a compressed table into the router a block at a time.
+//! \details The compressed table is usually in SDRAM. Rather than reading
+//!     and checking each entry and calling `rtr_mc_set()` for it, a block of
+//!     entries is copied into DTCM at once, the words the router wants are
+//!     prepared there, and the block is then written straight into the
+//!     multicast RAM of the router. How long this took is kept so that it
+//!     can be reported to the host as provenance.
+#ifndef __ROUTER_LOADER_H__
+#define __ROUTER_LOADER_H__
+
+#include <sark.h>
+#include <debug.h>
+#include "routing_table.h"
+
+//! The number of entries copied into DTCM and written at a time
+#define ROUTER_LOADER_BLOCK_ENTRIES 64
+
+//! The number of entries the multicast RAM of the router holds
+#define ROUTER_LOADER_MC_TABLE_SIZE 1024
+
+//! Where the route, which includes the owning app ID, goes in a route word
+#define ROUTER_LOADER_APP_ID_SHIFT 24
+
+//! Timer control: enabled, free-running, 32-bit, no prescale
+#define ROUTER_LOADER_TIMER_CONTROL 0x82
+
+//! \brief The words of an entry as the router holds them
+typedef struct router_loader_word_t {
+    //! The route, with the app ID in the top byte
+    uint32_t route;
+
+    //! The key
+    uint32_t key;
+
+    //! The mask
+    uint32_t mask;
+} router_loader_word_t;
+
+//! The block of entries being loaded, in DTCM
+static entry_t router_loader_block[ROUTER_LOADER_BLOCK_ENTRIES];
+
+//! The words of the block, ready for the router
+static router_loader_word_t router_loader_words[ROUTER_LOADER_BLOCK_ENTRIES];
+
+//! How long the last load took, in microseconds
+static uint32_t router_loader_load_time_us = 0;
+
+//! \brief Start the timer that times a load
+//! \return The count of the timer when started
+static inline uint32_t router_loader_timer_start(void) {
+    tc[T2_CONTROL] = ROUTER_LOADER_TIMER_CONTROL;
+    return tc[T2_COUNT];
+}
+
+//! \brief Get how long it is since the timer was started
+//! \param[in] start: The count of the timer when started
+//! \return The time since then in microseconds
+static inline uint32_t router_loader_timer_us(uint32_t start) {
+    // The timer counts down once per clock cycle
+    return (start - tc[T2_COUNT]) / sv->cpu_clk;
+}
+
+//! \brief Prepare the words of a block of entries in DTCM
+//! \param[in] n_entries: The number of entries in the block
+//! \param[in] app_id: The app ID to own the entries
+//! \param[in] first_index: The index in the table of the first entry, for
+//!     reporting
+//! \return The number of entries ready to write; entries the router cannot
+//!     hold are reported and left out
+static inline uint32_t router_loader_prepare_block(
+        uint32_t n_entries, uint32_t app_id, uint32_t first_index) {
+    uint32_t app_id_bits = app_id << ROUTER_LOADER_APP_ID_SHIFT;
+    uint32_t n_ready = 0;
+    for (uint32_t i = 0; i < n_entries; i++) {
+        const entry_t *entry = &router_loader_block[i];
+
+        // A key with bits outside its mask can never match, and the router
+        // refuses it as rtr_mc_set() does
+        if ((entry->key_mask.key & ~entry->key_mask.mask) != 0) {
+            log_error("failed to set a router table entry at index %d",
+                    first_index + i);
+            continue;
+        }
+        router_loader_word_t *word = &router_loader_words[n_ready++];
+        word->route = entry->route | app_id_bits;
+        word->key = entry->key_mask.key;
+        word->mask = entry->key_mask.mask;
+    }
+    return n_ready;
+}
+
+//! \brief Load a table into router entries already allocated for it
+//! \param[in] entries: The entries to load, in order
+//! \param[in] n_entries: The number of entries to load
+//! \param[in] app_id: The app ID to own the entries
+//! \param[in] start_entry: The first router entry of the allocation
+//! \return Whether every entry was loaded
+static bool router_loader_load(
+        const entry_t *entries, uint32_t n_entries, uint32_t app_id,
+        uint32_t start_entry) {
+    uint32_t start_time = router_loader_timer_start();
+    if (start_entry + n_entries > ROUTER_LOADER_MC_TABLE_SIZE) {
+        log_error("cannot load %d entries at router entry %d",
+                n_entries, start_entry);
+        return false;
+    }
+
+    volatile uint32_t *routes = (volatile uint32_t *) RTR_MCRAM_BASE;
+    volatile uint32_t *keys = (volatile uint32_t *) RTR_MCKEY_BASE;
+    volatile uint32_t *masks = (volatile uint32_t *) RTR_MCMASK_BASE;
+    bool all_loaded = true;
+    uint32_t next_entry = start_entry;
+    for (uint32_t first = 0; first < n_entries;
+            first += ROUTER_LOADER_BLOCK_ENTRIES) {
+        uint32_t n_block = n_entries - first;
+        if (n_block > ROUTER_LOADER_BLOCK_ENTRIES) {
+            n_block = ROUTER_LOADER_BLOCK_ENTRIES;
+        }
+        spin1_memcpy(router_loader_block, &entries[first],
+                n_block * sizeof(entry_t));
+        uint32_t n_ready = router_loader_prepare_block(n_block, app_id, first);
+        all_loaded = all_loaded && (n_ready == n_block);
+
+        // Each entry is written route first, as rtr_mc_set() does
+        for (uint32_t i = 0; i < n_ready; i++) {
+            routes[next_entry] = router_loader_words[i].route;
+            keys[next_entry] = router_loader_words[i].key;
+            masks[next_entry] = router_loader_words[i].mask;
+            next_entry++;
+        }
+    }
+
+    router_loader_load_time_us = router_loader_timer_us(start_time);
+    log_info("loaded %d entries into the router in %u us",
+            next_entry - start_entry, router_loader_load_time_us);
+    return all_loaded;
+}
+
+#endif  // __ROUTER_LOADER_H__
@@ -69,6 +69,65 @@ int routing_table_get_n_entries(void);
 //! \param[in] size_to_remove: the amount of size to remove from the table sets
 void routing_table_remove_from_size(int size_to_remove);
 
+//! \brief Give back entries taken off the end of the table
+//! \details The entries come back as they were when
+//!     routing_table_remove_from_size() took them off, unless they have been
+//!     written over since.
+//!
+//! will RTE if this makes the table larger than it has ever been.
+//! \param[in] size_to_restore: the number of entries to give back
+void routing_table_restore_size(int size_to_restore);
+
+//! \brief A position in the routing table for reading entries in order
+//! \details The entries are handed out a run of contiguous memory at a time,
+//!     so getting the next entry is usually just moving a pointer on.
+typedef struct routing_table_cursor_t {
+    //! The next entry to hand out
+    entry_t *entry;
+
+    //! One past the last entry of the run being handed out
+    entry_t *stop;
+
+    //! The index of the first entry after the run
+    uint32_t next_index;
+
+    //! The index to stop at
+    uint32_t end_index;
+} routing_table_cursor_t;
+
+//! \brief Get the next run of contiguous entries for a cursor
+//! \details The run starts at next_index and does not go past end_index,
+//!     which the caller has checked are different
+//! \param[in,out] cursor: The cursor to move to the next run
+void routing_table_cursor_fill(routing_table_cursor_t *cursor);
+
+//! \brief Start reading a range of entries in order
+//! \details The entries must not be added to or removed while being read
+//! \param[out] cursor: The cursor to set up
+//! \param[in] start: The index of the first entry to read
+//! \param[in] end: One past the index of the last entry to read
+static inline void routing_table_cursor_init(
+        routing_table_cursor_t *cursor, uint32_t start, uint32_t end) {
+    cursor->entry = NULL;
+    cursor->stop = NULL;
+    cursor->next_index = start;
+    cursor->end_index = end;
+}
+
+//! \brief Get the next entry from a cursor
+//! \param[in,out] cursor: The cursor to read from
+//! \return The entry, or NULL once past the end of the range
+static inline entry_t *routing_table_cursor_next(
+        routing_table_cursor_t *cursor) {
+    if (cursor->entry == cursor->stop) {
+        if (cursor->next_index >= cursor->end_index) {
+            return NULL;
+        }
+        routing_table_cursor_fill(cursor);
+    }
+    return cursor->entry++;
+}
+
 //! \brief Write an entry to a specific index
 //! \param[in] entry: The entry to write
 //! \param[in] index: Where to write it.
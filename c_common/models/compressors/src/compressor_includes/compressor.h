@@ -29,7 +29,16 @@
  * (entry_t is defined in `routing_table.h` but is described below).
  */
 #include <debug.h>
-#ifdef USE_PAIR
+#include <malloc_extras.h>
+#ifdef USE_ADAPTIVE
+    // Both algorithms are built in, each under a name of its own
+    #define minimise_run pair_minimise_run
+    #include "pair_minimize.h"
+    #undef minimise_run
+    #define minimise_run oc_minimise_run
+    #include "ordered_covering_includes/ordered_covering.h"
+    #undef minimise_run
+#elif defined(USE_PAIR)
     #include "pair_minimize.h"
 #else
     #include "ordered_covering_includes/ordered_covering.h"
@@ -37,7 +46,132 @@
 #include "remove_default_routes.h"
 #include "../common/routing_table.h"
 
+//! \brief The algorithm that compressed a table
+//! \details Reported to the host, so the values must match those in
+//!     `compression.py`
+typedef enum compressor_path_t {
+    //! The table fitted without merging any entries
+    COMPRESSOR_PATH_NONE = 0,
+    //! The table was compressed by the pair compressor
+    COMPRESSOR_PATH_PAIR = 1,
+    //! The table was compressed by ordered covering
+    COMPRESSOR_PATH_ORDERED_COVERING = 2
+} compressor_path_t;
+
+//! The algorithm that compressed the last table
+static compressor_path_t compressor_path = COMPRESSOR_PATH_NONE;
+
+//! \brief The signature of minimise_run() of an algorithm
+typedef bool (*compressor_minimise_t)(
+        int target_length, bool *failed_by_malloc,
+        volatile bool *stop_compressing);
+
+//! \brief Compress the table with one algorithm
+//! \param[in] minimise: The minimise_run() of the algorithm
+//! \param[in] path: Which algorithm it is
+//! \param[in] target_length: The length to reach
+//! \param[out] failed_by_malloc: Flag stating that it failed due to malloc
+//! \param[in] stop_compressing: Variable saying if the compressor should stop
+//! \return Whether the table was compressed; it may still not fit the router
+static bool _compress_with(
+        compressor_minimise_t minimise, compressor_path_t path,
+        int target_length, bool *failed_by_malloc,
+        volatile bool *stop_compressing) {
+    compressor_path = COMPRESSOR_PATH_NONE;
+    if (remove_default_routes_minimise(target_length)) {
+        return true;
+    }
+    minimise_best_length = routing_table_get_n_entries();
+
+    if (*stop_compressing) {
+        log_info("Not compressing as asked to stop");
+        return false;
+    }
+    // Perform the minimisation
+    log_debug("minimise");
+    compressor_path = path;
+    return minimise(target_length, failed_by_malloc, stop_compressing);
+}
+
+#ifdef USE_ADAPTIVE
+//! \brief Copy the table, so that it can be compressed again from the start
+//! \param[in] n_entries: The number of entries in the table
+//! \return The copy, or NULL if there is no room for it
+static entry_t *_copy_table(int n_entries) {
+    entry_t *copy = MALLOC(n_entries * sizeof(entry_t));
+    if (copy == NULL) {
+        return NULL;
+    }
+    routing_table_cursor_t cursor;
+    routing_table_cursor_init(&cursor, 0, n_entries);
+    entry_t *entry;
+    for (int i = 0; (entry = routing_table_cursor_next(&cursor)) != NULL;
+            i++) {
+        copy[i] = *entry;
+    }
+    return copy;
+}
+
+//! \brief Put back the table as copied by _copy_table()
+//! \details The table has only got shorter since, so the entries are still
+//!     there to write over.
+//! \param[in] copy: The copy
+//! \param[in] n_entries: The number of entries in the copy
+static void _restore_table(const entry_t *copy, int n_entries) {
+    routing_table_restore_size(n_entries - routing_table_get_n_entries());
+    for (int i = 0; i < n_entries; i++) {
+        routing_table_put_entry(&copy[i], i);
+    }
+}
+
+//! \brief Compress the table with pair, then with ordered covering only if
+//!     the pair result does not fit in the router
+//! \details Pair is much the faster, and its result fits most tables.
+//!     Ordered covering needs the table as it was given, as it relies on
+//!     the entries being orthogonal, so it starts again from a copy.
+//! \param[in] target_length: The length to reach
+//! \param[out] failed_by_malloc: Flag stating that it failed due to malloc
+//! \param[in] stop_compressing: Variable saying if the compressor should stop
+//! \return Whether the table was compressed; it may still not fit the router
+static bool _compress_adaptive(
+        int target_length, bool *failed_by_malloc,
+        volatile bool *stop_compressing) {
+    int n_entries = routing_table_get_n_entries();
+    entry_t *copy = _copy_table(n_entries);
+    if (copy == NULL) {
+        log_info("No room to keep the table, so only trying pair");
+    }
+    bool success = _compress_with(
+            pair_minimise_run, COMPRESSOR_PATH_PAIR, target_length,
+            failed_by_malloc, stop_compressing);
+    if ((copy == NULL) || (success &&
+            (routing_table_get_n_entries() <= (int) rtr_alloc_max()))) {
+        if (copy != NULL) {
+            FREE(copy);
+        }
+        return success;
+    }
+    if (*stop_compressing) {
+        // Keep whatever pair got to, as there is no time to do better
+        FREE(copy);
+        return success;
+    }
+
+    log_info("Pair left %d entries; trying ordered covering",
+            routing_table_get_n_entries());
+    _restore_table(copy, n_entries);
+    FREE(copy);
+    *failed_by_malloc = false;
+    return _compress_with(
+            oc_minimise_run, COMPRESSOR_PATH_ORDERED_COVERING, target_length,
+            failed_by_malloc, stop_compressing);
+}
+#endif
+
 //! \brief The callback for setting off the router compressor
+//! \details With `USE_ADAPTIVE` the pair compressor is tried first, and
+//!     ordered covering only if that does not fit; ::compressor_path says
+//!     which was used.
 //! \param[in] compress_as_much_as_possible: Only compress to normal routing
 //!       table length
 //! \param[out] failed_by_malloc: Flag stating that it failed due to malloc
@@ -52,20 +186,21 @@ bool run_compressor(int compress_as_much_as_possible, bool *failed_by_malloc,
         target_length = rtr_alloc_max();
     }
     log_info("target length of %d", target_length);
-    if (remove_default_routes_minimise(target_length)) {
-        return true;
-    }
-
-    if (*stop_compressing) {
-        log_info("Not compressing as asked to stop");
-        return false;
-    }
-    // Perform the minimisation
-    log_debug("minimise");
-    if (minimise_run(target_length, failed_by_malloc, stop_compressing)) {
+#ifdef USE_ADAPTIVE
+    bool success = _compress_adaptive(
+            target_length, failed_by_malloc, stop_compressing);
+#elif defined(USE_PAIR)
+    bool success = _compress_with(
+            minimise_run, COMPRESSOR_PATH_PAIR, target_length,
+            failed_by_malloc, stop_compressing);
+#else
+    bool success = _compress_with(
+            minimise_run, COMPRESSOR_PATH_ORDERED_COVERING, target_length,
+            failed_by_malloc, stop_compressing);
+#endif
+    if (success) {
         return routing_table_get_n_entries() <= (int) rtr_alloc_max();
     } else {
         return false;
     }
-
 }
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Index of routing table key_masks for fast intersection checks.
+//! \details Entries are bucketed by the highest bit their mask leaves
+//!     clear (their "level"), and each level is sorted by key. All the
+//!     bits above a level are fixed for every entry in it, so the entries
+//!     of a level that can intersect a key_mask form a single run of keys
+//!     that can be found with a binary search.
+//!
+//!     Entries are indexed by their position in the routing table. Only
+//!     entries at or after a moving start position are considered live;
+//!     the ones before it are skipped and are compacted away once they
+//!     make up most of the index.
+#ifndef __KEY_MASK_INDEX_H__
+#define __KEY_MASK_INDEX_H__
+
+#include <debug.h>
+#include <malloc_extras.h>
+#include "../common/routing_table.h"
+
+//! Number of levels; one per bit plus one for masks with no clear bits
+#define KEY_MASK_INDEX_LEVELS 33
+
+//! \brief An indexed copy of a routing table key_mask
+typedef struct key_mask_index_entry_t {
+    //! The key_mask of the entry
+    key_mask_t key_mask;
+
+    //! Position of the entry in the routing table
+    int index;
+} key_mask_index_entry_t;
+
+//! \brief An index over a range of the routing table
+typedef struct key_mask_index_t {
+    //! The indexed entries, grouped by level and sorted by key in each level
+    key_mask_index_entry_t *entries;
+
+    //! Where each level starts in entries; the last is the number of entries
+    int level_start[KEY_MASK_INDEX_LEVELS + 1];
+
+    //! Positions before this are no longer live
+    int first_live;
+
+    //! Positions before this have been compacted out of entries
+    int first_held;
+
+    //! One past the last indexed position
+    int end;
+} key_mask_index_t;
+
+//! \brief Get the level of a key_mask
+//! \param[in] km: the key_mask
+//! \return one more than the highest bit clear in the mask, or 0 if none
+static inline int _key_mask_index_level(key_mask_t km) {
+    uint32_t clear = ~km.mask;
+    if (clear == 0) {
+        return 0;
+    }
+    return 32 - __builtin_clz(clear);
+}
+
+//! \brief Get the bits of a key that are free within a level
+//! \param[in] level: the level, as given by _key_mask_index_level
+//! \return a mask of the bits below and including the level's top clear bit
+static inline uint32_t _key_mask_index_low_bits(int level) {
+    if (level >= 32) {
+        return 0xFFFFFFFF;
+    }
+    return (1u << level) - 1;
+}
+
+//! \brief Restore the heap property below an entry; used by the sort
+//! \param[in] base: the first entry of the heap
+//! \param[in] root: the entry to sift down
+//! \param[in] n: the number of entries in the heap
+static inline void _key_mask_index_sift(
+        key_mask_index_entry_t *base, int root, int n) {
+    key_mask_index_entry_t item = base[root];
+    int child = 2 * root + 1;
+    while (child < n) {
+        if (child + 1 < n &&
+                base[child + 1].key_mask.key > base[child].key_mask.key) {
+            child++;
+        }
+        if (base[child].key_mask.key <= item.key_mask.key) {
+            break;
+        }
+        base[root] = base[child];
+        root = child;
+        child = 2 * root + 1;
+    }
+    base[root] = item;
+}
+
+//! \brief Sort a run of entries by key; heapsort, so no recursion
+//! \param[in] base: the first entry to sort
+//! \param[in] n: the number of entries to sort
+static void _key_mask_index_sort(key_mask_index_entry_t *base, int n) {
+    for (int i = n / 2 - 1; i >= 0; i--) {
+        _key_mask_index_sift(base, i, n);
+    }
+    for (int i = n - 1; i > 0; i--) {
+        key_mask_index_entry_t temp = base[0];
+        base[0] = base[i];
+        base[i] = temp;
+        _key_mask_index_sift(base, 0, i);
+    }
+}
+
+//! \brief Build an index over a range of the routing table
+//! \details The table entries in the range must not move or change while
+//!     they are live in the index.
+//! \param[out] idx: the index to build
+//! \param[in] start: the first table position to index
+//! \param[in] end: one past the last table position to index
+//! \return whether the index was built; false if out of memory
+static bool key_mask_index_init(key_mask_index_t *idx, int start, int end) {
+    idx->first_live = start;
+    idx->first_held = start;
+    idx->end = end;
+    idx->entries = MALLOC((end - start) * sizeof(key_mask_index_entry_t));
+    if (idx->entries == NULL) {
+        log_warning("No memory for a key_mask index of %d entries",
+                end - start);
+        return false;
+    }
+
+    // Count the entries on each level, then turn the counts into offsets
+    for (int level = 0; level <= KEY_MASK_INDEX_LEVELS; level++) {
+        idx->level_start[level] = 0;
+    }
+    for (int i = start; i < end; i++) {
+        key_mask_t km = routing_table_get_entry(i)->key_mask;
+        idx->level_start[_key_mask_index_level(km) + 1]++;
+    }
+    for (int level = 0; level < KEY_MASK_INDEX_LEVELS; level++) {
+        idx->level_start[level + 1] += idx->level_start[level];
+    }
+
+    // Place the entries; level_start[level] is used as the write position
+    // and ends up at the start of the next level, so shift them back
+    for (int i = start; i < end; i++) {
+        key_mask_t km = routing_table_get_entry(i)->key_mask;
+        int level = _key_mask_index_level(km);
+        key_mask_index_entry_t *e = &idx->entries[idx->level_start[level]++];
+        e->key_mask = km;
+        e->index = i;
+    }
+    for (int level = KEY_MASK_INDEX_LEVELS; level > 0; level--) {
+        idx->level_start[level] = idx->level_start[level - 1];
+    }
+    idx->level_start[0] = 0;
+
+    for (int level = 0; level < KEY_MASK_INDEX_LEVELS; level++) {
+        _key_mask_index_sort(&idx->entries[idx->level_start[level]],
+                idx->level_start[level + 1] - idx->level_start[level]);
+    }
+    return true;
+}
+
+//! \brief Free the memory used by an index
+//! \param[in] idx: the index to free
+static inline void key_mask_index_delete(key_mask_index_t *idx) {
+    if (idx->entries != NULL) {
+        FREE(idx->entries);
+        idx->entries = NULL;
+    }
+}
+
+//! \brief Mark the table positions before a point as no longer live
+//! \details Compacts the dead entries out of the index once there are more
+//!     of them held than live entries.
+//! \param[in] idx: the index to update
+//! \param[in] first_live: the first table position that is still live
+static void key_mask_index_retire_before(
+        key_mask_index_t *idx, int first_live) {
+    idx->first_live = first_live;
+    if (first_live - idx->first_held <= idx->end - first_live) {
+        return;
+    }
+
+    int write = 0;
+    for (int level = 0; level < KEY_MASK_INDEX_LEVELS; level++) {
+        int read = idx->level_start[level];
+        int level_end = idx->level_start[level + 1];
+        idx->level_start[level] = write;
+        for (; read < level_end; read++) {
+            if (idx->entries[read].index >= first_live) {
+                idx->entries[write++] = idx->entries[read];
+            }
+        }
+    }
+    idx->level_start[KEY_MASK_INDEX_LEVELS] = write;
+    idx->first_held = first_live;
+}
+
+//! \brief Find the first entry in a level with a key at least a value
+//! \param[in] idx: the index to search
+//! \param[in] level: the level to search
+//! \param[in] key: the lowest key wanted
+//! \return the position in entries of the first such entry, or the end of
+//!     the level if there is none
+static inline int _key_mask_index_lower_bound(
+        key_mask_index_t *idx, int level, uint32_t key) {
+    int low = idx->level_start[level];
+    int high = idx->level_start[level + 1];
+    while (low < high) {
+        int mid = low + ((high - low) >> 1);
+        if (idx->entries[mid].key_mask.key < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+//! \brief Determine if any live entry in the index intersects a key_mask
+//! \param[in] idx: the index to search
+//! \param[in] km: the key_mask to check
+//! \return whether any live entry would match any of the same keys
+static bool key_mask_index_intersects(key_mask_index_t *idx, key_mask_t km) {
+    int km_level = _key_mask_index_level(km);
+    for (int level = 0; level < KEY_MASK_INDEX_LEVELS; level++) {
+        if (idx->level_start[level] == idx->level_start[level + 1]) {
+            continue;
+        }
+
+        // Both masks are set above the higher level, so the keys must agree
+        uint32_t low_bits = _key_mask_index_low_bits(
+                (level > km_level) ? level : km_level);
+        uint32_t last_key = km.key | low_bits;
+        int level_end = idx->level_start[level + 1];
+        int i = _key_mask_index_lower_bound(idx, level, km.key & ~low_bits);
+        for (; i < level_end && idx->entries[i].key_mask.key <= last_key;
+                i++) {
+            if (idx->entries[i].index >= idx->first_live &&
+                    key_mask_intersect(idx->entries[i].key_mask, km)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+#endif  // __KEY_MASK_INDEX_H__
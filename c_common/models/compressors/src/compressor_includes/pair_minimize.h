@@ -30,6 +30,9 @@
  */
 #include <debug.h>
 #include "../common/routing_table.h"
+#include "../common/minimise.h"
+#include "../common/key_mask_scan.h"
+#include "key_mask_index.h"
 
 //! Absolute maximum number of routes that we may produce
 #define MAX_NUM_ROUTES 1023
@@ -49,6 +52,45 @@ static uint32_t routes_frequency[MAX_NUM_ROUTES] = {0};
 //! Count of unique routes (as opposed to routes with just different key_masks).
 static uint32_t routes_count;
 
+//! \brief Bits in a route_hash index; route_hash has at least twice
+//!     MAX_NUM_ROUTES slots so that probe sequences stay short.
+#define ROUTE_HASH_BITS 11
+
+//! Number of slots in route_hash
+#define ROUTE_HASH_SIZE (1 << ROUTE_HASH_BITS)
+
+//! \brief Open-addressed hash of route to one more than its index in
+//!     routes; 0 marks an empty slot.
+static uint16_t route_hash[ROUTE_HASH_SIZE];
+
+//! Index over the entries from remaining_index onwards.
+static key_mask_index_t remaining_entries;
+
+//! Whether remaining_entries could be built; if not the entries are scanned.
+static bool remaining_entries_indexed;
+
+//! \brief Find the route_hash slot for a route
+//! \param[in] route: The route to look for
+//! \return The slot holding the route, or the empty slot where it would go
+static inline uint16_t *route_hash_find(uint32_t route) {
+    // Fibonacci hashing; the top bits of the product are the best mixed
+    uint32_t i = (route * 2654435761u) >> (32 - ROUTE_HASH_BITS);
+    while (route_hash[i] != 0 && routes[route_hash[i] - 1] != route) {
+        i = (i + 1) & (ROUTE_HASH_SIZE - 1);
+    }
+    return &route_hash[i];
+}
+
+//! \brief Refill route_hash from routes, e.g. after routes have been sorted
+static inline void route_hash_rebuild(void) {
+    for (uint i = 0; i < ROUTE_HASH_SIZE; i++) {
+        route_hash[i] = 0;
+    }
+    for (uint i = 0; i < routes_count; i++) {
+        *route_hash_find(routes[i]) = i + 1;
+    }
+}
+
 //! \brief Merges a single pair of route entries.
 //! \param[in] entry1: The first route to merge.
 //! \param[in] entry2: The second route to merge.
@@ -83,12 +125,14 @@ static inline bool find_merge(int left, int index) {
     const entry_t *entry2 = routing_table_get_entry(index);
     const entry_t merged = merge(entry1, entry2);
 
-    for (int check = remaining_index;
-            check < routing_table_get_n_entries();
-            check++) {
-        const entry_t *check_entry =
-                routing_table_get_entry(check);
-        if (key_mask_intersect(check_entry->key_mask, merged.key_mask)) {
+    if (remaining_entries_indexed) {
+        if (key_mask_index_intersects(&remaining_entries, merged.key_mask)) {
+            return false;
+        }
+    } else {
+        uint32_t n_entries = routing_table_get_n_entries();
+        if (key_mask_scan_table(merged.key_mask, remaining_index, n_entries)
+                < n_entries) {
             return false;
         }
     }
@@ -119,27 +163,17 @@ static inline void compress_by_route(int left, int right) {
     }
 }
 
-//! \brief Compare routes based on their index
-//! \param[in] route_a: The first route
-//! \param[in] route_b: The second route
-//! \return Ordering term (-1, 0, 1)
-static inline int compare_routes(uint32_t route_a, uint32_t route_b) {
-    if (route_a == route_b) {
-        return 0;
-    }
-    for (uint i = 0; i < routes_count; i++) {
-        if (routes[i] == route_a) {
-            return 1;
-        }
-        if (routes[i] == route_b) {
-            return -1;
-        }
+//! \brief Get the rank of a route once the routes have been sorted
+//! \param[in] route: The route to look up
+//! \return The index of the route in routes
+static inline int route_rank(uint32_t route) {
+    uint16_t slot = *route_hash_find(route);
+    if (slot == 0) {
+        log_error("Route not found %u", route);
+        // set the failed flag and exit
+        malloc_extras_terminate(EXIT_FAIL);
     }
-    log_error("Routes not found %u %u", route_a, route_b);
-    // set the failed flag and exit
-    malloc_extras_terminate(EXIT_FAIL);
-
-    return 0;
+    return slot - 1;
 }
 
 //! \brief Implementation of quicksort for routes based on route information
@@ -150,7 +184,7 @@ static inline int compare_routes(uint32_t route_a, uint32_t route_b) {
 static void quicksort_table(int low, int high) {
     if (low < high - 1) {
         // pick low entry for the pivot
-        uint32_t pivot = routing_table_get_entry(low)->route;
+        int pivot = route_rank(routing_table_get_entry(low)->route);
         // Location of entry currently being checked.
         // At the end check will point to either
         //     the right most entry with a value greater than the pivot
@@ -167,14 +201,13 @@ static void quicksort_table(int low, int high) {
         int h_write = high - 1;
 
         while (check <= h_write) {
-            uint32_t check_route =
-                    routing_table_get_entry(check)->route;
-            int compare = compare_routes(check_route, pivot);
-            if (compare < 0) {
+            // Less frequent routes have a lower rank and go later in the table
+            int check_rank = route_rank(routing_table_get_entry(check)->route);
+            if (check_rank > pivot) {
                 // swap the check to the left, and then
                 // move the check on as known to be pivot value
                 swap_entries(l_write++, check++);
-            } else if (compare > 0) {
+            } else if (check_rank < pivot) {
                 // swap the check to the right
                 // Do not move the check as it has an unknown value
                 swap_entries(h_write--, check);
@@ -253,23 +286,25 @@ static void quicksort_route(int low, int high) {
 
 //! \brief Computes route histogram
 //! \param[in] index: The index of the cell to update
-static inline void update_frequency(int index) {
+//! \return Whether there is room for another route; if not, the table has
+//!     too many routes to fit in the router
+static inline bool update_frequency(int index) {
     uint32_t route = routing_table_get_entry(index)->route;
-    for (uint i = 0; i < routes_count; i++) {
-        if (routes[i] == route) {
-            routes_frequency[i]++;
-            return;
-        }
+    uint16_t *slot = route_hash_find(route);
+    if (*slot != 0) {
+        routes_frequency[*slot - 1]++;
+        return true;
     }
     routes[routes_count] = route;
     routes_frequency[routes_count] = 1;
     routes_count++;
+    *slot = routes_count;
     if (routes_count >= MAX_NUM_ROUTES) {
         log_error("Best compression was %d compared to max legal of %d",
                 routes_count, MAX_NUM_ROUTES);
-        // set the failed flag and exit
-        malloc_extras_terminate(EXITED_CLEANLY);
+        return false;
     }
+    return true;
 }
 
 
@@ -292,9 +327,18 @@ bool minimise_run(int target_length, bool *failed_by_malloc,
     int table_size = routing_table_get_n_entries();
 
     routes_count = 0;
+    route_hash_rebuild();
 
     for (int index = 0; index < table_size; index++) {
-        update_frequency(index);
+        if (!update_frequency(index)) {
+#ifdef USE_ADAPTIVE
+            // The table is untouched, so ordered covering can have a go
+            return false;
+#else
+            // set the failed flag and exit
+            malloc_extras_terminate(EXITED_CLEANLY);
+#endif
+        }
     }
 
     log_debug("before sort %u", routes_count);
@@ -303,6 +347,7 @@ bool minimise_run(int target_length, bool *failed_by_malloc,
     }
 
     quicksort_route(0, routes_count);
+    route_hash_rebuild();
     if (*stop_compressing) {
         log_info("Stopping as asked to stop");
         return false;
@@ -320,6 +365,11 @@ bool minimise_run(int target_length, bool *failed_by_malloc,
         return false;
     }
 
+    // The entries after the route group being compressed do not move until
+    // their own group is reached, so they can be indexed once up front
+    remaining_entries_indexed =
+            key_mask_index_init(&remaining_entries, 0, table_size);
+
     write_index = 0;
     int max_index = table_size - 1;
     int left = 0;
@@ -334,20 +384,34 @@ bool minimise_run(int target_length, bool *failed_by_malloc,
             right++;
         }
         remaining_index = right + 1;
+        if (remaining_entries_indexed) {
+            key_mask_index_retire_before(&remaining_entries, remaining_index);
+        }
         log_debug("compress %u %u", left, right);
         compress_by_route(left, right);
         if (write_index > rtr_alloc_max()){
             log_error("Compression not possible as already found %d entries "
             "where max allowed is %d", write_index, rtr_alloc_max());
+            key_mask_index_delete(&remaining_entries);
+            minimise_best_length = -1;
             return false;
         }
+        left = right + 1;
+
+        // The table would be the compressed routes then the rest as they are
+        minimise_best_length = write_index + table_size - left;
         if (*stop_compressing) {
             log_info("Stopping during compression as asked to stop");
+            key_mask_index_delete(&remaining_entries);
+            for (; left < table_size; left++) {
+                routing_table_copy_entry(write_index++, left);
+            }
+            routing_table_remove_from_size(table_size - write_index);
             return false;
         }
-        left = right + 1;
     }
 
+    key_mask_index_delete(&remaining_entries);
     log_debug("done %u %u", table_size, write_index);
 
     routing_table_remove_from_size(table_size-write_index);
@@ -43,25 +43,34 @@ static inline bool _opposite_links(entry_t *entry) {
     return ((dst >> 3) == (src & 0x7) && (src >> 3) == (dst & 0x7));
 }
 
+//! \brief Whether the router would send an entry's packets the same way by
+//!     default routing
+//! \param[in] entry: The entry to check
+//! \return Whether the entry can be left out of the table
+static inline bool _is_defaultable(entry_t *entry) {
+    return _just_a_link(entry->route) &&      // Only one output, a link
+            _just_a_link(entry->source) &&    // Only one input, a link
+            _opposite_links(entry);           // Source is opposite to sink
+}
+
 //! \brief Remove defaultable routes from a routing table if that helps.
-//! \param[in,out] table: The table to remove the routes from.
+//! \details The entries that stay keep their order, so the table still
+//!     routes every key the same way.
+//! \param[in] target_length: The length the table must reach
+//! \return Whether the table now fits in the target length, so needs no
+//!     compressing; if not, the table is left as it is
 static inline bool remove_default_routes_minimise(int target_length) {
-    if (routing_table_get_n_entries() <= target_length) {
+    int n_entries = routing_table_get_n_entries();
+    if (n_entries <= target_length) {
         log_info("No Minimise needed as size %u, is below target of %u",
-        routing_table_get_n_entries(),  target_length);
+                n_entries, target_length);
         return true;
     }
+
     // Work out if removing defaultable links is worthwhile
     int after_size = 0;
-    for (int i = 0; i < routing_table_get_n_entries(); i++) {
-        // Get the current entry
-        entry_t* entry = routing_table_get_entry(i);
-
-        // See if it can be removed
-        if (_just_a_link(entry->route) &&      // Only one output, a link
-                _just_a_link(entry->source) && // Only one input, a link
-                _opposite_links(entry)) {    // Source is opposite to sink
-        } else {
+    for (int i = 0; i < n_entries; i++) {
+        if (!_is_defaultable(routing_table_get_entry(i))) {
             after_size++;
             // If we won't fit afterwards, no sense trying
             if (after_size > target_length) {
@@ -70,27 +79,20 @@ static inline bool remove_default_routes_minimise(int target_length) {
         }
     }
 
-    uint32_t removed = 0;
-    int last = routing_table_get_n_entries();
-    // Do the actual removal
-    for (int i = 0; i < after_size; i++) {
-        // Get the current entry
-        entry_t* entry = routing_table_get_entry(i);
-
-        // See if it can be removed
-        if (_just_a_link(entry->route) &&      // Only one output, a link
-                _just_a_link(entry->source) && // Only one input, a link
-                _opposite_links(entry)) {    // Source is opposite to sink
-            if (i < last) {
-                routing_table_copy_entry(i, last);
-                removed++;
-                last--;
-                // Reuse same i in next pass so reduce before the ++
-                i--;
+    // Entries between write and read have all been removed, so swapping
+    // keeps the others in order
+    int write = 0;
+    for (int read = 0; read < n_entries; read++) {
+        if (!_is_defaultable(routing_table_get_entry(read))) {
+            if (write != read) {
+                swap_entries(write, read);
             }
+            write++;
         }
     }
-    routing_table_remove_from_size(removed);
+    routing_table_remove_from_size(n_entries - write);
+    log_info("Left %d of %d entries to default routing",
+            n_entries - write, n_entries);
     return true;
 }
 
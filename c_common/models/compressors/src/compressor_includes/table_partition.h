@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Splitting of a routing table so that several cores can each
+//!     minimise a part of it.
+//! \details The key space is cut into aligned blocks ("cubes") that no
+//!     entry crosses. Anything made by merging entries of one cube stays
+//!     inside that cube, so it can never intersect an entry of another
+//!     cube; each cube can therefore be minimised on its own and the
+//!     results put together in any order.
+//!
+//!     Every core sharing a table builds the same cubes from the same
+//!     table, so no cube has to be passed between them; each just keeps
+//!     the entries of its own cube.
+#ifndef __TABLE_PARTITION_H__
+#define __TABLE_PARTITION_H__
+
+#include <debug.h>
+#include "../common/routing_table.h"
+
+//! The most partitions a table can be split into
+#define TABLE_PARTITION_MAX 32
+
+//! \brief An aligned block of the key space
+typedef struct table_partition_cube_t {
+    //! The fixed top bits of the cube; the mask is all the fixed bits
+    key_mask_t key_mask;
+
+    //! The number of table entries inside the cube
+    int n_entries;
+
+    //! Whether the cube might still be split in two
+    bool splittable;
+} table_partition_cube_t;
+
+//! \brief Get the number of entries in the table being split
+//! \param[in] table: The table, or `NULL` for the one behind routing_table.h
+//! \return The number of entries
+static inline int _table_partition_n_entries(const table_t *table) {
+    if (table != NULL) {
+        return table->size;
+    }
+    return routing_table_get_n_entries();
+}
+
+//! \brief Get the key_mask of an entry of the table being split
+//! \param[in] table: The table, or `NULL` for the one behind routing_table.h
+//! \param[in] i: The index of the entry
+//! \return The key_mask of the entry
+static inline key_mask_t _table_partition_key_mask(
+        const table_t *table, int i) {
+    if (table != NULL) {
+        return table->entries[i].key_mask;
+    }
+    return routing_table_get_entry(i)->key_mask;
+}
+
+//! \brief Determine if a table entry lies wholly inside a cube
+//! \param[in] cube: The cube to check against
+//! \param[in] km: The key_mask of the entry
+//! \return Whether every key the entry matches is in the cube
+static inline bool _table_partition_inside(
+        key_mask_t cube, key_mask_t km) {
+    return ((km.mask & cube.mask) == cube.mask) &&
+            ((km.key & cube.mask) == cube.key);
+}
+
+//! \brief Try to split a cube on the highest bit it does not fix
+//! \param[in] table: The table, or `NULL` for the one behind routing_table.h
+//! \param[in,out] cube: The cube to split; becomes the half with the bit
+//!     clear, or the only half with entries in it
+//! \param[out] upper: The half with the bit set, if both halves have entries
+//! \return Whether both halves have entries and upper was filled in
+static bool _table_partition_split(const table_t *table,
+        table_partition_cube_t *cube, table_partition_cube_t *upper) {
+    uint32_t fixed = cube->key_mask.mask;
+    if (fixed == 0xFFFFFFFF) {
+        cube->splittable = false;
+        return false;
+    }
+    uint32_t bit = 0x80000000 >> __builtin_popcount(fixed);
+
+    int n_upper = 0;
+    int n_entries = _table_partition_n_entries(table);
+    for (int i = 0; i < n_entries; i++) {
+        key_mask_t km = _table_partition_key_mask(table, i);
+        if (!_table_partition_inside(cube->key_mask, km)) {
+            continue;
+        }
+        if (!(km.mask & bit)) {
+            // This entry spans both halves, so they must stay together
+            cube->splittable = false;
+            return false;
+        }
+        if (km.key & bit) {
+            n_upper++;
+        }
+    }
+
+    key_mask_t lower_km = {cube->key_mask.key, fixed | bit};
+    key_mask_t upper_km = {cube->key_mask.key | bit, fixed | bit};
+    if (n_upper == 0) {
+        cube->key_mask = lower_km;
+        return false;
+    }
+    if (n_upper == cube->n_entries) {
+        cube->key_mask = upper_km;
+        return false;
+    }
+    upper->key_mask = upper_km;
+    upper->n_entries = n_upper;
+    upper->splittable = true;
+    cube->key_mask = lower_km;
+    cube->n_entries -= n_upper;
+    return true;
+}
+
+//! \brief Cut the key space of the table into at most n_partitions cubes
+//! \details The biggest cube is split in two until there are enough cubes
+//!     or no cube can be split any more. The result depends only on the
+//!     table, so every core sharing the table gets the same cubes.
+//! \param[in] table: The table to split, or `NULL` for the one behind
+//!     routing_table.h
+//! \param[out] cubes: Where to put the cubes; must hold n_partitions
+//! \param[in] n_partitions: The most cubes wanted
+//! \return The number of cubes made
+static int table_partition_cubes(const table_t *table,
+        table_partition_cube_t *cubes, int n_partitions) {
+    cubes[0].key_mask.key = 0;
+    cubes[0].key_mask.mask = 0;
+    cubes[0].n_entries = _table_partition_n_entries(table);
+    cubes[0].splittable = true;
+    int n_cubes = 1;
+
+    while (n_cubes < n_partitions) {
+        int biggest = -1;
+        for (int c = 0; c < n_cubes; c++) {
+            if (cubes[c].splittable && cubes[c].n_entries > 1 &&
+                    (biggest < 0 ||
+                    cubes[c].n_entries > cubes[biggest].n_entries)) {
+                biggest = c;
+            }
+        }
+        if (biggest < 0) {
+            break;
+        }
+        if (_table_partition_split(
+                table, &cubes[biggest], &cubes[n_cubes])) {
+            n_cubes++;
+        }
+    }
+    return n_cubes;
+}
+
+//! \brief Reduce the table to the entries of one of its partitions
+//! \details Entries keep their order, so a table in order of generality
+//!     stays that way. A partition with no cube keeps nothing.
+//! \param[in] partition: Which partition to keep
+//! \param[in] n_partitions: How many partitions the table is split into
+static void table_partition_keep(int partition, int n_partitions) {
+    if (n_partitions > TABLE_PARTITION_MAX) {
+        n_partitions = TABLE_PARTITION_MAX;
+    }
+    if (n_partitions <= 1) {
+        return;
+    }
+
+    table_partition_cube_t cubes[TABLE_PARTITION_MAX];
+    int n_cubes = table_partition_cubes(NULL, cubes, n_partitions);
+    int n_entries = routing_table_get_n_entries();
+    if (partition >= n_cubes) {
+        log_info("Partition %d of %d has no entries as the table only "
+                "splits into %d", partition, n_partitions, n_cubes);
+        routing_table_remove_from_size(n_entries);
+        return;
+    }
+
+    key_mask_t cube = cubes[partition].key_mask;
+    int write = 0;
+    for (int read = 0; read < n_entries; read++) {
+        if (_table_partition_inside(
+                cube, routing_table_get_entry(read)->key_mask)) {
+            if (write != read) {
+                routing_table_copy_entry(write, read);
+            }
+            write++;
+        }
+    }
+    routing_table_remove_from_size(n_entries - write);
+    log_info("Partition %d of %d keeps %d of %d entries in key 0x%08x "
+            "mask 0x%08x", partition, n_cubes, write, n_entries,
+            cube.key, cube.mask);
+}
+
+#endif  // __TABLE_PARTITION_H__
@@ -17,14 +17,15 @@
 
 //! \file
 //! \brief Aliases in the routing tree.
-//! \details Aliases are built using a trie structure as this avoids the need
-//! for rebalancing at the cost of more memory.
+//! \details The aliases of each merged entry are kept in a hash table keyed
+//! on its key_mask, so lookups need no recursion or pointer chasing.
 #ifndef __ALIASES_H__
 #define __ALIASES_H__
 
 #include <malloc_extras.h>
 #include "../common/routing_table.h"
 #include <debug.h>
+#include "pool.h"
 
 /*****************************************************************************/
 /* Vector-like object ********************************************************/
@@ -50,7 +51,11 @@ typedef struct _alias_list_t {
     alias_element_t data;
 } alias_list_t;
 
-//! \brief Create a new list on the stack
+//! \brief Where alias lists are allocated; they are only freed all together
+//!     by aliases_clear()
+static arena_t alias_list_arena;
+
+//! \brief Create a new list
 //! \param[in] max_size: max size of memory to allocate to new list
 //! \return new alias list. or NULL if not allocated
 static alias_list_t* alias_list_new(unsigned int max_size) {
@@ -59,7 +64,7 @@ static alias_list_t* alias_list_new(unsigned int max_size) {
             sizeof(alias_list_t) + (max_size - 1) * sizeof(alias_element_t);
 
     // Allocate and then fill in values
-    alias_list_t *as = MALLOC(size);
+    alias_list_t *as = arena_alloc(&alias_list_arena, size);
     if (as == NULL){
         return NULL;
     }
@@ -108,83 +113,82 @@ static void alias_list_join(alias_list_t *a, alias_list_t *b) {
     a->next = b;
 }
 
-//! \brief Delete all elements in an alias list
-//! \param[in] a: alias list to delete.
-void alias_list_delete(alias_list_t *a) {
-    if (a->next != NULL) {
-        alias_list_delete(a->next);
-        a->next = NULL;
-    }
-    FREE(a);
-}
-
 /*****************************************************************************/
 
 
 /*****************************************************************************/
 /* Map-like object ***********************************************************/
-// Implemented as an AA tree
+// Implemented as an open-addressed hash table
 
-//! \brief the key union from a key and mask to a 64 bit number
-typedef union a_key_t {
-    //! key mast combo
-    key_mask_t km;
+//! \brief A slot of the map
+typedef struct alias_slot_t {
+    //! The key_mask of the merged entry, or ::ALIASES_EMPTY_KEY if unused
+    key_mask_t key;
 
-    //! the 64 bit int version
-    int64_t as_int;
-} a_key_t;
-
-//! \brief node struct
-typedef struct node_t {
-    //! Key and value of this node
-    a_key_t key;
-
-    //! alias ......
+    //! The aliases of the entry, or `NULL` if it has been removed
     alias_list_t *val;
+} alias_slot_t;
 
-    //! tree level maybe?
-    unsigned int level;
-
-    //! left child
-    struct node_t *left;
+//! \brief Map of the key_masks of merged entries to the entries they alias
+typedef struct aliases_t {
+    //! The slots of the map; a power of two of them, or `NULL` when empty
+    alias_slot_t *slots;
 
-    //! right child
-    struct node_t *right;
-} node_t;
+    //! The number of slots less one
+    unsigned int slot_mask;
 
-//! \brief top of tree
-typedef struct aliases_t {
-    //! pointer to first element
-    node_t *root;
+    //! The number of slots which have ever been used, removed or not
+    unsigned int n_used;
 } aliases_t;
 
+//! \brief The key of an unused slot; matches nothing, so it is never the key
+//!     of a merged entry
+static const key_mask_t ALIASES_EMPTY_KEY = {0xFFFFFFFF, 0x00000000};
+
+//! The number of slots in the map when it is first used
+#define ALIASES_INITIAL_SLOTS 64
+
+//! \brief Set up the memory for the aliases of a table, to be given back by
+//!     aliases_clear()
+//! \details There is at most one alias list per merge and one alias per
+//!     entry of the table, so the slabs are sized from the table.
+//! \param[in] n_entries: The number of entries in the table
+static inline void aliases_memory_init(unsigned int n_entries) {
+    unsigned int per_slab = (n_entries / 16 > 16) ? n_entries / 16 : 16;
+    arena_init(&alias_list_arena,
+            sizeof(alias_list_t) + 4 * per_slab * sizeof(alias_element_t));
+}
+
 //! \brief Create a new, empty, aliases container
+//! \details No memory is taken until the first insertion
 //! \return new alias list
 static aliases_t aliases_init(void) {
-    aliases_t aliases = {NULL};
+    aliases_t aliases = {NULL, 0, 0};
     return aliases;
 }
 
-//! \brief Retrieve a node from an aliases container
-//! \param[in] node: the subtree root
-//! \param[in] key: the key being sought
-//! \return the node with that key, or `NULL` if no such node
-static inline node_t *_aliases_find_node(node_t *node, a_key_t key) {
-    while (node != NULL) {
-        if (key.as_int == node->key.as_int) {
-            // This is the requested item, return it
-            return node;
-        }
+//! \brief Determine if two key_masks are the same
+//! \param[in] a: The first key_mask
+//! \param[in] b: The second key_mask
+//! \return Whether they are the same
+static inline bool _aliases_same_key(key_mask_t a, key_mask_t b) {
+    return a.key == b.key && a.mask == b.mask;
+}
 
-        if (key.as_int < node->key.as_int) {
-            // Go left
-            node = node->left;
-        } else {
-            // Go right
-            node = node->right;
-        }
+//! \brief Find the slot for a key
+//! \param[in] slots: The slots to search
+//! \param[in] slot_mask: The number of slots less one
+//! \param[in] key: The key being sought
+//! \return The slot with that key, or the unused slot where it would go
+static inline alias_slot_t *_aliases_find_slot(
+        alias_slot_t *slots, unsigned int slot_mask, key_mask_t key) {
+    uint32_t hash = (key.key * 2654435761u) ^ (key.mask * 2246822519u);
+    unsigned int i = (hash ^ (hash >> 16)) & slot_mask;
+    while (!_aliases_same_key(slots[i].key, key) &&
+            !_aliases_same_key(slots[i].key, ALIASES_EMPTY_KEY)) {
+        i = (i + 1) & slot_mask;
     }
-    return NULL;  // We didn't find the requested item
+    return &slots[i];
 }
 
 //! \brief Retrieve an element from an aliases container
@@ -192,12 +196,10 @@ static inline node_t *_aliases_find_node(node_t *node, a_key_t key) {
 //! \param[in] key: The key sought
 //! \return The alias list for that key, or `NULL` if mapping absent
 static inline alias_list_t *aliases_find(aliases_t *a, key_mask_t key) {
-    // Search the tree
-    node_t *node = _aliases_find_node(a->root, (a_key_t) key);
-    if (node == NULL) {
+    if (a->slots == NULL) {
         return NULL;
     }
-    return node->val;
+    return _aliases_find_slot(a->slots, a->slot_mask, key)->val;
 }
 
 //! \brief See if the aliases contain holds an element
@@ -208,147 +210,87 @@ static inline bool aliases_contains(aliases_t *a, key_mask_t key) {
     return aliases_find(a, key) != NULL;
 }
 
-//! \brief Fix node skew; part of rebalancing
-//! \param[in] n: Node that is root of this sub-tree
-//! \return Node that is new root of this sub-tree
-static inline node_t *_aliases_skew(node_t *n) {
-    if (n == NULL) {
-        return NULL;
-    }
-    if (n->left == NULL || n->level != n->left->level) {
-        return n;
-    }
-
-    node_t *node_pointer = n->left;
-    n->left = node_pointer->right;
-    node_pointer->right = n;
-    return node_pointer;
-}
-
-//! \brief Split nodes; part of rebalancing
-//! \param[in] n: Node that is root of this sub-tree
-//! \return Node that is new root of this sub-tree
-static inline node_t *_aliases_split(node_t *n) {
-    if (n == NULL) {
-        return NULL;
-    }
-    if (n->right == NULL || n->right->right == NULL
-            || n->level != n->right->right->level) {
-        return n;
+//! \brief Move the map to a new array of slots, dropping removed elements
+//! \param[in] a: The key-to-alias map
+//! \param[in] n_slots: The number of slots to have; a power of two
+//! \return whether there was memory for the new slots
+static bool _aliases_resize(aliases_t *a, unsigned int n_slots) {
+    alias_slot_t *slots = MALLOC(n_slots * sizeof(alias_slot_t));
+    if (slots == NULL) {
+        log_error("failed to allocate %d alias slots", n_slots);
+        return false;
     }
-
-    node_t *r = n->right;
-    n->right = r->left;
-    r->left = n;
-    r->level++;
-    return r;
-}
-
-//! \brief Core of how to insert aliases
-//! \param[in] n: Sub-tree to do insert within
-//! \param[in] key: Node key to insert
-//! \param[in] val: Node value to insert
-//! \return whether the insert was successful or not (fails on no memory)
-static bool _aliases_insert( // DO NOT INLINE; RECURSIVE!
-        node_t *n, a_key_t key, alias_list_t *val) {
-    if (n == NULL) {
-        // If the node is NULL then create a new Node
-        // Malloc room for the node
-        n = MALLOC(sizeof(node_t));
-        if (n == NULL) {
-            log_error("failed to allocate memory for node");
-            return false;
-        }
-
-        // Assign the values
-        n->key = key;
-        n->val = val;
-        n->left = n->right = NULL;
-        n->level = 1;
-
-        return true;
+    for (unsigned int i = 0; i < n_slots; i++) {
+        slots[i].key = ALIASES_EMPTY_KEY;
+        slots[i].val = NULL;
     }
 
-    if (key.as_int < n->key.as_int) {
-        // Go left
-        bool success = _aliases_insert(n->left, key, val);
-        if (!success) {
-            return false;
+    unsigned int n_used = 0;
+    if (a->slots != NULL) {
+        for (unsigned int i = 0; i <= a->slot_mask; i++) {
+            if (a->slots[i].val != NULL) {
+                *_aliases_find_slot(slots, n_slots - 1, a->slots[i].key) =
+                        a->slots[i];
+                n_used++;
+            }
         }
-    } else if (key.as_int > n->key.as_int) {
-        // Go right
-        bool success = _aliases_insert(n->right, key, val);
-        if (!success) {
-            return false;
-        }
-    } else {
-        // Replace the value
-        n->val = val;
+        FREE(a->slots);
     }
-
-    // Rebalance the tree
-    n = _aliases_skew(n);
-    n = _aliases_split(n);
-
+    a->slots = slots;
+    a->slot_mask = n_slots - 1;
+    a->n_used = n_used;
     return true;
 }
 
-
-//! \brief Add/overwrite an element into an aliases tree
+//! \brief Add/overwrite an element into an aliases container
 //! \param[in] a: The key-to-alias map
 //! \param[in] key: key mask to insert or overwrite
 //! \param[in] value: the value to write in
-//! \return whether the insert was successful or not
+//! \return whether the insert was successful or not (fails on no memory)
 static inline bool aliases_insert(
         aliases_t *a, key_mask_t key, alias_list_t *value) {
-    // Insert into, and balance, the tree
+    // Keep at least half the slots unused so that searches stay short
+    if (a->slots == NULL) {
+        if (!_aliases_resize(a, ALIASES_INITIAL_SLOTS)) {
+            return false;
+        }
+    } else if (2 * (a->n_used + 1) > a->slot_mask + 1) {
+        if (!_aliases_resize(a, 2 * (a->slot_mask + 1))) {
+            return false;
+        }
+    }
 
-   return _aliases_insert(a->root, (a_key_t) key, value);
+    alias_slot_t *slot = _aliases_find_slot(a->slots, a->slot_mask, key);
+    if (_aliases_same_key(slot->key, ALIASES_EMPTY_KEY)) {
+        slot->key = key;
+        a->n_used++;
+    }
+    slot->val = value;
+    return true;
 }
 
-
-//! \brief Remove an element from an aliases tree
+//! \brief Remove an element from an aliases container
+//! \details The slot keeps its key so that searches for other keys continue
+//!     past it; it is reused if the key is inserted again.
 //! \param[in] a: aliases
 //! \param[in] key: the key mask struct
 static inline void aliases_remove(aliases_t *a, key_mask_t key) {
-    // XXX This is a hack which removes the reference to the element in the
-    // tree but doesn't remove the Node from the tree.
-    node_t *n = _aliases_find_node(a->root, (a_key_t) key);
-    if (n != NULL) {
-        n->val = NULL;
-    }
-}
-
-//! \brief clears a node from the alias tree
-//! \param[in] n: the note to clear from the alias tree
-static void _aliases_clear(node_t *n) { // DO NOT INLINE; RECURSIVE!
-    if (n == NULL) {
-        return;
-    }
-
-    // Remove any children
-    if (n->left != NULL) {
-        _aliases_clear(n->left);
-    }
-    if (n->right != NULL) {
-        _aliases_clear(n->right);
-    }
-
-    // Clear the value
-    if (n->val != NULL) {
-        alias_list_delete(n->val);
+    if (a->slots != NULL) {
+        _aliases_find_slot(a->slots, a->slot_mask, key)->val = NULL;
     }
-
-    // Remove self
-    FREE(n);
 }
 
-
 //! \brief Remove all elements from an aliases container and free all
 //!     sub-containers
-//! \param[in] a: the aliases tree.
+//! \details The lists all come from the same slabs, so they are freed with
+//!     the slots without visiting each element.
+//! \param[in] a: the aliases container.
 static inline void aliases_clear(aliases_t *a) {
-    _aliases_clear(a->root);
+    if (a->slots != NULL) {
+        FREE(a->slots);
+    }
+    *a = aliases_init();
+    arena_delete(&alias_list_arena);
 }
 
 /*****************************************************************************/
@@ -29,6 +29,7 @@
 #include <malloc_extras.h>
 #include "../common/constants.h"
 #include <debug.h>
+#include "pool.h"
 
 //! \brief wrapper over bitfield
 typedef struct _bit_set_t {
@@ -43,8 +44,52 @@ typedef struct _bit_set_t {
 
     //! Pointer to data
     uint32_t *_data;
+
+    //! Whether _data came from the pool rather than MALLOC
+    bool pooled;
 } bit_set_t;
 
+//! \brief The most bit sets alive at once in the ordered covering; two merges
+//!     and the two sets of the down check
+#define BIT_SET_POOL_BLOCKS 4
+
+//! \brief Pool of storage for bit sets; bit sets that fit in its blocks come
+//!     from here rather than MALLOC
+static pool_t bit_set_pool;
+
+//! \brief Get the number of words needed for a bit set
+//! \param[in] length: the number of bits in the set
+//! \return the number of words
+static inline unsigned int _bit_set_n_words(unsigned int length) {
+    unsigned int n_words = length / BITS_IN_A_WORD;
+    if (length % BITS_IN_A_WORD) {
+        n_words++;
+    }
+    return n_words;
+}
+
+//! \brief Whether the storage of a bit set comes from the pool
+//! \param[in] n_words: the number of words in the bit set
+//! \return true if the pool's blocks are big enough for the bit set
+static inline bool _bit_set_pooled(unsigned int n_words) {
+    return n_words * sizeof(uint32_t) <= bit_set_pool.block_size;
+}
+
+//! \brief Set up the pool of bit set storage
+//! \param[in] max_length: the most bits that will be in a bit set
+//! \return whether there was memory for the pool
+static inline bool bit_set_pool_init(unsigned int max_length) {
+    return pool_init(&bit_set_pool,
+            _bit_set_n_words(max_length) * sizeof(uint32_t),
+            BIT_SET_POOL_BLOCKS);
+}
+
+//! \brief Free the pool of bit set storage; bit sets from it become invalid
+static inline void bit_set_pool_delete(void) {
+    pool_delete(&bit_set_pool);
+    bit_set_pool.block_size = 0;
+}
+
 //! \brief Empty a bitset entirely
 //! \param[in] b: the bit set to clear bits
 //! \return bool saying successfully cleared bit field
@@ -64,13 +109,15 @@ bool bit_set_clear(bit_set_t *b) {
 //! \param[in] length: the length of bits to make
 //! \return whether the bitset was created
 static inline bool bit_set_init(bit_set_t *b, unsigned int length) {
-    // Malloc space for the data
-    unsigned int n_words = length / BITS_IN_A_WORD;
-    if (length % BITS_IN_A_WORD) {
-        n_words++;
+    // Get space for the data
+    unsigned int n_words = _bit_set_n_words(length);
+    uint32_t *data;
+    b->pooled = _bit_set_pooled(n_words);
+    if (b->pooled) {
+        data = pool_alloc(&bit_set_pool);
+    } else {
+        data = MALLOC(n_words * sizeof(uint32_t));
     }
-
-    uint32_t *data = (uint32_t *) MALLOC(n_words * sizeof(uint32_t));
     if (data == NULL) {
         b->_data = NULL;
         b->n_elements = 0;
@@ -88,8 +135,15 @@ static inline bool bit_set_init(bit_set_t *b, unsigned int length) {
 //! \brief Destroy a bitset
 //! \param[in] b: the bitset to delete
 static inline void bit_set_delete(bit_set_t *b) {
-    // Free the storage
-    FREE(b->_data);
+    // Free the storage to wherever it came from, as the pool may have been
+    // set up again with a different block size since
+    if (b->_data != NULL) {
+        if (b->pooled) {
+            pool_free(&bit_set_pool, b->_data);
+        } else {
+            FREE(b->_data);
+        }
+    }
     b->_data = NULL;
     b->n_elements = 0;
 }
@@ -135,8 +135,10 @@ static inline void merge_remove(merge_t *m, unsigned int i) {
         m->source = INIT_SOURCE;
         m->key_mask.key  = FULL;
         m->key_mask.mask = EMPTY;
+        routing_table_cursor_t cursor;
+        routing_table_cursor_init(&cursor, 0, routing_table_get_n_entries());
         for (int j = 0; j < routing_table_get_n_entries(); j++) {
-            entry_t *e = routing_table_get_entry(j);
+            entry_t *e = routing_table_cursor_next(&cursor);
 
             if (bit_set_contains(&m->entries, j)) {
                 m->route |= e->route;
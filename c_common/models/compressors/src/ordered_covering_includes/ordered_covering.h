@@ -26,6 +26,8 @@
 #include "bit_set.h"
 #include "merge.h"
 #include "../common/routing_table.h"
+#include "../common/key_mask_scan.h"
+#include "../common/minimise.h"
 
 //! \brief State of the ordered covering
 typedef struct _sets_t {
@@ -123,20 +125,17 @@ static inline bool oc_up_check(
 
         // Otherwise look through the table from the insertion point to the
         // current entry position to ensure that nothing covers the merge.
-        for (unsigned int j = i + 1; j < insertion_index; j++) {
-            key_mask_t other_km = routing_table_get_entry(j)->key_mask;
-
-            // If the key masks intersect then remove this entry from the merge
-            // and recalculate the insertion index.
-            if (key_mask_intersect(km, other_km)) {
-                // Indicate the the merge has changed
-                *changed = true;
-
-                // Remove from the merge
-                merge_remove(merge, i);
-                generality = key_mask_count_xs(merge->key_mask);
-                insertion_index = oc_get_insertion_point(generality);
-            }
+        // If the key masks intersect then remove this entry from the merge
+        // and recalculate the insertion index.
+        if (key_mask_scan_table(km, i + 1, insertion_index) <
+                insertion_index) {
+            // Indicate the the merge has changed
+            *changed = true;
+
+            // Remove from the merge
+            merge_remove(merge, i);
+            generality = key_mask_count_xs(merge->key_mask);
+            insertion_index = oc_get_insertion_point(generality);
         }
     }
 
@@ -281,9 +280,11 @@ static bool oc_down_check(
         int insertion_point =
                 oc_get_insertion_point(key_mask_count_xs(merge->key_mask));
 
-        for (int i = insertion_point;
-                i < routing_table_get_n_entries() && stringency > 0;
-                i++) {
+        int n_entries = routing_table_get_n_entries();
+        for (int i = key_mask_scan_table(
+                    merge->key_mask, insertion_point, n_entries);
+                i < n_entries && stringency > 0;
+                i = key_mask_scan_table(merge->key_mask, i + 1, n_entries)) {
             // safety check for timing limits
             if (*stop_compressing) {
                 log_error("failed due to timing");
@@ -291,46 +292,44 @@ static bool oc_down_check(
             }
 
             key_mask_t km = routing_table_get_entry(i)->key_mask;
-            if (key_mask_intersect(km, merge->key_mask)) {
-                if (!aliases_contains(aliases, km)) {
-                    // The entry doesn't contain any aliases so we need to
-                    // avoid hitting the key that has just been identified.
-                    covered_entries = true;
-                    _get_settable(
-                            merge->key_mask, km, &stringency, &set_to_zero,
-                            &set_to_one);
-                } else {
-                    // We need to avoid any key_masks contained within the
-                    // alias table.
-                    alias_list_t *the_alias_list = aliases_find(aliases, km);
-                    while (the_alias_list != NULL) {
+            if (!aliases_contains(aliases, km)) {
+                // The entry doesn't contain any aliases so we need to
+                // avoid hitting the key that has just been identified.
+                covered_entries = true;
+                _get_settable(
+                        merge->key_mask, km, &stringency, &set_to_zero,
+                        &set_to_one);
+            } else {
+                // We need to avoid any key_masks contained within the
+                // alias table.
+                alias_list_t *the_alias_list = aliases_find(aliases, km);
+                while (the_alias_list != NULL) {
+                    // safety check for timing limits
+                    if (*stop_compressing) {
+                        log_error("failed due to timing");
+                        return false;
+                    }
+                    for (unsigned int j = 0; j < the_alias_list->n_elements;
+                            j++) {
+
                         // safety check for timing limits
                         if (*stop_compressing) {
                             log_error("failed due to timing");
                             return false;
                         }
-                        for (unsigned int j = 0; j < the_alias_list->n_elements;
-                                j++) {
-
-                            // safety check for timing limits
-                            if (*stop_compressing) {
-                                log_error("failed due to timing");
-                                return false;
-                            }
-
-                            km = alias_list_get(the_alias_list, j).key_mask;
-
-                            if (key_mask_intersect(km, merge->key_mask)) {
-                                covered_entries = true;
-                                _get_settable(
-                                        merge->key_mask, km, &stringency,
-                                        &set_to_zero, &set_to_one);
-                            }
-                        }
 
-                        // Progress through the alias list
-                        the_alias_list = the_alias_list->next;
+                        km = alias_list_get(the_alias_list, j).key_mask;
+
+                        if (key_mask_intersect(km, merge->key_mask)) {
+                            covered_entries = true;
+                            _get_settable(
+                                    merge->key_mask, km, &stringency,
+                                    &set_to_zero, &set_to_one);
+                        }
                     }
+
+                    // Progress through the alias list
+                    the_alias_list = the_alias_list->next;
                 }
             }
         }
@@ -349,50 +348,21 @@ static bool oc_down_check(
 
         // Determine which entries could be removed from the merge and then
         // pick the smallest number of entries to remove.
-        __sets_t sets;
-
-        // allocate and free accordingly
-        sets.best = MALLOC(sizeof(bit_set_t));
-        if (sets.best == NULL) {
-            log_error("failed to alloc sets.best");
-            *failed_by_malloc = true;
-            return false;
-        }
-
-        sets.working = MALLOC(sizeof(bit_set_t));
-        if (sets.working == NULL) {
-            log_error("failed to alloc sets.working");
-            *failed_by_malloc = true;
+        bit_set_t best, working;
+        __sets_t sets = {.best = &best, .working = &working};
 
-            // free stuff already malloc
-            bit_set_delete(sets.best);
-            FREE(sets.best);
-            return false;
-        }
-
-        bool success = bit_set_init(sets.best, merge->entries.count);
-        if (!success) {
+        if (!bit_set_init(sets.best, merge->entries.count)) {
             log_error("failed to init the bitfield best");
             *failed_by_malloc = true;
-
-            // free stuff already malloc
-            bit_set_delete(sets.best);
-            bit_set_delete(sets.working);
-            FREE(sets.best);
-            FREE(sets.working);
             return false;
         }
 
-        success = bit_set_init(sets.working, merge->entries.count);
-        if (!success) {
+        if (!bit_set_init(sets.working, merge->entries.count)) {
             log_error("failed to init the bitfield working.");
             *failed_by_malloc = true;
 
             // free stuff already malloc
             bit_set_delete(sets.best);
-            bit_set_delete(sets.working);
-            FREE(sets.best);
-            FREE(sets.working);
             return false;
         }
 
@@ -409,8 +379,6 @@ static bool oc_down_check(
                 log_error("failed due to timing");
                 bit_set_delete(sets.best);
                 bit_set_delete(sets.working);
-                FREE(sets.best);
-                FREE(sets.working);
                 return false;
             }
 
@@ -425,11 +393,7 @@ static bool oc_down_check(
 
         // Tidy up
         bit_set_delete(sets.best);
-        FREE(sets.best);
-        sets.best=NULL;
         bit_set_delete(sets.working);
-        FREE(sets.working);
-        sets.working=NULL;
 
         // If the merge only contains 1 entry empty it entirely
         if (merge->entries.count == 1) {
@@ -442,181 +406,534 @@ static bool oc_down_check(
 }
 
 
-//! \brief Get the best merge which can be applied to a routing table
-//! \param[in] aliases: Describes what entries alias what other entries
-//! \param[in,out] best: The best merge found
-//! \param[out] failed_by_malloc: Flag saying failed by memory exhaustion
-//! \param[in] stop_compressing: Variable saying if compression should stop;
-//!     _set by interrupt_
-//! \return Whether successful or not.
-static inline bool oc_get_best_merge(
-        aliases_t *aliases, merge_t *best, bool *failed_by_malloc,
-        volatile bool *stop_compressing) {
-    // Keep track of which entries have been considered as part of merges.
-    bit_set_t considered;
-    bool success = bit_set_init(
-            &considered, routing_table_get_n_entries());
-    if (!success) {
-        log_info("failed to initialise the bit_set. throwing response malloc");
-        *failed_by_malloc = true;
-        return false;
-    }
+//! \brief The candidate merge of all the entries that share a route
+//! \details The goodness of a candidate only depends on the entries that
+//!     intersect its key_mask, so it is kept between merge cycles and only
+//!     re-evaluated once a merge that intersects it has been applied.
+typedef struct oc_candidate_t {
+    //! The route shared by the entries
+    uint32_t route;
 
-    // Keep track of the current best merge and also provide a working merge
-    merge_t working;
+    //! The merge of the key_masks of all the entries with the route
+    key_mask_t key_mask;
 
-    success = merge_init(best, routing_table_get_n_entries());
-    if (!success) {
-        log_info("failed to init the merge best. throw response malloc");
-        *failed_by_malloc = true;
+    //! The number of entries with the route
+    unsigned int n_entries;
 
-        // free bits we already done
-        bit_set_delete(&considered);
+    //! The position of the first entry with the route in the table
+    int first_index;
 
-        // return false
-        return false;
-    }
+    //! The goodness if evaluated, otherwise an upper bound on it
+    int goodness;
 
-    success = merge_init(&working, routing_table_get_n_entries());
-    if (!success) {
-        log_info("failed to init the merge working. throw response malloc");
-        *failed_by_malloc = true;
+    //! Whether goodness has been evaluated rather than only bounded
+    bool evaluated;
 
-        // free bits we already done
-        merge_delete(best);
-        bit_set_delete(&considered);
+    //! Where the candidate is in the heap of candidates
+    unsigned int heap_index;
+} oc_candidate_t;
 
-        // return false
-        return false;
+//! \brief The candidate merges for every route in the table
+typedef struct oc_candidates_t {
+    //! The candidates, one per route
+    oc_candidate_t *candidates;
+
+    //! The number of candidates
+    unsigned int n_candidates;
+
+    //! \brief Open-addressed hash of route to one more than the index of its
+    //!     candidate; 0 marks an empty slot.
+    unsigned int *hash;
+
+    //! The number of slots in the hash less one; the slots are a power of 2
+    unsigned int hash_mask;
+
+    //! \brief The indices of the candidates, as a heap with the candidate
+    //!     that would be chosen first, by goodness or bound, at the top
+    unsigned int *heap;
+
+    //! \brief For each word of the entries of a merge, the number of entries
+    //!     merged in the words before it
+    unsigned int *merged_before;
+} oc_candidates_t;
+
+//! \brief Multiplicative hash of a route
+//! \param[in] route: The route to hash
+//! \param[in] hash_mask: The number of hash slots less one
+//! \return The first slot to probe for the route
+static inline unsigned int _oc_route_hash(
+        uint32_t route, unsigned int hash_mask) {
+    return ((route * 2654435761u) >> 8) & hash_mask;
+}
+
+//! \brief Find the hash slot for a route
+//! \param[in] c: The candidates
+//! \param[in] route: The route to look for
+//! \return The slot holding the route, or the empty slot where it would go
+static inline unsigned int *_oc_candidates_slot(
+        oc_candidates_t *c, uint32_t route) {
+    unsigned int i = _oc_route_hash(route, c->hash_mask);
+    while (c->hash[i] != 0 && c->candidates[c->hash[i] - 1].route != route) {
+        i = (i + 1) & c->hash_mask;
     }
+    return &c->hash[i];
+}
 
-    // For every entry in the table see with which other entries it could be
-    // merged.
-    log_debug("starting search for merge entry");
+//! \brief Compute the key_mask, size and position of each candidate from
+//!     the table
+//! \param[in] c: The candidates
+static void _oc_candidates_scan_table(oc_candidates_t *c) {
+    for (unsigned int i = 0; i < c->n_candidates; i++) {
+        c->candidates[i].n_entries = 0;
+    }
+    routing_table_cursor_t cursor;
+    routing_table_cursor_init(&cursor, 0, routing_table_get_n_entries());
     for (int i = 0; i < routing_table_get_n_entries(); i++) {
-        // safety check for timing limits
-        if (*stop_compressing) {
-            log_info("closed due to stop request");
-            // free bits we already done
-            merge_delete(best);
-            bit_set_delete(&considered);
-            return false;
+        entry_t *entry = routing_table_cursor_next(&cursor);
+        oc_candidate_t *cand =
+                &c->candidates[*_oc_candidates_slot(c, entry->route) - 1];
+        if (cand->n_entries == 0) {
+            cand->key_mask = entry->key_mask;
+            cand->first_index = i;
+        } else {
+            cand->key_mask = key_mask_merge(cand->key_mask, entry->key_mask);
         }
+        cand->n_entries++;
+    }
+}
 
-        // If this entry has already been considered then skip to the next
-        if (bit_set_contains(&considered, i)) {
-            continue;
+//! \brief Mark a candidate as needing to be evaluated
+//! \param[in] cand: The candidate
+static inline void _oc_candidate_invalidate(oc_candidate_t *cand) {
+    // It may be as good as its size allows
+    cand->goodness = cand->n_entries - 1;
+    cand->evaluated = false;
+}
+
+//! \brief Whether a candidate would be chosen before another
+//! \details The greater goodness, or bound on it, goes first, and of equals
+//!     the route whose first entry is first in the table. No two routes
+//!     share a first entry, so this orders every candidate.
+//! \param[in] a: The first candidate
+//! \param[in] b: The second candidate
+//! \return True if \p a goes before \p b
+static inline bool _oc_candidate_before(
+        const oc_candidate_t *a, const oc_candidate_t *b) {
+    return a->goodness > b->goodness || (a->goodness == b->goodness &&
+            a->first_index < b->first_index);
+}
+
+//! \brief Get the candidate at a place in the heap
+//! \param[in] c: The candidates
+//! \param[in] i: The place in the heap
+//! \return The candidate
+static inline oc_candidate_t *_oc_heap_get(
+        oc_candidates_t *c, unsigned int i) {
+    return &c->candidates[c->heap[i]];
+}
+
+//! \brief Swap two places in the heap
+//! \param[in] c: The candidates
+//! \param[in] i: The first place
+//! \param[in] j: The second place
+static inline void _oc_heap_swap(
+        oc_candidates_t *c, unsigned int i, unsigned int j) {
+    unsigned int tmp = c->heap[i];
+    c->heap[i] = c->heap[j];
+    c->heap[j] = tmp;
+    _oc_heap_get(c, i)->heap_index = i;
+    _oc_heap_get(c, j)->heap_index = j;
+}
+
+//! \brief Move a candidate down the heap until it is before its children
+//! \param[in] c: The candidates
+//! \param[in] i: The place of the candidate in the heap
+static void _oc_heap_down(oc_candidates_t *c, unsigned int i) {
+    while (true) {
+        unsigned int first = i;
+        unsigned int left = 2 * i + 1;
+        unsigned int right = left + 1;
+        if (left < c->n_candidates && _oc_candidate_before(
+                _oc_heap_get(c, left), _oc_heap_get(c, first))) {
+            first = left;
+        }
+        if (right < c->n_candidates && _oc_candidate_before(
+                _oc_heap_get(c, right), _oc_heap_get(c, first))) {
+            first = right;
+        }
+        if (first == i) {
+            return;
         }
+        _oc_heap_swap(c, i, first);
+        i = first;
+    }
+}
 
-        // Otherwise try to build a merge
-        // Clear the working merge
-        merge_clear(&working);
+//! \brief Move a candidate to its place in the heap after its goodness or
+//!     position has changed
+//! \param[in] c: The candidates
+//! \param[in] cand: The candidate
+static void _oc_heap_update(oc_candidates_t *c, oc_candidate_t *cand) {
+    unsigned int i = cand->heap_index;
+    while (i > 0 && _oc_candidate_before(
+            _oc_heap_get(c, i), _oc_heap_get(c, (i - 1) / 2))) {
+        _oc_heap_swap(c, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    _oc_heap_down(c, i);
+}
 
-        // Add to the merge
-        merge_add(&working, i);
+//! \brief Allocate an empty hash with room for a number of routes
+//! \param[in] n_routes: The number of routes to make room for
+//! \param[out] hash_mask: The number of slots less one
+//! \return The slots of the hash, or NULL if out of memory
+static unsigned int *_oc_route_hash_alloc(
+        unsigned int n_routes, unsigned int *hash_mask) {
+    // Make the hash at least twice as big as needed to keep the probe
+    // sequences short
+    unsigned int n_slots = 1;
+    while (n_slots < 2 * n_routes) {
+        n_slots <<= 1;
+    }
+    unsigned int *hash = MALLOC(n_slots * sizeof(unsigned int));
+    if (hash == NULL) {
+        log_error("failed to allocate a route hash of %d slots", n_slots);
+        return NULL;
+    }
+    for (unsigned int i = 0; i < n_slots; i++) {
+        hash[i] = 0;
+    }
+    *hash_mask = n_slots - 1;
+    return hash;
+}
 
-        // Mark this entry as considered
-        bit_set_add(&considered, i);
+//! \brief Free the memory used by the candidates
+//! \param[in] c: The candidates to free
+static inline void oc_candidates_delete(oc_candidates_t *c) {
+    if (c->candidates != NULL) {
+        FREE(c->candidates);
+    }
+    if (c->heap != NULL) {
+        FREE(c->heap);
+    }
+    if (c->merged_before != NULL) {
+        FREE(c->merged_before);
+    }
+    FREE(c->hash);
+}
 
-        // Get the entry
-        entry_t *entry = routing_table_get_entry(i);
+//! \brief Create a candidate merge for each route in the table
+//! \param[out] c: The candidates to create
+//! \return Whether successful or not; fails on lack of memory
+static bool oc_candidates_init(oc_candidates_t *c) {
+    int n_entries = routing_table_get_n_entries();
+
+    // Count the routes with a hash big enough for every entry to have its
+    // own route, holding one more than the position of the first entry with
+    // each route
+    unsigned int count_mask;
+    unsigned int *count_hash = _oc_route_hash_alloc(n_entries, &count_mask);
+    if (count_hash == NULL) {
+        return false;
+    }
+    unsigned int n_routes = 0;
+    for (int i = 0; i < n_entries; i++) {
+        uint32_t route = routing_table_get_entry(i)->route;
+        unsigned int j = _oc_route_hash(route, count_mask);
+        while (count_hash[j] != 0 &&
+                routing_table_get_entry(count_hash[j] - 1)->route != route) {
+            j = (j + 1) & count_mask;
+        }
+        if (count_hash[j] == 0) {
+            count_hash[j] = i + 1;
+            n_routes++;
+        }
+    }
+    FREE(count_hash);
 
-        // Try to merge with other entries
-        log_debug("starting second search at index %d", i);
-        for (int j = i+1; j < routing_table_get_n_entries(); j++) {
-            // safety check for timing limits
-            if (*stop_compressing) {
-                log_info("closed due to stop request");
-                // free bits we already done
-                merge_delete(best);
-                bit_set_delete(&considered);
-                return false;
-            }
+    // Now make the candidates and the hash to find them with
+    c->hash = _oc_route_hash_alloc(n_routes, &c->hash_mask);
+    if (c->hash == NULL) {
+        return false;
+    }
+    c->candidates = MALLOC(n_routes * sizeof(oc_candidate_t));
+    c->heap = MALLOC(n_routes * sizeof(unsigned int));
+    c->merged_before =
+            MALLOC(_bit_set_n_words(n_entries) * sizeof(unsigned int));
+    if (c->candidates == NULL || c->heap == NULL ||
+            c->merged_before == NULL) {
+        log_error("failed to allocate %d candidates", n_routes);
+        oc_candidates_delete(c);
+        return false;
+    }
+    c->n_candidates = 0;
+    for (int i = 0; i < n_entries; i++) {
+        uint32_t route = routing_table_get_entry(i)->route;
+        unsigned int *slot = _oc_candidates_slot(c, route);
+        if (*slot == 0) {
+            c->candidates[c->n_candidates++].route = route;
+            *slot = c->n_candidates;
+        }
+    }
+    _oc_candidates_scan_table(c);
+    for (unsigned int i = 0; i < c->n_candidates; i++) {
+        _oc_candidate_invalidate(&c->candidates[i]);
+        c->heap[i] = i;
+        c->candidates[i].heap_index = i;
+    }
+    for (unsigned int i = c->n_candidates / 2; i > 0; i--) {
+        _oc_heap_down(c, i - 1);
+    }
+    return true;
+}
 
-            // Get the other entry
-            entry_t *other = routing_table_get_entry(j);
+//! \brief Work out where an entry that was not merged is once a merge has
+//!     been applied, leaving out the new entry
+//! \param[in] c: The candidates, with ::oc_candidates_t::merged_before
+//!     filled in for the merge
+//! \param[in] merged: The entries that were merged
+//! \param[in] index: Where the entry was before the merge
+//! \return How many entries before it were not merged
+static inline int _oc_index_after_merge(
+        oc_candidates_t *c, bit_set_t *merged, int index) {
+    unsigned int word = index / BITS_IN_A_WORD;
+    uint32_t earlier = (1u << (index & 31)) - 1;
+    return index - c->merged_before[word] -
+            __builtin_popcount(merged->_data[word] & earlier);
+}
 
-            // check if merge-able
-            if (entry->route == other->route) {
-                // If the routes are the same then the entries may be merged
-                // Add to the merge
-                merge_add(&working, j);
+//! \brief Update the candidates after a merge has been applied to the table
+//! \details The entries of other routes keep their order, so only where
+//!     their candidates' first entries are moves; that is worked out from
+//!     the merged entries a word at a time, without looking at the table.
+//!     The merged route has fewer entries, and the candidates which
+//!     intersect the merge may now be covered by or uncovered by different
+//!     entries, so only these have to be re-evaluated and moved in the heap.
+//! \param[in] c: The candidates
+//! \param[in] merge: The merge that was applied
+//! \param[in] new_index: Where the merged entry was put in the table
+static void oc_candidates_merge_applied(
+        oc_candidates_t *c, merge_t *merge, int new_index) {
+    bit_set_t *merged = &merge->entries;
+    unsigned int n_merged = 0;
+    for (unsigned int i = 0; i < merged->n_words; i++) {
+        c->merged_before[i] = n_merged;
+        n_merged += __builtin_popcount(merged->_data[i]);
+    }
 
-                // Mark the other entry as considered
-                bit_set_add(&considered, j);
-            }
+    // Moving every first entry the same way keeps the order of the heap
+    for (unsigned int i = 0; i < c->n_candidates; i++) {
+        oc_candidate_t *cand = &c->candidates[i];
+        int index = _oc_index_after_merge(c, merged, cand->first_index);
+        if (cand->route != merge->route && index >= new_index) {
+            index++;
         }
+        cand->first_index = index;
+    }
 
-        if (merge_goodness(&working) <= merge_goodness(best)) {
-            continue;
+    // The entries of the merged route left are after where its first entry
+    // was, so its first entry is the first of them before the merged entry,
+    // or else the merged entry
+    oc_candidate_t *merged_cand =
+            &c->candidates[*_oc_candidates_slot(c, merge->route) - 1];
+    merged_cand->n_entries -= n_merged - 1;
+    int first_index = merged_cand->first_index;
+    if (merged_cand->n_entries > 1 && first_index < new_index) {
+        routing_table_cursor_t cursor;
+        routing_table_cursor_init(&cursor, first_index, new_index);
+        while (first_index < new_index &&
+                routing_table_cursor_next(&cursor)->route != merge->route) {
+            first_index++;
+        }
+    }
+    merged_cand->first_index =
+            (first_index < new_index) ? first_index : new_index;
+    _oc_candidate_invalidate(merged_cand);
+    _oc_heap_update(c, merged_cand);
+
+    for (unsigned int i = 0; i < c->n_candidates; i++) {
+        oc_candidate_t *cand = &c->candidates[i];
+        if (cand != merged_cand &&
+                key_mask_intersect(cand->key_mask, merge->key_mask)) {
+            _oc_candidate_invalidate(cand);
+            _oc_heap_update(c, cand);
         }
+    }
+}
 
-        // Perform the first down check
-        success = oc_down_check(
-                &working, merge_goodness(best), aliases, failed_by_malloc,
-                stop_compressing);
-        if (!success) {
-            log_error("failed to down check.");
+//! \brief Build and check the merge of the entries with a given route
+//! \param[in] route: The route of the entries to merge
+//! \param[in] min_goodness: The goodness the merge must exceed to be useful;
+//!     the checks stop early once the merge cannot exceed it
+//! \param[in] aliases: Describes what entries alias what other entries
+//! \param[in,out] working: The merge to build; must be initialised
+//! \param[out] failed_by_malloc: Flag saying failed by memory exhaustion
+//! \param[in] stop_compressing: Variable saying if compression should stop;
+//!     _set by interrupt_
+//! \return Whether successful or not.
+static bool oc_evaluate_merge(
+        uint32_t route, int min_goodness, aliases_t *aliases,
+        merge_t *working, bool *failed_by_malloc,
+        volatile bool *stop_compressing) {
+    merge_clear(working);
+    for (int j = 0; j < routing_table_get_n_entries(); j++) {
+        if (routing_table_get_entry(j)->route == route) {
+            merge_add(working, j);
+        }
+    }
 
-            // free bits we already done
-            merge_delete(best);
-            bit_set_delete(&considered);
+    if (merge_goodness(working) <= min_goodness) {
+        return true;
+    }
 
+    // Perform the first down check
+    if (!oc_down_check(working, min_goodness, aliases, failed_by_malloc,
+            stop_compressing)) {
+        log_error("failed to down check.");
+        return false;
+    }
+
+    if (merge_goodness(working) <= min_goodness) {
+        return true;
+    }
+
+    // Perform the up check, seeing if this actually makes a change to the
+    // size of the merge.
+    bool changed = false;
+    if (!oc_up_check(working, min_goodness, stop_compressing, &changed)) {
+        log_info("failed to upcheck");
+        return false;
+    }
+
+    // If the up check did make a change then the down check needs to be run
+    // again.
+    if (changed && merge_goodness(working) > min_goodness) {
+        log_debug("down check");
+        if (!oc_down_check(working, min_goodness, aliases, failed_by_malloc,
+                stop_compressing)) {
+            log_error("failed to down check. ");
             return false;
         }
+    }
+    return true;
+}
 
-        if (merge_goodness(&working) <= merge_goodness(best)) {
-            continue;
+//! \brief Get the best merge which can be applied to a routing table
+//! \details The best merge is the one with the greatest goodness, and of
+//!     those the one whose route appears first in the table. The candidate
+//!     at the top of the heap is evaluated only as far as needed to tell
+//!     whether it beats the best evaluated so far, and moved down the heap,
+//!     until the top one has been evaluated, as then no bound on another
+//!     could beat it.
+//! \param[in] aliases: Describes what entries alias what other entries
+//! \param[in] candidates: The candidate merges of the table
+//! \param[in,out] best: The best merge found
+//! \param[out] failed_by_malloc: Flag saying failed by memory exhaustion
+//! \param[in] stop_compressing: Variable saying if compression should stop;
+//!     _set by interrupt_
+//! \return Whether successful or not.
+static inline bool oc_get_best_merge(
+        aliases_t *aliases, oc_candidates_t *candidates, merge_t *best,
+        bool *failed_by_malloc, volatile bool *stop_compressing) {
+    if (!merge_init(best, routing_table_get_n_entries())) {
+        log_info("failed to init the merge best. throw response malloc");
+        *failed_by_malloc = true;
+        return false;
+    }
+
+    // Provide a working merge
+    merge_t working;
+    if (!merge_init(&working, routing_table_get_n_entries())) {
+        log_info("failed to init the merge working. throw response malloc");
+        *failed_by_malloc = true;
+        merge_delete(best);
+        return false;
+    }
+
+    // The candidate whose merge is currently held in best, if any
+    oc_candidate_t *in_best = NULL;
+
+    // The best candidate already evaluated, which those not evaluated have
+    // to beat; comparing against it rather than the next in the heap keeps
+    // a candidate from being part evaluated again for each one it passes
+    oc_candidate_t *best_cand = NULL;
+    for (unsigned int i = 0; i < candidates->n_candidates; i++) {
+        oc_candidate_t *cand = &candidates->candidates[i];
+        if (cand->evaluated && cand->goodness > 0 && (best_cand == NULL ||
+                _oc_candidate_before(cand, best_cand))) {
+            best_cand = cand;
         }
+    }
 
-        // Perform the up check, seeing if this actually makes a change to the
-        // size of the merge.
-        bool changed = false;
-        success = oc_up_check(
-                &working, merge_goodness(best), stop_compressing, &changed);
-        if (!success) {
-            log_info("failed to upcheck");
-            // free bits we already done
+    log_debug("starting search for merge entry");
+    while (true) {
+        // safety check for timing limits
+        if (*stop_compressing) {
+            log_info("closed due to stop request");
             merge_delete(best);
-            bit_set_delete(&considered);
+            merge_delete(&working);
             return false;
         }
 
-        // if changed the merge
-        if (changed) {
-            if (merge_goodness(&working) <= merge_goodness(best)) {
-                continue;
+        // The candidate at the top of the heap is the best if evaluated, as
+        // nothing else can even be bounded to beat it
+        oc_candidate_t *next = _oc_heap_get(candidates, 0);
+        if (next->goodness <= 0) {
+            merge_clear(best);
+            break;
+        }
+        if (next->evaluated) {
+            // Make sure best holds its merge
+            if (in_best != next) {
+                if (!oc_evaluate_merge(next->route, 0, aliases, best,
+                        failed_by_malloc, stop_compressing)) {
+                    merge_delete(best);
+                    merge_delete(&working);
+                    return false;
+                }
             }
+            break;
+        }
 
-            // If the up check did make a change then the down check needs to
-            // be run again.
-            log_debug("down check");
-            success = oc_down_check(
-                    &working, merge_goodness(best), aliases, failed_by_malloc,
-                    stop_compressing);
-            if (!success) {
-                log_error("failed to down check. ");
-
-                // free bits we already done
-                merge_delete(best);
-                bit_set_delete(&considered);
-
-                return false;
+        // A candidate earlier in the table wins a tie, so it only needs to
+        // be worked out fully if it at least equals the best evaluated
+        int min_goodness = 0;
+        if (best_cand != NULL) {
+            min_goodness = best_cand->goodness;
+            if (next->first_index < best_cand->first_index) {
+                min_goodness--;
             }
         }
+        if (!oc_evaluate_merge(next->route, min_goodness, aliases, &working,
+                failed_by_malloc, stop_compressing)) {
+            merge_delete(best);
+            merge_delete(&working);
+            return false;
+        }
 
-        // If the merge is still better than the current best merge we swap the
-        // current and best merges to record the new best merge.
-        if (merge_goodness(best) < merge_goodness(&working)) {
+        int goodness = merge_goodness(&working);
+        if (goodness > min_goodness) {
+            // The checks ran to completion, so this is the real goodness
+            next->goodness = goodness;
+            next->evaluated = true;
             merge_t other = working;
             working = *best;
             *best = other;
+            in_best = next;
+            best_cand = next;
+        } else if (min_goodness <= 0) {
+            // Nothing worthwhile can be made of this route
+            next->goodness = 0;
+            next->evaluated = true;
+        } else {
+            // The checks stopped early, so all that is known is a bound
+            next->goodness = min_goodness;
         }
+        _oc_heap_down(candidates, 0);
     }
 
     // Tidy up
     merge_delete(&working);
-    bit_set_delete(&considered);
     log_debug("n entries is %d", routing_table_get_n_entries());
     // found the best merge. return true
     return true;
@@ -626,10 +943,12 @@ static inline bool oc_get_best_merge(
 //! \brief Apply a merge to the table against which it is defined
 //! \param[in] merge: The merge to apply to the routing tables
 //! \param[in] aliases: Describes what entries alias what other entries
+//! \param[out] new_index: Where the merged entry was put in the table
 //! \param[out] failed_by_malloc: Flag saying failed by memory exhaustion
 //! \return Whether successful or not
 static inline bool oc_merge_apply(
-        merge_t *merge, aliases_t *aliases, bool *failed_by_malloc) {
+        merge_t *merge, aliases_t *aliases, int *new_index,
+        bool *failed_by_malloc) {
     // Get the new entry
     entry_t new_entry;
     new_entry.key_mask = merge->key_mask;
@@ -658,15 +977,6 @@ static inline bool oc_merge_apply(
         return false;
     }
 
-    log_debug("alias insert");
-    bool malloc_success =
-            aliases_insert(aliases, new_entry.key_mask, new_aliases);
-    if (!malloc_success) {
-        log_error("failed to malloc new alias list during insert");
-        *failed_by_malloc = true;
-        return false;
-    }
-
     // Use two iterators to move through the table copying entries from one
     // position to the other as required.
     int insert = 0;
@@ -694,6 +1004,7 @@ static inline bool oc_merge_apply(
             insert_entry->key_mask.mask = new_entry.key_mask.mask;
             insert_entry->route = new_entry.route;
             insert_entry->source = new_entry.source;
+            *new_index = insert;
             insert++;
         }
 
@@ -741,9 +1052,16 @@ static inline bool oc_merge_apply(
         }
     }
 
-    log_debug("alias delete");
-    alias_list_delete(new_aliases);
-    log_debug("alias delete end");
+
+    // Record the aliases of the new entry. This is done once the aliases of
+    // the merged entries have been taken out, as one of them may have the
+    // same key_mask as the new entry.
+    log_debug("alias insert");
+    if (!aliases_insert(aliases, new_entry.key_mask, new_aliases)) {
+        log_error("failed to malloc new alias list during insert");
+        *failed_by_malloc = true;
+        return false;
+    }
 
     // If inserting beyond the old end of the table then perform the insertion
     // at the new end of the table.
@@ -755,6 +1073,7 @@ static inline bool oc_merge_apply(
         insert_entry->key_mask.mask = new_entry.key_mask.mask;
         insert_entry->route = new_entry.route;
         insert_entry->source = new_entry.source;
+        *new_index = insert;
     }
 
     // Record the new size of the table
@@ -786,6 +1105,27 @@ bool minimise_run(
     // Some Mundy black magic
     aliases_t aliases = aliases_init();
 
+    // Get the memory for bit sets and aliases up front, rather than once or
+    // more per merge cycle
+    int n_entries = routing_table_get_n_entries();
+    aliases_memory_init(n_entries);
+    if (!bit_set_pool_init(n_entries)) {
+        log_error("failed to allocate the memory for minimising");
+        *failed_by_malloc = true;
+        aliases_clear(&aliases);
+        bit_set_pool_delete();
+        return false;
+    }
+
+    // The merge of each route, kept between merge cycles
+    oc_candidates_t candidates;
+    if (!oc_candidates_init(&candidates)) {
+        *failed_by_malloc = true;
+        aliases_clear(&aliases);
+        bit_set_pool_delete();
+        return false;
+    }
+
     // start the merger process
     log_debug("n entries is %d", routing_table_get_n_entries());
     int attempts = 0;
@@ -798,11 +1138,14 @@ bool minimise_run(
         // of the loop.
         merge_t merge;
         bool success = oc_get_best_merge(
-                &aliases, &merge, failed_by_malloc, stop_compressing);
+                &aliases, &candidates, &merge, failed_by_malloc,
+                stop_compressing);
         if (!success) {
             log_debug("failed to do get best merge. "
                     "the number of merge cycles were %d", attempts);
+            oc_candidates_delete(&candidates);
             aliases_clear(&aliases);
+            bit_set_pool_delete();
             return false;
         }
 
@@ -814,14 +1157,21 @@ bool minimise_run(
             // actually occurring.
             //routing_tables_print_out_table_sizes();
             log_debug("merge apply");
+            minimise_best_length = -1;
+            int new_index = 0;
             bool malloc_success = oc_merge_apply(
-                    &merge, &aliases, failed_by_malloc);
+                    &merge, &aliases, &new_index, failed_by_malloc);
 
             if (!malloc_success) {
                 log_error("failed to malloc");
+                merge_delete(&merge);
+                oc_candidates_delete(&candidates);
                 aliases_clear(&aliases);
+                bit_set_pool_delete();
                 return false;
             }
+            oc_candidates_merge_applied(&candidates, &merge, new_index);
+            minimise_best_length = routing_table_get_n_entries();
             log_debug("merge apply end");
             //routing_tables_print_out_table_sizes();
         }
@@ -839,6 +1189,8 @@ bool minimise_run(
         attempts += 1;
     }
 
+    oc_candidates_delete(&candidates);
+
     // shut down timer. as passed the compression
     spin1_pause();
 
@@ -848,6 +1200,7 @@ bool minimise_run(
                 routing_table_get_n_entries(), attempts);
         spin1_pause();
         aliases_clear(&aliases);
+        bit_set_pool_delete();
         return false;
     }
 
@@ -859,6 +1212,7 @@ bool minimise_run(
     log_debug("compressed!!!");
     log_debug("produced table with %d entries", routing_table_get_n_entries());
     aliases_clear(&aliases);
+    bit_set_pool_delete();
     return true;
 }
 
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2020 The University of Manchester
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//! \file
+//! \brief Slab allocators for the temporaries of the ordered covering.
+//! \details Memory is taken from MALLOC a slab at a time and handed out
+//!     from there, so the allocator is not called for each merge, and
+//!     all of it is given back at once when the pool is deleted.
+//!
+//!     A pool_t hands out blocks of one size, which can be given back to it
+//!     one at a time. An arena_t hands out blocks of any size, which are
+//!     only given back when the whole arena is deleted.
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <malloc_extras.h>
+#include <debug.h>
+
+//! \brief Header of a slab of memory obtained from MALLOC
+typedef struct pool_slab_t {
+    //! The slab obtained before this one
+    struct pool_slab_t *next;
+
+    //! The number of bytes in data
+    uint32_t size;
+
+    //! The number of bytes of data handed out; only used by arenas
+    uint32_t used;
+
+    //! The memory handed out; double-word aligned for 64-bit fields
+    uint64_t data[];
+} pool_slab_t;
+
+//! \brief A block that has been given back to a pool
+typedef struct pool_free_block_t {
+    //! The next block that is free
+    struct pool_free_block_t *next;
+} pool_free_block_t;
+
+//! \brief A pool of fixed size blocks
+typedef struct pool_t {
+    //! The size of each block in bytes; a whole number of double words
+    uint32_t block_size;
+
+    //! The number of blocks to get from MALLOC at a time
+    uint32_t blocks_per_slab;
+
+    //! The blocks which are free to be handed out
+    pool_free_block_t *free_blocks;
+
+    //! The slabs in use
+    pool_slab_t *slabs;
+} pool_t;
+
+//! \brief An arena of blocks of any size
+typedef struct arena_t {
+    //! The minimum size of slab to get from MALLOC, in bytes
+    uint32_t slab_size;
+
+    //! The slabs in use; the first is the one being handed out from
+    pool_slab_t *slabs;
+} arena_t;
+
+//! \brief Round a size in bytes up to a whole number of double words, so
+//!     that every block handed out stays aligned
+//! \param[in] size: The size in bytes
+//! \return The rounded size in bytes
+static inline uint32_t _pool_round_size(uint32_t size) {
+    return (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+}
+
+//! \brief Get a slab from MALLOC and add it to a list of slabs
+//! \param[in,out] slabs: The list of slabs to add to
+//! \param[in] size: The number of bytes of data in the slab
+//! \return The new slab or NULL if there was no memory for it
+static inline pool_slab_t *_pool_new_slab(pool_slab_t **slabs, uint32_t size) {
+    pool_slab_t *slab = MALLOC(sizeof(pool_slab_t) + size);
+    if (slab == NULL) {
+        log_error("failed to allocate a slab of %d bytes", size);
+        return NULL;
+    }
+    slab->next = *slabs;
+    slab->size = size;
+    slab->used = 0;
+    *slabs = slab;
+    return slab;
+}
+
+//! \brief Give all slabs in a list back to the allocator
+//! \param[in,out] slabs: The list of slabs to free; emptied
+static inline void _pool_free_slabs(pool_slab_t **slabs) {
+    while (*slabs != NULL) {
+        pool_slab_t *next = (*slabs)->next;
+        FREE(*slabs);
+        *slabs = next;
+    }
+}
+
+//! \brief Add a new slab of blocks to a pool
+//! \param[in] p: The pool to grow
+//! \return Whether there was memory for the slab
+static bool _pool_grow(pool_t *p) {
+    pool_slab_t *slab =
+            _pool_new_slab(&p->slabs, p->block_size * p->blocks_per_slab);
+    if (slab == NULL) {
+        return false;
+    }
+    uint8_t *block = (uint8_t *) slab->data;
+    for (uint32_t i = 0; i < p->blocks_per_slab; i++) {
+        pool_free_block_t *free_block = (pool_free_block_t *) block;
+        free_block->next = p->free_blocks;
+        p->free_blocks = free_block;
+        block += p->block_size;
+    }
+    return true;
+}
+
+//! \brief Create a pool of fixed size blocks, with its first slab
+//! \param[out] p: The pool to create
+//! \param[in] block_size: The size of each block in bytes
+//! \param[in] blocks_per_slab: The number of blocks to allocate at a time
+//! \return Whether there was memory for the first slab
+static bool pool_init(
+        pool_t *p, uint32_t block_size, uint32_t blocks_per_slab) {
+    if (block_size < sizeof(pool_free_block_t)) {
+        block_size = sizeof(pool_free_block_t);
+    }
+    p->block_size = _pool_round_size(block_size);
+    p->blocks_per_slab = (blocks_per_slab > 0) ? blocks_per_slab : 1;
+    p->free_blocks = NULL;
+    p->slabs = NULL;
+    return _pool_grow(p);
+}
+
+//! \brief Get a block from a pool, growing it if needed
+//! \param[in] p: The pool to get a block from
+//! \return The block, or NULL if there is no memory or the pool was not
+//!     created
+static inline void *pool_alloc(pool_t *p) {
+    if (p->free_blocks == NULL &&
+            (p->block_size == 0 || !_pool_grow(p))) {
+        return NULL;
+    }
+    pool_free_block_t *block = p->free_blocks;
+    p->free_blocks = block->next;
+    return block;
+}
+
+//! \brief Give a block back to the pool it came from
+//! \param[in] p: The pool the block came from
+//! \param[in] block: The block to give back
+static inline void pool_free(pool_t *p, void *block) {
+    pool_free_block_t *free_block = block;
+    free_block->next = p->free_blocks;
+    p->free_blocks = free_block;
+}
+
+//! \brief Give all the memory of a pool back to the allocator
+//! \param[in] p: The pool to delete; any blocks from it are invalid after
+static inline void pool_delete(pool_t *p) {
+    _pool_free_slabs(&p->slabs);
+    p->free_blocks = NULL;
+}
+
+//! \brief Create an arena; no memory is allocated until it is used
+//! \param[out] a: The arena to create
+//! \param[in] slab_size: The smallest slab to allocate at a time, in bytes
+static inline void arena_init(arena_t *a, uint32_t slab_size) {
+    a->slab_size = _pool_round_size(slab_size);
+    a->slabs = NULL;
+}
+
+//! \brief Get a block from an arena
+//! \param[in] a: The arena to get the block from
+//! \param[in] size: The size of the block in bytes
+//! \return The block, or NULL if there is no memory
+static inline void *arena_alloc(arena_t *a, uint32_t size) {
+    size = _pool_round_size(size);
+    pool_slab_t *slab = a->slabs;
+    if (slab == NULL || slab->size - slab->used < size) {
+        slab = _pool_new_slab(
+                &a->slabs, (size > a->slab_size) ? size : a->slab_size);
+        if (slab == NULL) {
+            return NULL;
+        }
+    }
+    void *block = ((uint8_t *) slab->data) + slab->used;
+    slab->used += size;
+    return block;
+}
+
+//! \brief Give all the memory of an arena back to the allocator
+//! \param[in] a: The arena to delete; any blocks from it are invalid after
+static inline void arena_delete(arena_t *a) {
+    _pool_free_slabs(&a->slabs);
+}
+
+#endif  // __POOL_H__
@@ -20,6 +20,7 @@
 #include <debug.h>
 #include <malloc_extras.h>
 #include "../common/routing_table.h"
+#include "../common/router_loader.h"
 
 #ifndef __RT_SINGLE_H__
 #define __RT_SINGLE_H__
@@ -61,9 +62,6 @@
  * will be freed on exit by this application.
  */
 
-//! \brief flag for if a rtr_mc_set() failure.
-#define RTR_MC_SET_FAILED 0
-
 //! \brief The table being manipulated.
 //!
 //! This is common across all the functions in this file.
@@ -97,10 +95,21 @@ void routing_table_remove_from_size(int size_to_remove) {
     table->size -= size_to_remove;
 }
 
+void routing_table_restore_size(int size_to_restore) {
+    table->size += size_to_restore;
+}
+
 entry_t* routing_table_get_entry(uint32_t entry_id_to_find) {
     return &table->entries[entry_id_to_find];
 }
 
+void routing_table_cursor_fill(routing_table_cursor_t *cursor) {
+    // The whole table is one run
+    cursor->entry = &table->entries[cursor->next_index];
+    cursor->stop = &table->entries[cursor->end_index];
+    cursor->next_index = cursor->end_index;
+}
+
 //! \brief Print the header object for debug purposes
 //! \param[in] header: the header to print
 void print_header(header_t *header) {
@@ -142,18 +151,9 @@ bool load_routing_table(uint32_t app_id) {
     // Load entries into the table (provided the allocation succeeded).
     // Note that although the allocation included the specified
     // application ID we also need to include it as the most significant
-    // byte in the route (see `sark_hw.c`).
-    for (uint32_t i = 0; i < table->size; i++) {
-        entry_t entry = table->entries[i];
-        uint32_t route = entry.route | (app_id << 24);
-        uint success = rtr_mc_set(
-            entry_id + i, entry.key_mask.key, entry.key_mask.mask, route);
-        if (success == RTR_MC_SET_FAILED) {
-            log_error(
-                "failed to set a router table entry at index %d",
-                entry_id + i);
-        }
-    }
+    // byte in the route (see `sark_hw.c`). Entries the router refuses are
+    // reported by the loader and do not stop the rest loading.
+    router_loader_load(table->entries, table->size, app_id, entry_id);
 
     // Indicate we were able to allocate routing table entries.
     return TRUE;
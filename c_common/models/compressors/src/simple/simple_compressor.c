@@ -69,6 +69,8 @@ void compress_start(uint unused0, uint unused1) {
         // report size to the host for provenance aspects
         log_info("Compressed the router table from %d to %d entries",
                 size_original, routing_table_get_n_entries());
+        // report which algorithm did it, as the adaptive build picks
+        sark.vcpu->user3 = compressor_path;
     } else {
         log_info("Exiting as compressor reported failure");
         // set the failed flag and exit
@@ -78,6 +80,8 @@ void compress_start(uint unused0, uint unused1) {
     // Try to load the routing table
     log_debug("try loading tables");
     if (load_routing_table(header->app_id)) {
+        // report the load time to the host for provenance aspects
+        sark.vcpu->user2 = router_loader_load_time_us;
         cleanup_and_exit(header);
     } else {
         // Otherwise give up and exit with an error
@@ -71,7 +71,9 @@ static inline bool remove_default_routes_minimise(int target_length) {
     }
 
     uint32_t removed = 0;
-    int last = routing_table_get_n_entries();
+    // The last entry still in the table, to move into the place of one
+    // removed
+    int last = routing_table_get_n_entries() - 1;
     // Do the actual removal
     for (int i = 0; i < after_size; i++) {
         // Get the current entry
@@ -26,6 +26,7 @@
 #include <malloc_extras.h>
 #include "common/constants.h"
 #include "bit_field_common/compressor_sorter_structs.h"
+#include "bit_field_common/bit_field_counter.h"
 
 //! For each possible processor the first index of a row for that processor
 static int processor_heads[MAX_PROCESSORS];
@@ -33,19 +34,62 @@ static int processor_heads[MAX_PROCESSORS];
 //! Sum of packets per processor for bitfields with redundancy not yet ordered
 static uint32_t processor_totals[MAX_PROCESSORS];
 
+//! \brief Processors with bitfields not yet ordered, as a heap with the
+//!     processor with the most packets coming in at the top
+static int processor_heap[MAX_PROCESSORS];
+
+//! The number of processors in processor_heap
+static int processor_heap_size;
+
 //! \brief Read a bitfield and deduces how many bits are not set
 //! \param[in] filter_info: The bitfield to look for redundancy in
 //! \return How many redundant packets there are
-static uint32_t detect_redundant_packet_count(
+static inline uint32_t detect_redundant_packet_count(
         filter_info_t *restrict filter_info) {
-    uint32_t n_filtered_packets = 0;
-    uint32_t n_neurons = filter_info->n_atoms;
-    for (uint neuron_id = 0; neuron_id < n_neurons; neuron_id++) {
-        if (!bit_field_test(filter_info->data, neuron_id)) {
-            n_filtered_packets += 1;
+    return bit_field_counter_n_redundant(filter_info);
+}
+
+//! \brief Determine if one processor should be ordered before another
+//! \details Ties go to the lowest processor ID so the order is repeatable
+//! \param[in] a: The first processor
+//! \param[in] b: The second processor
+//! \return Whether a has more packets coming in than b
+static inline bool _processor_heap_before(int a, int b) {
+    return (processor_totals[a] > processor_totals[b]) ||
+            ((processor_totals[a] == processor_totals[b]) && (a < b));
+}
+
+//! \brief Move a processor down the heap until it is in the right place
+//! \param[in] root: The position in the heap of the processor to move
+static void _processor_heap_sift(int root) {
+    int item = processor_heap[root];
+    int child = 2 * root + 1;
+    while (child < processor_heap_size) {
+        if ((child + 1 < processor_heap_size) && _processor_heap_before(
+                processor_heap[child + 1], processor_heap[child])) {
+            child++;
         }
+        if (!_processor_heap_before(processor_heap[child], item)) {
+            break;
+        }
+        processor_heap[root] = processor_heap[child];
+        root = child;
+        child = 2 * root + 1;
+    }
+    processor_heap[root] = item;
+}
+
+//! \brief Put every processor with bitfields to order into the heap
+static void _processor_heap_build(void) {
+    processor_heap_size = 0;
+    for (int c = 0; c < MAX_PROCESSORS; c++) {
+        if (processor_heads[c] != DO_NOT_USE) {
+            processor_heap[processor_heap_size++] = c;
+        }
+    }
+    for (int i = processor_heap_size / 2 - 1; i >= 0; i--) {
+        _processor_heap_sift(i);
     }
-    return n_filtered_packets;
 }
 
 //! \brief Fill in the order column based on packet reduction
@@ -55,21 +99,22 @@ static inline void order_bitfields(
     // Semantic sugar to avoid extra lookup all the time
     int *restrict processor_ids = sorted_bit_fields->processor_ids;
     int *restrict sort_order =  sorted_bit_fields->sort_order;
-    filter_info_t **restrict bit_fields = sorted_bit_fields->bit_fields;
+    uint32_t *restrict n_redundant_packets =
+            sorted_bit_fields->n_redundant_packets;
+
+    _processor_heap_build();
 
     // To label each row in sort order
     for (int sorted_index = 0; sorted_index < sorted_bit_fields->n_bit_fields;
             sorted_index++) {
 
-        // Find the processor with highest number of packets coming in
-        int worst_processor = 0;
-        uint32_t highest_neurons = 0;
-        for (int c = 0; c < MAX_PROCESSORS; c++) {
-            if (processor_totals[c] > highest_neurons){
-                worst_processor = c;
-                highest_neurons = processor_totals[c];
-            }
+        // The processor with highest number of packets coming in is on top
+        if (processor_heap_size == 0) {
+            log_error("ran out of processors at sorted index %d of %d",
+                    sorted_index, sorted_bit_fields->n_bit_fields);
+            return;
         }
+        int worst_processor = processor_heap[0];
 
         // Label the row pointer to be the header as next
         int index = processor_heads[worst_processor];
@@ -86,15 +131,19 @@ static inline void order_bitfields(
                     processor_totals[worst_processor]);
 
             // reduce the packet count bu redundancy
-            processor_totals[worst_processor] -=
-                    detect_redundant_packet_count(bit_fields[index]);
+            processor_totals[worst_processor] -= n_redundant_packets[index];
 
             // move the pointer
             processor_heads[worst_processor] += 1;
+
+            // it has fewer packets now so may no longer be the worst
+            _processor_heap_sift(0);
         } else {
             // otherwise set the counters to ignore this processor
             processor_totals[worst_processor] = NO_BIT_FIELDS;
             processor_heads[worst_processor] = DO_NOT_USE;
+            processor_heap[0] = processor_heap[--processor_heap_size];
+            _processor_heap_sift(0);
 
             log_debug("i %u processor %u index %u last %u total %u",
                     sorted_index, worst_processor, index,
@@ -104,6 +153,35 @@ static inline void order_bitfields(
     }
 }
 
+//! \brief Swap two rows of the sorted bitfields
+//! \param[in] sorted_bit_fields: Data to be ordered
+//! \param[in] i: The first row
+//! \param[in] j: The second row
+static inline void swap_rows(
+        sorted_bit_fields_t *restrict sorted_bit_fields, int i, int j) {
+    int *restrict processor_ids = sorted_bit_fields->processor_ids;
+    int *restrict sort_order = sorted_bit_fields->sort_order;
+    filter_info_t **restrict bit_fields = sorted_bit_fields->bit_fields;
+    uint32_t *restrict n_redundant_packets =
+            sorted_bit_fields->n_redundant_packets;
+
+    int temp_processor_id = processor_ids[i];
+    processor_ids[i] = processor_ids[j];
+    processor_ids[j] = temp_processor_id;
+
+    int temp_sort_order = sort_order[i];
+    sort_order[i] = sort_order[j];
+    sort_order[j] = temp_sort_order;
+
+    filter_info_t* bit_field_temp = bit_fields[i];
+    bit_fields[i] = bit_fields[j];
+    bit_fields[j] = bit_field_temp;
+
+    uint32_t temp_n_redundant = n_redundant_packets[i];
+    n_redundant_packets[i] = n_redundant_packets[j];
+    n_redundant_packets[j] = temp_n_redundant;
+}
+
 //! \brief Sort the data bases on the sort_order array
 //! \param[in] sorted_bit_fields: Data to be ordered
 //! \internal
@@ -116,62 +194,54 @@ static inline void sort_by_order(
     // There is one check per row in the for loop plus if the first fails
     // up to one more for each row about to be moved to the correct place.
 
-    int *restrict processor_ids = sorted_bit_fields->processor_ids;
     int *restrict sort_order = sorted_bit_fields->sort_order;
-    filter_info_t **restrict bit_fields = sorted_bit_fields->bit_fields;
 
     // Check each row in the lists
     for (int i = 0; i < sorted_bit_fields->n_bit_fields; i++) {
         // check that the data is in the correct place
         while (sort_order[i] != i) {
-            int j = sort_order[i];
             // If not swap the data there into the correct place
-            int temp_processor_id = processor_ids[i];
-            processor_ids[i] = processor_ids[j];
-            processor_ids[j] = temp_processor_id;
-
-            uint32_t temp_sort_order = sort_order[i];
-            sort_order[i] = sort_order[j];
-            sort_order[j] = temp_sort_order;
+            swap_rows(sorted_bit_fields, i, sort_order[i]);
+        }
+    }
+}
 
-            filter_info_t* bit_field_temp = bit_fields[i];
-            bit_fields[i] = bit_fields[j];
-            bit_fields[j] = bit_field_temp;
+//! \brief Move a row down a heap ordered by key until it is in place
+//! \param[in] sorted_bit_fields: Data to be ordered
+//! \param[in] root: The row to move
+//! \param[in] n: The number of rows in the heap
+static void sift_by_key(
+        sorted_bit_fields_t *restrict sorted_bit_fields, int root, int n) {
+    filter_info_t **restrict bit_fields = sorted_bit_fields->bit_fields;
+    int child = 2 * root + 1;
+    while (child < n) {
+        if ((child + 1 < n) &&
+                (bit_fields[child + 1]->key > bit_fields[child]->key)) {
+            child++;
         }
+        if (bit_fields[child]->key <= bit_fields[root]->key) {
+            return;
+        }
+        swap_rows(sorted_bit_fields, root, child);
+        root = child;
+        child = 2 * root + 1;
     }
 }
 
 //! \brief Sort the data based on the bitfield key
+//! \details Heapsort, so no recursion and no extra memory. Rows with the
+//!     same key may end up in any order, which is fine as they are only
+//!     ever used together.
 //! \param[in] sorted_bit_fields: Data to be ordered
 static inline void sort_by_key(
         sorted_bit_fields_t *restrict sorted_bit_fields) {
-    // Semantic sugar to avoid extra lookup all the time
-    int *restrict processor_ids = sorted_bit_fields->processor_ids;
-    int *restrict sort_order = sorted_bit_fields->sort_order;
-    filter_info_t **restrict bit_fields = sorted_bit_fields->bit_fields;
-
-    // Everytime there is a swap at least one of the rows is moved to the
-    //      final place.
-    //  There is one check per row in the for loop plus if the first fails
-    //      up to one more for each row about to be moved to the correct place.
-    for (int i = 0; i < sorted_bit_fields->n_bit_fields - 1; i++) {
-        for (int j = i + 1; j < sorted_bit_fields->n_bit_fields; j++) {
-           // check location
-           if (bit_fields[i]->key > bit_fields[j]->key) {
-                // If not swap the data there into the correct place
-                int temp_processor_id = processor_ids[i];
-                processor_ids[i] = processor_ids[j];
-                processor_ids[j] = temp_processor_id;
-
-                uint32_t temp_sort_order = sort_order[i];
-                sort_order[i] = sort_order[j];
-                sort_order[j] = temp_sort_order;
-
-                filter_info_t* bit_field_temp = bit_fields[i];
-                bit_fields[i] = bit_fields[j];
-                bit_fields[j] = bit_field_temp;
-            }
-        }
+    int n_bit_fields = sorted_bit_fields->n_bit_fields;
+    for (int i = n_bit_fields / 2 - 1; i >= 0; i--) {
+        sift_by_key(sorted_bit_fields, i, n_bit_fields);
+    }
+    for (int i = n_bit_fields - 1; i > 0; i--) {
+        swap_rows(sorted_bit_fields, 0, i);
+        sift_by_key(sorted_bit_fields, 0, i);
     }
 }
 
@@ -187,8 +257,7 @@ static inline void print_structs(
                 sorted_bit_fields->processor_ids[index],
                 sorted_bit_fields->bit_fields[index]->key,
                 sorted_bit_fields->bit_fields[index]->data,
-                detect_redundant_packet_count(
-                        sorted_bit_fields->bit_fields[index]),
+                sorted_bit_fields->n_redundant_packets[index],
                 sorted_bit_fields->sort_order[index]);
     }
 }
@@ -225,6 +294,9 @@ static inline void fills_in_sorted_bit_fields_and_tracker(
             sorted_bit_fields->processor_ids[index] = processor;
             sorted_bit_fields->bit_fields[index] =
                     &filter_region->filters[bf_id];
+            sorted_bit_fields->n_redundant_packets[index] =
+                    detect_redundant_packet_count(
+                            &filter_region->filters[bf_id]);
             processor_totals[processor] +=
                     filter_region->filters[bf_id].n_atoms;
         }
@@ -348,6 +420,18 @@ static inline sorted_bit_fields_t * bit_field_reader_initialise(
             return NULL;
         }
 
+        sorted_bit_fields->n_redundant_packets = MALLOC_SDRAM(
+                n_bit_fields * sizeof(uint32_t));
+        if (sorted_bit_fields->n_redundant_packets == NULL) {
+            log_error("cannot allocate memory for the sorted bitfields "
+                    "redundant packet counts");
+            FREE(sorted_bit_fields->bit_fields);
+            FREE(sorted_bit_fields->processor_ids);
+            FREE(sorted_bit_fields->sort_order);
+            FREE(sorted_bit_fields);
+            return NULL;
+        }
+
         // init to -1, else random data (used to make prints cleaner)
         for (int sorted_index = 0; sorted_index < n_bit_fields;
                 sorted_index++) {
@@ -30,6 +30,7 @@
 #include <malloc_extras.h>
 #include "common-typedefs.h"
 #include "common/constants.h"
+#include "common/router_loader.h"
 #include "bit_field_common/routing_tables_utils.h"
 #include "bit_field_common/compressor_sorter_structs.h"
 #include "bit_field_common/bit_field_table_generator.h"
@@ -56,8 +57,8 @@
 //! Flag for if a rtr_mc failure.
 #define RTR_MC_FAILED 0
 
-//! Bit shift for the app id for the route
-#define ROUTE_APP_ID_BIT_SHIFT 24
+//! Most mid-points that can be shared by several compressors at once
+#define MAX_PARTITIONED_RUNS (MAX_PROCESSORS / 2)
 
 //! Callback priorities
 typedef enum priorities {
@@ -65,6 +66,26 @@ typedef enum priorities {
     TIMER_TICK_PRIORITY = 0     //!< Timer tick is high priority
 } priorities;
 
+//! \brief The replies so far for a mid-point whose table is shared by
+//!     several compressors, each minimising one partition of it
+typedef struct partitioned_run_t {
+    //! The mid-point the compressors are testing, or #FAILED_TO_FIND if free
+    int mid_point;
+    //! How many of the compressors are still to reply
+    int n_outstanding;
+    //! \brief The worst reply so far
+    //! \details ::SUCCESSFUL_COMPRESSION only while every reply was a success
+    compressor_states state;
+    //! The total number of entries in the compressed partitions
+    uint32_t n_entries;
+    //! The number of compressed partitions received
+    int n_tables;
+    //! The latest compressor_path_t of the partitions received
+    uint32_t compressor_path;
+    //! The compressed partitions received
+    table_t *tables[MAX_PROCESSORS];
+} partitioned_run_t;
+
 //============================================================================
 // global params
 
@@ -89,6 +110,9 @@ available_sdram_blocks *restrict usable_sdram_regions;
 //! Best midpoint that record a success
 int best_success = FAILED_TO_FIND;
 
+//! The compressor_path_t of the algorithm that made the best table
+uint32_t best_compressor_path = 0;
+
 //! Lowest midpoint that record failure
 int lowest_failure;
 
@@ -114,6 +138,9 @@ comms_sdram_t *restrict comms_sdram;
 //! Record if the last action was to reduce cores due to malloc
 bool just_reduced_cores_due_to_malloc = false;
 
+//! The mid-points currently shared by several compressors
+partitioned_run_t partitioned_runs[MAX_PARTITIONED_RUNS];
+
 //============================================================================
 
 //! \brief Load the best routing table to the router.
@@ -132,24 +159,9 @@ static inline bool load_routing_table_into_router(void) {
     // application ID we also need to include it as the most significant
     // byte in the route (see `sark_hw.c`).
     log_debug("loading %d entries into router", last_compressed_table->size);
-    for (uint32_t entry_id = 0; entry_id < last_compressed_table->size;
-            entry_id++) {
-        entry_t entry = last_compressed_table->entries[entry_id];
-        uint32_t route = entry.route | (app_id << ROUTE_APP_ID_BIT_SHIFT);
-        uint success = rtr_mc_set(
-                start_entry + entry_id,
-                entry.key_mask.key, entry.key_mask.mask, route);
-
-        // chekc that the entry was set
-        if (success == RTR_MC_FAILED) {
-            log_error("failed to set a router table entry at index %d",
-                    start_entry + entry_id);
-            return false;
-        }
-    }
-
-    // Indicate we were able to allocate routing table entries.
-    return true;
+    return router_loader_load(
+            last_compressed_table->entries, last_compressed_table->size,
+            app_id, start_entry);
 }
 
 //! \brief Send a message forcing the processor to stop its compression
@@ -171,6 +183,8 @@ void send_prepare_message(int processor_id) {
     log_debug("sending prepare to processor %d", processor_id);
     comms_sdram[processor_id].sorter_instruction = PREPARE;
     comms_sdram[processor_id].mid_point = FAILED_TO_FIND;
+    comms_sdram[processor_id].n_partitions = 1;
+    comms_sdram[processor_id].partition = 0;
 }
 
 //! \brief Set up the search bitfields.
@@ -195,14 +209,44 @@ static inline bool set_up_tested_mid_points(void) {
     return true;
 }
 
+//! \brief Work out how much SDRAM a compressor may keep compressed blocks of
+//!     the key space in between runs
+//! \details These come from the same heap as the tables. What is left once
+//!     every compressor could have a table as big as this one is shared
+//!     between them, so the caches do not take the memory the tables of
+//!     later midpoints need.
+//! \param[in] table_size: Number of entries in the table just made
+//! \return The bytes the compressor may keep
+static inline uint32_t cube_cache_budget(uint32_t table_size) {
+    uint32_t n_compressors = 0;
+    for (int p_id = 0; p_id < MAX_PROCESSORS; p_id++) {
+        if ((comms_sdram[p_id].sorter_instruction != NOT_COMPRESSOR) &&
+                (comms_sdram[p_id].sorter_instruction != DO_NOT_USE)) {
+            n_compressors++;
+        }
+    }
+    if (n_compressors == 0) {
+        return 0;
+    }
+    uint32_t reserved = n_compressors * table_size * sizeof(entry_t);
+    uint32_t available = malloc_extras_max_available_block_size();
+    if (available <= reserved) {
+        return 0;
+    }
+    return (available - reserved) / n_compressors;
+}
+
 //! \brief Store the addresses for freeing when response code is sent.
 //! \param[in] processor_id: The compressor processor ID
 //! \param[in] mid_point: The point in the bitfields to work from.
 //! \param[in] table_size: Number of entries that the uncompressed routing
 //!    tables need to hold.
+//! \param[in] stream_tables: Whether the compressor is to make the table an
+//!    original entry at a time, merging as it goes
 //! \return True if stored
 static inline bool pass_instructions_to_compressor(
-    uint32_t processor_id, uint32_t mid_point, uint32_t table_size) {
+    uint32_t processor_id, uint32_t mid_point, uint32_t table_size,
+    bool stream_tables) {
 
     bool success = routing_tables_utils_malloc(
             comms_sdram[processor_id].routing_tables, table_size);
@@ -214,6 +258,9 @@ static inline bool pass_instructions_to_compressor(
 
     // set the midpoint for the given compressor processor.
     comms_sdram[processor_id].mid_point = mid_point;
+    comms_sdram[processor_id].stream_tables = stream_tables;
+    comms_sdram[processor_id].cube_cache_bytes =
+            cube_cache_budget(table_size);
 
     if (comms_sdram[processor_id].mid_point == 0){
         // Info stuff but local sorted_bit_fields as compressor not set yet
@@ -233,10 +280,36 @@ static inline bool pass_instructions_to_compressor(
     return true;
 }
 
+//! \brief Set off a compressor processor on a mid-point whose table there is
+//!     not the memory for whole
+//! \details The compressor makes the table an original entry at a time,
+//!     merging the entries of each as it goes, so the table only needs to
+//!     hold what is left of them. Working out how many that is takes as long
+//!     as making them, so this is only done when needed.
+//! \param[in] processor_id: The compressor processor ID
+//! \param[in] mid_point: The point in the bitfields to work from.
+//! \return True if the compressor was set off
+static inline bool pass_streamed_instructions_to_compressor(
+        uint32_t processor_id, uint32_t mid_point) {
+    if (!bit_field_table_generator_stream_start(
+            mid_point, &uncompressed_router_table->uncompressed_table,
+            sorted_bit_fields)) {
+        return false;
+    }
+    uint32_t table_size = bit_field_table_generator_streamed_size(
+            mid_point, &uncompressed_router_table->uncompressed_table,
+            sorted_bit_fields);
+    bit_field_table_generator_stream_end();
+    return pass_instructions_to_compressor(
+            processor_id, mid_point, table_size, true);
+}
+
 //! \brief Build tables and tries to set off a compressor processor based off
 //!     a mid-point.
-//! \details If there is a problem will set reset the mid_point as untested and
-//!     set this and all unused compressors to ::DO_NOT_USE state.
+//! \details If there is not the memory for the whole table, the compressor
+//!     is asked to make it an original entry at a time instead. If there is
+//!     still a problem will set reset the mid_point as untested and set this
+//!     and all unused compressors to ::DO_NOT_USE state.
 //! \param[in] mid_point: The mid-point to start at
 //! \param[in] processor_id: The processor to run the compression on
 static inline void malloc_tables_and_set_off_bit_compressor(
@@ -252,7 +325,11 @@ static inline void malloc_tables_and_set_off_bit_compressor(
     // if successful, try setting off the bitfield compression
     comms_sdram[processor_id].sorted_bit_fields = sorted_bit_fields;
     bool success = pass_instructions_to_compressor(
-            processor_id, mid_point, table_size);
+            processor_id, mid_point, table_size, false);
+    if (!success) {
+        success = pass_streamed_instructions_to_compressor(
+                processor_id, mid_point);
+    }
 
     if (!success) {
         // OK, lets turn this and all ready processors off to save space.
@@ -346,18 +423,25 @@ static inline void set_n_merged_filters(void) {
     }
 }
 
-//! \brief Locate the next valid midpoint to test
-//! \return The midpoint, or #FAILED_TO_FIND if no midpoints left
-static inline int locate_next_mid_point(void) {
-    if (sorted_bit_fields->n_bit_fields == 0) {
-        return FAILED_TO_FIND;
+//! \brief Locate the next valid midpoints to test, one for each processor
+//!     that is free
+//! \details The midpoints split the largest untested block evenly, so that
+//!     with k processors each round of results narrows the search by a
+//!     factor of k + 1 rather than 2.
+//! \param[out] mid_points: Where to put the midpoints, highest first
+//! \param[in] n_wanted: The most midpoints wanted
+//! \return The number of midpoints found; 0 if no midpoints left
+static inline int locate_next_mid_points(int *mid_points, int n_wanted) {
+    if ((sorted_bit_fields->n_bit_fields == 0) || (n_wanted < 1)) {
+        return 0;
     }
 
     // if not tested yet / reset test all
     if (!bit_field_test(tested_mid_points, sorted_bit_fields->n_bit_fields)) {
         log_info("Retrying all which is mid_point %d",
                 sorted_bit_fields->n_bit_fields);
-        return sorted_bit_fields->n_bit_fields;
+        mid_points[0] = sorted_bit_fields->n_bit_fields;
+        return 1;
     }
 
     // need to find a midpoint
@@ -413,12 +497,17 @@ static inline int locate_next_mid_point(void) {
         }
     }
 
-    // use the best less half (shifted) of the best length
-    int new_mid_point = best_end - (best_length >> 1);
-    log_debug("returning mid point %d", new_mid_point);
+    if (best_length == 0) {
+        return 0;
+    }
 
-    // set the mid point to be tested. (safe as we de-set if we fail later on)
-    if (new_mid_point >= 0) {
+    // split the block into n + 1 even parts; with a single midpoint this is
+    // the best less half (shifted) of the best length
+    int n_mid_points = (n_wanted < best_length) ? n_wanted : best_length;
+    int before_start = best_end - best_length;
+    for (int i = 0; i < n_mid_points; i++) {
+        int new_mid_point = before_start +
+                ((n_mid_points - i) * (best_length + 1)) / (n_mid_points + 1);
         log_debug("setting new mid point %d", new_mid_point);
 
         // just a safety check, as this has caught us before.
@@ -426,9 +515,19 @@ static inline int locate_next_mid_point(void) {
             log_info("HOW THE HELL DID YOU GET HERE!");
             malloc_extras_terminate(EXIT_SWERR);
         }
+        mid_points[i] = new_mid_point;
     }
+    return n_mid_points;
+}
 
-    return new_mid_point;
+//! \brief Locate the next valid midpoint to test
+//! \return The midpoint, or #FAILED_TO_FIND if no midpoints left
+static inline int locate_next_mid_point(void) {
+    int mid_point;
+    if (locate_next_mid_points(&mid_point, 1) == 0) {
+        return FAILED_TO_FIND;
+    }
+    return mid_point;
 }
 
 //! \brief Clean up when we've found a good compression
@@ -449,6 +548,15 @@ static inline void handle_best_cleanup(void) {
     uint processor_id = spin1_get_core_id();
     sark_virtual_processor_info[processor_id].user2 = best_success;
 
+    // The SDRAM blocks were read from user3 at the start, so it is free for
+    // the host to read the load time from as provenance
+    sark_virtual_processor_info[processor_id].user3 =
+            router_loader_load_time_us;
+
+    // Likewise user0, which was only read at the start, gives the algorithm
+    // that made the table loaded
+    sark_virtual_processor_info[processor_id].user0 = best_compressor_path;
+
     // Safety to break out of loop in check_buffer_queue as terminate wont
     // stop this interrupt
     terminated = true;
@@ -547,6 +655,119 @@ int find_compressor_processor_and_set_tracker(int midpoint) {
     return processor_id;
 }
 
+//! \brief Count the processors that are free to be given a mid-point
+//! \return The number of processors that are prepared or still to be
+static inline int count_unused_processors(void) {
+    int available = 0;
+    for (int processor_id = 0; processor_id < MAX_PROCESSORS; processor_id++) {
+        switch (comms_sdram[processor_id].sorter_instruction) {
+        case TO_BE_PREPARED:
+            available++;
+            break;
+        case PREPARE:
+            if (comms_sdram[processor_id].compressor_state == PREPARED) {
+                available++;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return available;
+}
+
+//! \brief Check if a processor is ready to run a compression.
+//! \details May result in preparing the processor in the process.
+//! \param[in] processor_id: The ID of the processor to check
+//! \return Whether the processor can be given a mid-point
+static inline bool processor_ready(int processor_id) {
+    switch (comms_sdram[processor_id].sorter_instruction) {
+    case PREPARE:
+        return comms_sdram[processor_id].compressor_state == PREPARED;
+    case TO_BE_PREPARED:
+        return prepare_processor_first_time(processor_id);
+    default:
+        return false;
+    }
+}
+
+//! \brief Find the partitioned run of a mid-point
+//! \param[in] mid_point: The mid-point to look for, or #FAILED_TO_FIND for
+//!     a free run
+//! \return The run, or `NULL` if there is none
+static inline partitioned_run_t *find_partitioned_run(int mid_point) {
+    for (int r = 0; r < MAX_PARTITIONED_RUNS; r++) {
+        if (partitioned_runs[r].mid_point == mid_point) {
+            return &partitioned_runs[r];
+        }
+    }
+    return NULL;
+}
+
+//! \brief Build tables and set off several compressor processors sharing a
+//!     mid-point, each minimising one partition of the table.
+//! \details Uses as many of the wanted processors as are ready and can get
+//!     memory for a table. A single processor is given the whole table.
+//! \param[in] mid_point: The mid-point to start at
+//! \param[in] n_wanted: The number of processors to share the table over
+//! \param[in] table_size: Number of entries that the uncompressed routing
+//!    tables need to hold.
+//! \return The number of processors set off; 0 if none could be
+static inline int malloc_tables_and_set_off_partitioned_compressors(
+        int mid_point, int n_wanted, uint32_t table_size) {
+    partitioned_run_t *run = find_partitioned_run(FAILED_TO_FIND);
+    if (run == NULL || n_wanted > MAX_PROCESSORS) {
+        n_wanted = 1;
+    }
+
+    // Claim the processors; each builds the whole table before keeping its
+    // partition, so each needs room for all of it
+    int processor_ids[MAX_PROCESSORS];
+    int n_partitions = 0;
+    for (int processor_id = 0;
+            (processor_id < MAX_PROCESSORS) && (n_partitions < n_wanted);
+            processor_id++) {
+        if (!processor_ready(processor_id)) {
+            continue;
+        }
+        routing_tables_utils_free_all(
+                comms_sdram[processor_id].routing_tables);
+        if (!routing_tables_utils_malloc(
+                comms_sdram[processor_id].routing_tables, table_size)) {
+            log_info("failed to create tables for partition %d of midpoint "
+                    "%d", n_partitions, mid_point);
+            break;
+        }
+        processor_ids[n_partitions++] = processor_id;
+    }
+    if (n_partitions == 0) {
+        return 0;
+    }
+
+    if (n_partitions > 1) {
+        run->mid_point = mid_point;
+        run->n_outstanding = n_partitions;
+        run->state = SUCCESSFUL_COMPRESSION;
+        run->n_entries = 0;
+        run->compressor_path = 0;
+        run->n_tables = 0;
+    }
+    bit_field_set(tested_mid_points, mid_point);
+    for (int p = 0; p < n_partitions; p++) {
+        int processor_id = processor_ids[p];
+        comms_sdram[processor_id].mid_point = mid_point;
+        comms_sdram[processor_id].n_partitions = n_partitions;
+        comms_sdram[processor_id].partition = p;
+        comms_sdram[processor_id].stream_tables = false;
+        comms_sdram[processor_id].sorted_bit_fields = sorted_bit_fields;
+        log_info("using processor %d with %d entries for %d bitfields "
+                "partition %d of %d", processor_id, table_size, mid_point,
+                p, n_partitions);
+        comms_sdram[processor_id].sorter_instruction = RUN;
+    }
+    return n_partitions;
+}
+
 //! \brief Set up the compression attempt for the no bitfield version.
 //! \return Whether setting off the compression attempt was successful.
 bool setup_no_bitfields_attempt(void) {
@@ -556,6 +777,19 @@ bool setup_no_bitfields_attempt(void) {
         return true;
     }
 
+    // With no bitfields this is the only table there will be, so share it
+    // between all the compressor processors
+    if (sorted_bit_fields->n_bit_fields == 0) {
+        int n_partitions = malloc_tables_and_set_off_partitioned_compressors(
+                NO_BIT_FIELDS, count_unused_processors(),
+                uncompressed_router_table->uncompressed_table.size);
+        if (n_partitions == 0) {
+            log_error("No processor available for no bitfield attempt");
+            malloc_extras_terminate(RTE_SWERR);
+        }
+        return true;
+    }
+
     int processor_id =
             find_compressor_processor_and_set_tracker(NO_BIT_FIELDS);
     if (processor_id == FAILED_TO_FIND) {
@@ -567,7 +801,7 @@ bool setup_no_bitfields_attempt(void) {
             processor_id);
 
     pass_instructions_to_compressor(processor_id, NO_BIT_FIELDS,
-            uncompressed_router_table->uncompressed_table.size);
+            uncompressed_router_table->uncompressed_table.size, false);
     return true;
 }
 
@@ -675,10 +909,13 @@ void carry_on_binary_search(void) {
     }
     log_debug("start carry_on_binary_search");
 
-    int mid_point = locate_next_mid_point();
-    log_debug("available with midpoint %d", mid_point);
+    // Give every free processor a midpoint at once
+    int mid_points[MAX_PROCESSORS];
+    int n_mid_points = locate_next_mid_points(
+            mid_points, count_unused_processors());
+    log_debug("available with %d midpoints", n_mid_points);
 
-    if (mid_point == FAILED_TO_FIND) {
+    if (n_mid_points == 0) {
         // OK, lets turn all ready processors off as done.
         for (int p_id = 0; p_id < MAX_PROCESSORS; p_id++) {
             if (comms_sdram[p_id].sorter_instruction == PREPARE) {
@@ -693,10 +930,17 @@ void carry_on_binary_search(void) {
         return;
     }
 
-    int processor_id = find_compressor_processor_and_set_tracker(mid_point);
-    log_debug("start create at time step: %u", time_steps);
-    malloc_tables_and_set_off_bit_compressor(mid_point, processor_id);
-    log_debug("end create at time step: %u", time_steps);
+    for (int i = 0; i < n_mid_points; i++) {
+        int processor_id =
+                find_compressor_processor_and_set_tracker(mid_points[i]);
+        if (processor_id == FAILED_TO_FIND) {
+            // Failed to prepare; the rest are picked up next time round
+            break;
+        }
+        log_debug("start create at time step: %u", time_steps);
+        malloc_tables_and_set_off_bit_compressor(mid_points[i], processor_id);
+        log_debug("end create at time step: %u", time_steps);
+    }
 }
 
 //! \brief Timer interrupt for controlling time taken to try to compress table
@@ -718,25 +962,24 @@ void timer_callback(uint unused0, uint unused1) {
 #endif
 }
 
-//! \brief Handle the fact that a midpoint was successful.
+//! \brief Record a successful midpoint.
 //! \param[in] mid_point: The mid-point that succeeded.
-//! \param[in] processor_id: The compressor processor ID
-void process_success(int mid_point, int processor_id) {
+//! \param[in] table: The compressed table, or `NULL` if a better midpoint
+//!     has already succeeded
+//! \param[in] compressor_path: The algorithm that made the table
+static void record_success(
+        int mid_point, table_t *table, uint32_t compressor_path) {
     // if the mid point is better than seen before, store results for final.
-    if (best_success <= mid_point) {
+    if (table != NULL) {
         best_success = mid_point;
+        best_compressor_path = compressor_path;
 
         // If we have a previous table free it as no longer needed
         if (last_compressed_table != NULL) {
             FREE(last_compressed_table);
         }
-
-        // Get last table and free the rest
-        last_compressed_table = routing_tables_utils_convert(
-            comms_sdram[processor_id].routing_tables);
+        last_compressed_table = table;
         log_debug("n entries is %d", last_compressed_table->size);
-    } else {
-        routing_tables_utils_free_all(comms_sdram[processor_id].routing_tables);
     }
 
     // kill any search below this point, as they all redundant as
@@ -751,6 +994,22 @@ void process_success(int mid_point, int processor_id) {
     log_debug("finished process of successful compression");
 }
 
+//! \brief Handle the fact that a midpoint was successful.
+//! \param[in] mid_point: The mid-point that succeeded.
+//! \param[in] processor_id: The compressor processor ID
+void process_success(int mid_point, int processor_id) {
+    table_t *table = NULL;
+    if (best_success <= mid_point) {
+        // Get last table and free the rest
+        table = routing_tables_utils_convert(
+                comms_sdram[processor_id].routing_tables);
+    } else {
+        routing_tables_utils_free_all(comms_sdram[processor_id].routing_tables);
+    }
+    record_success(
+            mid_point, table, comms_sdram[processor_id].compressor_path);
+}
+
 //! \brief Handle the fact that a midpoint failed due to insufficient memory
 //! \param[in] mid_point: The mid-point that failed
 //! \param[in] processor_id: The compressor processor ID
@@ -813,6 +1072,151 @@ void process_failed(int mid_point, int processor_id) {
     just_reduced_cores_due_to_malloc = false;
 }
 
+//! \brief Put the compressed partitions of a midpoint together as one table
+//! \details Entries of different partitions never match the same key, so
+//!     the partitions can go in any order.
+//! \param[in] run: The run whose partitions are to be joined
+//! \return The joined table, or `NULL` if there was no memory for it
+static table_t *join_partitioned_tables(partitioned_run_t *run) {
+    table_t *table = MALLOC_SDRAM(
+            sizeof(table_t) + run->n_entries * sizeof(entry_t));
+    if (table == NULL) {
+        log_error("failed to allocate memory for a table of %d entries",
+                run->n_entries);
+        return NULL;
+    }
+    table->size = 0;
+    for (int t = 0; t < run->n_tables; t++) {
+        for (uint32_t i = 0; i < run->tables[t]->size; i++) {
+            table->entries[table->size++] = run->tables[t]->entries[i];
+        }
+    }
+    return table;
+}
+
+//! \brief Handle the last reply for a midpoint shared by several compressors
+//! \param[in] run: The run of the midpoint; freed
+//! \param[in] processor_id: The compressor processor ID that replied last
+static void finish_partitioned_run(partitioned_run_t *run, int processor_id) {
+    int mid_point = run->mid_point;
+    compressor_states state = run->state;
+    run->mid_point = FAILED_TO_FIND;
+
+    table_t *table = NULL;
+    if (state == SUCCESSFUL_COMPRESSION) {
+        if (run->n_entries > rtr_alloc_max()) {
+            log_info("partitions of mid point %d total %d entries, which is "
+                    "too many", mid_point, run->n_entries);
+            state = FAILED_TO_COMPRESS;
+        } else if (best_success <= mid_point) {
+            table = join_partitioned_tables(run);
+            if (table == NULL) {
+                state = FAILED_MALLOC;
+            }
+        }
+    }
+    for (int t = 0; t < run->n_tables; t++) {
+        FREE(run->tables[t]);
+    }
+    run->n_tables = 0;
+
+    switch (state) {
+    case SUCCESSFUL_COMPRESSION:
+        log_info("successful from all partitions of mid point %d "
+                "best so far was %d", mid_point, best_success);
+        record_success(mid_point, table, run->compressor_path);
+        break;
+    case FAILED_MALLOC:
+        process_failed_malloc(mid_point, processor_id);
+        break;
+    case FAILED_TO_COMPRESS:
+    case RAN_OUT_OF_TIME:
+        process_failed(mid_point, processor_id);
+        break;
+    default:
+        // Stopped by the sorter so the result is no longer needed
+        break;
+    }
+}
+
+//! \brief Process the response from a compressor sharing a midpoint.
+//! \details The midpoint only succeeds if every partition does, so the
+//!     first failure stops the others.
+//! \param[in] processor_id: The compressor processor ID
+//! \param[in] mid_point: The midpoint the compressor was doing
+//! \param[in] finished_state: The response code
+static void process_partition_response(
+        int processor_id, int mid_point, compressor_states finished_state) {
+    partitioned_run_t *run = find_partitioned_run(mid_point);
+    if (run == NULL) {
+        log_error("no record of partitions for mid point %d from processor "
+                "%d", mid_point, processor_id);
+        malloc_extras_terminate(RTE_SWERR);
+    }
+    log_info("response %d from processor %d doing a partition of mid point "
+            "%d", finished_state, processor_id, mid_point);
+
+    switch (finished_state) {
+    case SUCCESSFUL_COMPRESSION:
+        run->tables[run->n_tables] = routing_tables_utils_convert(
+                comms_sdram[processor_id].routing_tables);
+        run->n_entries += run->tables[run->n_tables]->size;
+        run->n_tables++;
+        if (comms_sdram[processor_id].compressor_path > run->compressor_path) {
+            run->compressor_path = comms_sdram[processor_id].compressor_path;
+        }
+        break;
+
+    case FAILED_MALLOC:
+    case FAILED_TO_COMPRESS:
+    case RAN_OUT_OF_TIME:
+    case FORCED_BY_COMPRESSOR_CONTROL:
+        routing_tables_utils_free_all(comms_sdram[processor_id].routing_tables);
+        // A malloc failure takes precedence, as the midpoint can be retried;
+        // being stopped only counts if nothing else went wrong
+        if ((finished_state == FAILED_MALLOC) ||
+                (run->state == SUCCESSFUL_COMPRESSION) ||
+                ((run->state == FORCED_BY_COMPRESSOR_CONTROL) &&
+                (finished_state != FORCED_BY_COMPRESSOR_CONTROL))) {
+            run->state = finished_state;
+        }
+        for (int p_id = 0; p_id < MAX_PROCESSORS; p_id++) {
+            if (comms_sdram[p_id].mid_point == mid_point) {
+                send_force_stop_message(p_id);
+            }
+        }
+        break;
+
+    case UNUSED:
+    case PREPARED:
+    case COMPRESSING:
+        // states that shouldn't occur
+        log_error("no idea what to do with finished state %d, "
+                "from processor %d", finished_state, processor_id);
+        malloc_extras_terminate(RTE_SWERR);
+    }
+
+    run->n_outstanding--;
+    if (run->n_outstanding == 0) {
+        finish_partitioned_run(run, processor_id);
+    }
+}
+
+//! \brief Determine if a compressor that ran out of time left a table that
+//!     can be used anyway
+//! \details A partition only has to fit together with the others, which is
+//!     checked once they have all replied.
+//! \param[in] processor_id: The compressor processor ID
+//! \return Whether the table it left can be taken as a success
+static inline bool partial_result_usable(int processor_id) {
+    int n_best_entries = comms_sdram[processor_id].n_best_entries;
+    if (n_best_entries == FAILED_TO_FIND) {
+        return false;
+    }
+    return (comms_sdram[processor_id].n_partitions > 1) ||
+            (n_best_entries <= (int) rtr_alloc_max());
+}
+
 //! \brief Process the response from a compressor's attempt to compress.
 //! \param[in] processor_id: The compressor processor ID
 //! \param[in] finished_state: The response code
@@ -820,12 +1224,27 @@ void process_compressor_response(
         int processor_id, compressor_states finished_state) {
     // locate this responses midpoint
     int mid_point = comms_sdram[processor_id].mid_point;
+    int n_partitions = comms_sdram[processor_id].n_partitions;
     log_debug("received response %d from processor %d doing %d midpoint",
             finished_state, processor_id, mid_point);
 
+    // What was compressed before the time ran out may be good enough
+    if ((finished_state == RAN_OUT_OF_TIME) &&
+            partial_result_usable(processor_id)) {
+        log_info("processor %d ran out of time on mid point %d but left a "
+                "table of %d entries", processor_id, mid_point,
+                comms_sdram[processor_id].n_best_entries);
+        finished_state = SUCCESSFUL_COMPRESSION;
+    }
+
     // free the processor for future processing
     send_prepare_message(processor_id);
 
+    if (n_partitions > 1) {
+        process_partition_response(processor_id, mid_point, finished_state);
+        return;
+    }
+
     // process compressor response based off state.
     switch (finished_state) {
     case SUCCESSFUL_COMPRESSION:
@@ -908,6 +1327,27 @@ void check_compressors(uint unused0, uint unused1) {
     log_info("exiting the interrupt, to allow the binary to finish");
 }
 
+//! \brief Try every mid-point at once, sharing the table of each between
+//!     several compressors.
+//! \param[in] n_partitions: The number of compressors for each mid-point
+static void start_partitioned_search(int n_partitions) {
+    log_info("Trying all %d mid-points with %d processors each",
+            sorted_bit_fields->n_bit_fields - threshold_in_bitfields,
+            n_partitions);
+    for (int mid_point = sorted_bit_fields->n_bit_fields;
+            mid_point > (int) threshold_in_bitfields; mid_point--) {
+        uint32_t table_size = bit_field_table_generator_max_size(
+                mid_point, &uncompressed_router_table->uncompressed_table,
+                sorted_bit_fields);
+        if (malloc_tables_and_set_off_partitioned_compressors(
+                mid_point, n_partitions, table_size) == 0) {
+            // The rest are picked up as processors become free
+            log_info("No processor available for mid-point %d", mid_point);
+            return;
+        }
+    }
+}
+
 //! \brief Start binary search on all compressors dividing the bitfields as
 //!     evenly as possible.
 void start_binary_search(void) {
@@ -928,6 +1368,15 @@ void start_binary_search(void) {
                 threshold_in_bitfields, processor_id);
     }
 
+    // If there are more processors than mid-points to try, the spare ones
+    // would never be used, so share each table between several instead
+    uint32_t n_mid_points =
+            sorted_bit_fields->n_bit_fields - threshold_in_bitfields;
+    if ((n_mid_points > 0) && (available >= 2 * n_mid_points)) {
+        start_partitioned_search(available / n_mid_points);
+        return;
+    }
+
     // create slices and set off each slice.
     uint32_t mid_point = sorted_bit_fields->n_bit_fields;
     while ((available > 0) && (mid_point > threshold_in_bitfields)) {
@@ -1044,12 +1493,22 @@ static void initialise_user_register_tracker(void) {
         comms_sdram[processor_id].compressor_state = UNUSED;
         comms_sdram[processor_id].sorter_instruction = NOT_COMPRESSOR;
         comms_sdram[processor_id].mid_point = FAILED_TO_FIND;
+        comms_sdram[processor_id].n_partitions = 1;
+        comms_sdram[processor_id].partition = 0;
+        comms_sdram[processor_id].n_best_entries = FAILED_TO_FIND;
+        comms_sdram[processor_id].stream_tables = false;
+        comms_sdram[processor_id].cube_cache_bytes = 0;
+        comms_sdram[processor_id].compressor_path = 0;
         comms_sdram[processor_id].routing_tables = NULL;
         comms_sdram[processor_id].uncompressed_router_table =
                 &uncompressed_router_table->uncompressed_table;
         comms_sdram[processor_id].sorted_bit_fields = NULL;
         comms_sdram[processor_id].fake_heap_data = NULL;
     }
+    for (int r = 0; r < MAX_PARTITIONED_RUNS; r++) {
+        partitioned_runs[r].mid_point = FAILED_TO_FIND;
+        partitioned_runs[r].n_tables = 0;
+    }
     usable_sdram_regions = (available_sdram_blocks *) this_vcpu_info->user3;
 
     log_debug("finished setting up register tracker:\n\n"
@@ -65,7 +65,7 @@ from spinn_front_end_common.utilities.helpful_functions import (
 from spinn_front_end_common.utilities.report_functions import (
     EnergyReport, TagsFromMachineReport)
 from spinn_front_end_common.utilities.utility_objs import (
-    ExecutableType, ProvenanceDataItem)
+    CompressedTableCache, ExecutableType, ProvenanceDataItem)
 from spinn_front_end_common.utility_models import (
     CommandSender, CommandSenderMachineVertex,
     DataSpeedUpPacketGatherMachineVertex)
@@ -1549,6 +1549,11 @@ class AbstractSpinnakerBase(ConfigHandler, SimulatorInterface):
             "Mapping", "router_table_compress_as_needed")
         inputs["CompressionAsFarAsPos"] = self._config.getboolean(
             "Mapping", "router_table_compress_as_far_as_possible")
+        compressed_table_cache = self._read_config(
+            "Mapping", "router_table_compression_cache")
+        if compressed_table_cache is not None:
+            inputs["CompressedTableCache"] = CompressedTableCache(
+                compressed_table_cache)
 
         algorithms = list()
 
@@ -1911,6 +1916,9 @@ class AbstractSpinnakerBase(ConfigHandler, SimulatorInterface):
         if prov_item is not None:
             prov_items.extend(prov_item)
         prov_item = executor.get_item("RouterProvenanceItems")
+        if prov_item is not None:
+            prov_items.extend(prov_item)
+        prov_item = executor.get_item("RouterLoadProvenanceItems")
         if prov_item is not None:
             prov_items.extend(prov_item)
         prov_item = executor.get_item("PowerProvenanceItems")
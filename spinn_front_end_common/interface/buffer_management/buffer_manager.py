@@ -14,6 +14,7 @@
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 import logging
+import struct
 import threading
 from concurrent.futures import ThreadPoolExecutor
 from six.moves import xrange
@@ -46,7 +47,8 @@ from spinn_front_end_common.interface.buffer_management.buffer_models \
     import (
         AbstractReceiveBuffersToHost)
 from .recording_utilities import (
-    TRAFFIC_IDENTIFIER, get_last_sequence_number, get_region_pointer)
+    TRAFFIC_IDENTIFIER, decode_recorded_data, get_last_sequence_number,
+    get_region_pointer)
 
 logger = FormatAdapter(logging.getLogger(__name__))
 
@@ -61,6 +63,9 @@ _SDP_MAX_PACKAGE_SIZE = 272
 
 VERIFY = False
 
+#: The reads queued, appended to the acknowledgement of a read request
+_READS_QUEUED = struct.Struct("<I")
+
 
 class BufferManager(object):
     """ Manager of send buffers.
@@ -103,6 +108,12 @@ class BufferManager(object):
         # Buffering out thread pool
         "_buffering_out_thread_pool",
 
+        # The number of read requests submitted but not yet done
+        "_reads_queued",
+
+        # Lock for the number of read requests queued
+        "_reads_queued_lock",
+
         # the extra monitor cores which support faster data extraction
         "_extra_monitor_cores",
 
@@ -181,6 +192,8 @@ class BufferManager(object):
         self._thread_lock_buffer_out = threading.RLock()
         self._thread_lock_buffer_in = threading.RLock()
         self._buffering_out_thread_pool = ThreadPoolExecutor(max_workers=1)
+        self._reads_queued = 0
+        self._reads_queued_lock = threading.Lock()
 
         self._finished = False
         self._listener_port = None
@@ -301,17 +314,24 @@ class BufferManager(object):
                 packet:
             The EIEIO message received
         """
+        with self._reads_queued_lock:
+            reads_queued = self._reads_queued
+            self._reads_queued += 1
         if not self._finished:
-            # Send an ACK message to stop the core sending more messages
+            # Send an ACK message to stop the core sending more messages;
+            # the reads queued ahead of this one let the core tell how long
+            # a read takes when the host is not busy
             ack_message_header = SDPHeader(
                 destination_port=(
                     SDP_PORTS.OUTPUT_BUFFERING_SDP_PORT.value),
                 destination_cpu=packet.p, destination_chip_x=packet.x,
                 destination_chip_y=packet.y,
                 flags=SDPFlag.REPLY_NOT_EXPECTED)
-            ack_message_data = HostDataReadAck(packet.sequence_no)
+            ack_message_data = HostDataReadAck(packet.sequence_no).bytestring
+            ack_message_data += bytes(bytearray(-len(ack_message_data) % 4))
             ack_message = SDPMessage(
-                ack_message_header, ack_message_data.bytestring)
+                ack_message_header,
+                ack_message_data + _READS_QUEUED.pack(reads_queued))
             self._transceiver.send_sdp_message(ack_message)
         self._buffering_out_thread_pool.submit(
             self._process_buffered_in_packet, packet)
@@ -716,7 +736,8 @@ class BufferManager(object):
             the placement to get the data from
         :param int recording_region_id: desired recording data region
         :return: an array contained all the data received during the
-            simulation, and a flag indicating if any data was missing
+            simulation, and a flag indicating if any data was missing;
+            records that were encoded on the machine are decoded
         :rtype: tuple(bytearray, bool)
         """
         # Ensure that any transfers in progress are complete first
@@ -728,6 +749,14 @@ class BufferManager(object):
             # data flush has been completed - return appropriate data
             (byte_array, missing) = self._received_data.get_region_data(
                 placement.x, placement.y, placement.p, recording_region_id)
+            if self._received_data.is_end_buffering_state_recovered(
+                    placement.x, placement.y, placement.p,
+                    recording_region_id):
+                end_state = self._received_data.get_end_buffering_state(
+                    placement.x, placement.y, placement.p,
+                    recording_region_id)
+                byte_array = decode_recorded_data(
+                    byte_array, end_state.encoding)
             return byte_array, missing
 
     def _retreive_by_placement(self, placement, recording_region_id):
@@ -932,6 +961,9 @@ class BufferManager(object):
                     self._retrieve_and_store_data(packet)
         except Exception:
             logger.warning("problem when handling data", exc_info=True)
+        finally:
+            with self._reads_queued_lock:
+                self._reads_queued -= 1
 
     def _retrieve_and_store_data(self, packet):
         """ Following a SpinnakerRequestReadData packet, the data stored
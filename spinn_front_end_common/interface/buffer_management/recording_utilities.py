@@ -14,10 +14,13 @@
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 import struct
+import numpy
 from spinn_front_end_common.interface.buffer_management.storage_objects\
     import ChannelBufferState
 from spinn_front_end_common.utilities.constants import (
-    SARK_PER_MALLOC_SDRAM_USAGE, SDP_PORTS, BYTES_PER_WORD)
+    SARK_PER_MALLOC_SDRAM_USAGE, SDP_PORTS, BYTES_PER_WORD,
+    RECORDING_ENCODINGS)
+from spinn_front_end_common.utilities.exceptions import SpinnFrontEndException
 
 # The offset of the last sequence number field in bytes
 _LAST_SEQUENCE_NUMBER_OFFSET = BYTES_PER_WORD * 6
@@ -29,6 +32,17 @@ _FIRST_REGION_ADDRESS_OFFSET = BYTES_PER_WORD * 7
 # recording regions sizes are stored.
 _RECORDING_ELEMENTS_BEFORE_REGION_SIZES = 7
 
+# The number of words per region in the recording header: the pointer, the
+# size and the encoding
+_RECORDING_ELEMENTS_PER_REGION = 3
+
+# The words of a record covered by each bitmap of a record encoded with
+# RECORDING_ENCODINGS.ZERO_WORDS
+_ENCODING_GROUP_WORDS = 32
+
+# The index of each bit of a bitmap of an encoded record
+_BIT_INDICES = numpy.arange(_ENCODING_GROUP_WORDS, dtype="uint32")
+
 # The Buffer traffic type
 TRAFFIC_IDENTIFIER = "BufferTraffic"
 
@@ -44,7 +58,8 @@ def get_recording_header_size(n_recorded_regions):
     """
     # See recording.h/recording_initialise for data included in the header
     return (_RECORDING_ELEMENTS_BEFORE_REGION_SIZES +
-            (2 * n_recorded_regions)) * BYTES_PER_WORD
+            (_RECORDING_ELEMENTS_PER_REGION * n_recorded_regions)) * \
+        BYTES_PER_WORD
 
 
 def get_recording_data_constant_size(n_recorded_regions):
@@ -63,7 +78,7 @@ def get_recording_data_constant_size(n_recorded_regions):
 def get_recording_header_array(
         recorded_region_sizes,
         time_between_triggers=0, buffer_size_before_request=None, ip_tags=None,
-        buffering_tag=None):
+        buffering_tag=None, encodings=None):
     """ Get data to be written for the recording header
 
     :param list(int) recorded_region_sizes:
@@ -77,6 +92,10 @@ def get_recording_header_array(
         A list of IP tags to extract the buffer tag from
     :param ~spinn_machine.tags.AbstractTag buffering_tag:
         The tag to use for buffering requests
+    :param list(RECORDING_ENCODINGS) encodings:
+        How the records of each region are to be encoded, or None to store
+        them as they are recorded. Use :py:func:`decode_recorded_data` to
+        decode the data read back.
     :return: An array of values to be written as the header
     :rtype: list(int)
     """
@@ -125,9 +144,66 @@ def get_recording_header_array(
     # The size of the regions
     data.extend(recorded_region_sizes)
 
+    # The encoding of the regions
+    if encodings is None:
+        data.extend(
+            RECORDING_ENCODINGS.NONE.value for _ in recorded_region_sizes)
+    else:
+        data.extend(encoding.value for encoding in encodings)
+
     return data
 
 
+def decode_recorded_data(data, encoding):
+    """ Decode the data read back from a recording region
+
+    :param data: The data read back from the region
+    :type data: bytes or bytearray or memoryview
+    :param int encoding:
+        How the records were encoded; see :py:class:`RECORDING_ENCODINGS`
+    :return: The records as they were recorded, one after the other
+    :rtype: bytearray
+    :raises SpinnFrontEndException:
+        If the encoding is not known, or the data is not a whole number of
+        encoded records
+    """
+    if encoding == RECORDING_ENCODINGS.NONE.value:
+        return data
+    if encoding != RECORDING_ENCODINGS.ZERO_WORDS.value:
+        raise SpinnFrontEndException(
+            "Unknown recording encoding {}".format(encoding))
+
+    if len(data) % BYTES_PER_WORD:
+        raise SpinnFrontEndException(
+            "Recorded data ends part way through a record")
+    words = numpy.frombuffer(data, dtype="<u4")
+    n_encoded = len(words)
+    decoded = bytearray()
+    index = 0
+    while index < n_encoded:
+        size = int(words[index])
+        index += 1
+        n_words = (size + BYTES_PER_WORD - 1) // BYTES_PER_WORD
+        record = numpy.zeros(n_words, dtype="<u4")
+        for first in range(0, n_words, _ENCODING_GROUP_WORDS):
+            if index >= n_encoded:
+                raise SpinnFrontEndException(
+                    "Recorded data ends part way through a record")
+            bitmap = words[index]
+            index += 1
+            present = numpy.flatnonzero((bitmap >> _BIT_INDICES) & 1)
+            if len(present) and first + present[-1] >= n_words:
+                raise SpinnFrontEndException(
+                    "Recorded data holds a damaged record")
+            if index + len(present) > n_encoded:
+                raise SpinnFrontEndException(
+                    "Recorded data ends part way through a record")
+            record[first + present] = words[index:index + len(present)]
+            index += len(present)
+        decoded.extend(record.tobytes()[:size])
+    return decoded
+
+
 def get_last_sequence_number(placement, transceiver, recording_data_address):
     """ Read the last sequence number from the data
 
@@ -17,7 +17,7 @@ import struct
 from spinn_front_end_common.utilities.constants import (
     BUFFERING_OPERATIONS, BYTES_PER_WORD)
 
-_CHANNEL_BUFFER_PATTERN = struct.Struct("<IIIIIBBBx")
+_CHANNEL_BUFFER_PATTERN = struct.Struct("<IIIIIBBBB")
 
 
 class ChannelBufferState(object):
@@ -51,6 +51,9 @@ class ChannelBufferState(object):
         #: Last operation performed on the buffer - read or write (8 bits)
         "_last_buffer_operation",
 
+        #: How the records in the buffer are encoded (8 bits)
+        "_encoding",
+
         #: bool check for if its extracted data from machine
         "_update_completed",
     ]
@@ -58,13 +61,13 @@ class ChannelBufferState(object):
     #: 4 bytes for _start_address, 4 for _current_write,
     #: 4 for current_dma_write,
     #: 4 for _current_read, 4 for _end_address, 1 for _region_id,
-    #: 1 for _missing_info, 1 for _last_buffer_operation
+    #: 1 for _missing_info, 1 for _last_buffer_operation, 1 for _encoding
     ChannelBufferStateSize = 6 * BYTES_PER_WORD
 
     def __init__(
             self, start_address, current_write, current_dma_write,
             current_read, end_address, region_id, missing_info,
-            last_buffer_operation):
+            last_buffer_operation, encoding=0):
         """
         :param int start_address: start buffering area memory address (32 bits)
         :param int current_write: address where data was last written (32 bits)
@@ -76,6 +79,9 @@ class ChannelBufferState(object):
             True if the region overflowed during the simulation (8 bits)
         :param int last_buffer_operation:
             Last operation performed on the buffer - read or write (8 bits)
+        :param int encoding:
+            How the records in the buffer are encoded (8 bits); see
+            :py:class:`~.RECORDING_ENCODINGS`
         """
         # pylint: disable=too-many-arguments
         self._start_address = start_address
@@ -86,6 +92,7 @@ class ChannelBufferState(object):
         self._region_id = region_id
         self._missing_info = missing_info
         self._last_buffer_operation = last_buffer_operation
+        self._encoding = encoding
         self._update_completed = False
 
     @property
@@ -124,6 +131,13 @@ class ChannelBufferState(object):
         """
         return self._last_buffer_operation
 
+    @property
+    def encoding(self):
+        """ How the records in the buffer are encoded; see\
+            :py:class:`~.RECORDING_ENCODINGS`
+        """
+        return self._encoding
+
     @property
     def is_state_updated(self):
         """ bool check for if its extracted data from machine """
@@ -146,15 +160,16 @@ class ChannelBufferState(object):
         :rtype: ChannelBufferState
         """
         (start_address, current_write, current_dma_write, current_read,
-         end_address, region_id, missing_info, last_buffer_operation) = \
-            _CHANNEL_BUFFER_PATTERN.unpack_from(data)
+         end_address, region_id, missing_info, last_buffer_operation,
+         encoding) = _CHANNEL_BUFFER_PATTERN.unpack_from(data)
         if last_buffer_operation == 0:
             last_buffer_operation = BUFFERING_OPERATIONS.BUFFER_READ.value
         else:
             last_buffer_operation = BUFFERING_OPERATIONS.BUFFER_WRITE.value
         buffer_state = ChannelBufferState(
             start_address, current_write, current_dma_write, current_read,
-            end_address, region_id, missing_info, last_buffer_operation)
+            end_address, region_id, missing_info, last_buffer_operation,
+            encoding)
         return buffer_state
 
     @classmethod
@@ -15,10 +15,12 @@
 
 from __future__ import division
 import functools
+import hashlib
 import math
 import os
 import struct
 from collections import defaultdict
+from multiprocessing import Pool, cpu_count
 from spinn_utilities.default_ordered_dict import DefaultOrderedDict
 from spinn_utilities.find_max_success import find_max_success
 from spinn_utilities.progress_bar import ProgressBar
@@ -39,6 +41,9 @@ from spinn_front_end_common.abstract_models.\
         AbstractSupportsBitFieldRoutingCompression)
 from spinn_front_end_common.utilities.constants import (
     BYTES_PER_WORD)
+from spinn_front_end_common.utilities.utility_objs import CompressedTableCache
+from .native_bit_field_compressor import (
+    NativeBitFieldCompressor, is_defaultable, source_of_defaultable_route)
 
 
 class _BitFieldData(object):
@@ -67,11 +72,49 @@ class _BitFieldData(object):
         return cls.N_ELEMENTS * BYTES_PER_WORD
 
 
+def _compress_chip_natively(job):
+    """ Find the most bit fields of a chip that can be merged into its \
+        routing table, using the host library. Run in the worker processes \
+        of the pool, so only takes and returns plain data.
+
+    :param tuple job: the uncompressed entries as (key, mask, route,
+        source), the bit fields as (key, n_atoms, processor ID, words) best
+        first, the target length and the time limit per attempt in
+        milliseconds (0 for none)
+    :return: the best table, as (key, mask, route, source), and how many of
+        the bit fields it merges in, or `None` if even the table without bit
+        fields does not compress
+    :rtype: tuple(list(tuple(int,int,int,int)),int) or None
+    """
+    entries, bit_fields, target_length, time_limit_ms = job
+    compressor = NativeBitFieldCompressor(entries, bit_fields)
+    table = compressor.run(0, target_length, time_limit_ms)
+    if table is None:
+        return None
+
+    # Each success of the search is at a higher midpoint than the last
+    best = [table, 0]
+
+    def check(mid_point):
+        table = compressor.run(mid_point, target_length, time_limit_ms)
+        if table is None:
+            return False
+        best[:] = [table, mid_point]
+        return True
+
+    find_max_success(len(bit_fields), check)
+    return tuple(best)
+
+
 class HostBasedBitFieldRouterCompressor(object):
     """ Host-based fancy router compressor using the bitfield filters of the \
         cores. Compresses bitfields and router table entries together as \
         much as feasible.
 
+    If the host library of the compressor has been built (by the compressor
+    benchmark Makefile), the chips are compressed by it in a pool of worker
+    processes; otherwise they are compressed one at a time in Python.
+
     :param ~pacman.model.routing_tables.MulticastRoutingTables router_tables:
         routing tables (uncompressed)
     :param ~spinn_machine.Machine machine: SpiNNMachine instance
@@ -132,6 +175,12 @@ class HostBasedBitFieldRouterCompressor(object):
     # for router report
     _LOWER_16_BITS = 0xFFFF
 
+    # what to say if a table does not compress even without bitfields
+    _CANNOT_COMPRESS_MESSAGE = (
+        "host bitfield router compressor can't compress the "
+        "uncompressed routing tables, regardless of bitfield merging. "
+        "System is fundamentally flawed here")
+
     # rob paul to pay sam threshold starting point at 1ms time step
     _N_PACKETS_PER_SECOND = 100000
 
@@ -153,7 +202,7 @@ class HostBasedBitFieldRouterCompressor(object):
             default_report_folder, produce_report,
             use_timer_cut_off, machine_graph, routing_infos,
             machine_time_step, time_scale_factor, target_length=None,
-            time_to_try_for_each_iteration=None):
+            time_to_try_for_each_iteration=None, compressed_table_cache=None):
         """
         :param ~.MulticastRoutingTables router_tables:
         :param ~.Machine machine:
@@ -168,6 +217,9 @@ class HostBasedBitFieldRouterCompressor(object):
         :param int time_scale_factor:
         :param int target_length:
         :param int time_to_try_for_each_iteration:
+        :param compressed_table_cache:
+            where tables compressed before are kept, if anywhere
+        :type compressed_table_cache: CompressedTableCache or None
         :rtype: ~.MulticastRoutingTables
         """
 
@@ -202,13 +254,14 @@ class HostBasedBitFieldRouterCompressor(object):
                 transceiver, bit_field_sdram_base_addresses)
 
         # start the routing table choice conversion
-        for router_table in progress.over(router_tables.routing_tables):
-            self.start_compression_selection_process(
-                router_table, produce_report, report_folder_path,
-                bit_field_sdram_base_addresses, transceiver, machine_graph,
-                placements, machine, target_length,
-                time_to_try_for_each_iteration, use_timer_cut_off,
-                compressed_pacman_router_tables, key_atom_map)
+        self.compress_chips(
+            router_tables.routing_tables, produce_report, report_folder_path,
+            bit_field_sdram_base_addresses, transceiver, machine_graph,
+            placements, machine, target_length,
+            time_to_try_for_each_iteration, use_timer_cut_off,
+            compressed_pacman_router_tables, key_atom_map, progress,
+            compressed_table_cache)
+        progress.end()
         # return compressed tables
         return compressed_pacman_router_tables
 
@@ -319,23 +372,399 @@ class HostBasedBitFieldRouterCompressor(object):
             should be allowed to handle per time step
         """
 
-        # iterate through bitfields on this chip and convert to router
-        # table
-        bit_field_chip_base_addresses = bit_field_sdram_base_addresses[
-            (router_table.x, router_table.y)]
+        self.compress_chips(
+            [router_table], produce_report, report_folder_path,
+            bit_field_sdram_base_addresses, transceiver, machine_graph,
+            placements, machine, target_length,
+            time_to_try_for_each_iteration, use_timer_cut_off,
+            compressed_pacman_router_tables, key_atom_map)
 
-        # read in bitfields.
-        bit_fields_by_processor, sorted_bit_fields = self._read_in_bit_fields(
-            transceiver, router_table.x, router_table.y,
-            bit_field_chip_base_addresses, machine_graph,
-            placements, machine.get_chip_at(
-                router_table.x, router_table.y).n_processors)
+    def compress_chips(
+            self, router_tables, produce_report, report_folder_path,
+            bit_field_sdram_base_addresses, transceiver, machine_graph,
+            placements, machine, target_length,
+            time_to_try_for_each_iteration, use_timer_cut_off,
+            compressed_pacman_router_tables, key_atom_map, progress=None,
+            compressed_table_cache=None):
+        """ Does on host compression of several chips, at the same time \
+            if the host library of the compressor is available. Can be used \
+            as a public method for other compressors.
+
+        Chips whose compressed tables are in the cache, if given, are not
+        compressed again, and those that are compressed are added to it.
 
-        # execute binary search
+        :param iterable(~.UnCompressedMulticastRoutingTable) router_tables:
+            the routing tables to compress
+        :param bool produce_report: whether the report should be generated
+        :param str report_folder_path: the report folder base address
+        :param dict(tuple(int,int),int) bit_field_sdram_base_addresses:
+            the SDRAM addresses for bitfields used in the chips.
+        :param ~spinnman.transceiver.Transceiver transceiver:
+            spinnMan instance
+        :param ~pacman.model.graphs.machine.MachineGraph machine_graph:
+            machine graph
+        :param ~pacman.model.placements.Placements placements: placements
+        :param ~spinn_machine.Machine machine: SpiNNMan instance
+        :param int target_length: length of router compressor to get to
+        :param int time_to_try_for_each_iteration:
+            time in seconds to run each compression attempt for
+        :param bool use_timer_cut_off:
+            whether the timer cut off is to be used
+        :param ~pacman.model.routing_tables.MulticastRoutingTables \
+                compressed_pacman_router_tables:
+            a data holder for compressed tables
+        :param dict(int,int) key_atom_map: key to atoms map
+        :param progress: updated as each chip is finished, if given
+        :type progress: ~spinn_utilities.progress_bar.ProgressBar or None
+        :param compressed_table_cache:
+            where tables compressed before are kept, if anywhere
+        :type compressed_table_cache: CompressedTableCache or None
+        """
+        chips = self._read_chips(
+            router_tables, bit_field_sdram_base_addresses, transceiver,
+            machine_graph, placements, machine)
+
+        keys = None
+        if compressed_table_cache is not None:
+            chips, keys = self._finish_cached_chips(
+                chips, compressed_table_cache, self._cache_algorithm(),
+                target_length, key_atom_map, produce_report,
+                report_folder_path, transceiver,
+                compressed_pacman_router_tables, progress)
+
+        if NativeBitFieldCompressor.is_available():
+            results = self._compress_natively(
+                chips, target_length, time_to_try_for_each_iteration,
+                use_timer_cut_off, key_atom_map)
+        else:
+            results = (
+                self._compress_in_python(
+                    router_table, sorted_bit_fields, target_length,
+                    time_to_try_for_each_iteration, use_timer_cut_off,
+                    key_atom_map)
+                for router_table, _, _, sorted_bit_fields in chips)
+
+        for chip, (best_routing_table, best_bit_fields_by_processor) in zip(
+                chips, results):
+            self._best_routing_table = best_routing_table
+            self._best_bit_fields_by_processor = best_bit_fields_by_processor
+            self._finish_chip(
+                produce_report, report_folder_path, transceiver,
+                compressed_pacman_router_tables, *chip)
+            if keys is not None:
+                router_table = chip[0]
+                compressed_table_cache.put(
+                    keys[router_table.x, router_table.y],
+                    ((entry.key, entry.mask, entry.spinnaker_route,
+                      entry.defaultable) for entry in best_routing_table),
+                    self._n_merged(best_bit_fields_by_processor))
+            if progress is not None:
+                progress.update()
+
+    def finish_cached_chips(
+            self, router_tables, produce_report, report_folder_path,
+            bit_field_sdram_base_addresses, transceiver, machine_graph,
+            placements, machine, target_length,
+            compressed_pacman_router_tables, key_atom_map,
+            compressed_table_cache, cache_algorithm, merged_counts):
+        """ Take the compressed tables of the chips that have them in a \
+            cache, for compressors that would otherwise make them some other \
+            way, such as on the machine.
+
+        Those compressors rank the bitfields their own way, so the count
+        kept with a table does not say which were merged; all the bitfields
+        stay on the cores, and the count is only handed back.
+
+        :param iterable(~.UnCompressedMulticastRoutingTable) router_tables:
+            the routing tables to look for
+        :param bool produce_report: whether the report should be generated
+        :param str report_folder_path: the report folder base address
+        :param dict(tuple(int,int),int) bit_field_sdram_base_addresses:
+            the SDRAM addresses for bitfields used in the chips.
+        :param ~spinnman.transceiver.Transceiver transceiver:
+            spinnMan instance
+        :param ~pacman.model.graphs.machine.MachineGraph machine_graph:
+            machine graph
+        :param ~pacman.model.placements.Placements placements: placements
+        :param ~spinn_machine.Machine machine: SpiNNMan instance
+        :param int target_length: length of router compressor to get to
+        :param ~pacman.model.routing_tables.MulticastRoutingTables \
+                compressed_pacman_router_tables:
+            a data holder for the cached tables
+        :param dict(int,int) key_atom_map: key to atoms map
+        :param CompressedTableCache compressed_table_cache: the cache
+        :param str cache_algorithm: the compressor and its version
+        :param dict(tuple(int,int),int) merged_counts:
+            filled in with the count kept with the table of each chip found
+        :return: the key of the table of each chip not in the cache
+        :rtype: dict(tuple(int,int),str)
+        """
+        chips = self._read_chips(
+            router_tables, bit_field_sdram_base_addresses, transceiver,
+            machine_graph, placements, machine)
+        _, keys = self._finish_cached_chips(
+            chips, compressed_table_cache, cache_algorithm, target_length,
+            key_atom_map, produce_report, report_folder_path, transceiver,
+            compressed_pacman_router_tables, merged_counts=merged_counts)
+        return keys
+
+    def _read_chips(
+            self, router_tables, bit_field_sdram_base_addresses, transceiver,
+            machine_graph, placements, machine):
+        """ Read in the bitfields of every chip; only this process can \
+            talk to the machine
+
+        :param iterable(~.UnCompressedMulticastRoutingTable) router_tables:
+            the routing tables of the chips
+        :param dict(tuple(int,int),int) bit_field_sdram_base_addresses:
+            the SDRAM addresses for bitfields used in the chips.
+        :param ~spinnman.transceiver.Transceiver transceiver:
+            spinnMan instance
+        :param ~pacman.model.graphs.machine.MachineGraph machine_graph:
+            machine graph
+        :param ~pacman.model.placements.Placements placements: placements
+        :param ~spinn_machine.Machine machine: SpiNNMan instance
+        :return: the router table, bitfield addresses, bitfields by
+            processor and sorted bitfields of each chip
+        :rtype: list(tuple)
+        """
+        chips = list()
+        for router_table in router_tables:
+            bit_field_chip_base_addresses = bit_field_sdram_base_addresses[
+                (router_table.x, router_table.y)]
+            bit_fields_by_processor, sorted_bit_fields = \
+                self._read_in_bit_fields(
+                    transceiver, router_table.x, router_table.y,
+                    bit_field_chip_base_addresses, machine_graph,
+                    placements, machine.get_chip_at(
+                        router_table.x, router_table.y).n_processors)
+            chips.append((
+                router_table, bit_field_chip_base_addresses,
+                bit_fields_by_processor, sorted_bit_fields))
+        return chips
+
+    def _finish_cached_chips(
+            self, chips, compressed_table_cache, cache_algorithm,
+            target_length, key_atom_map, produce_report, report_folder_path,
+            transceiver, compressed_pacman_router_tables, progress=None,
+            merged_counts=None):
+        """ Finish the chips whose tables are in the cache as if they had \
+            just been compressed
+
+        :param list(tuple) chips: the router table, bitfield addresses,
+            bitfields by processor and sorted bitfields of each chip
+        :param CompressedTableCache compressed_table_cache: the cache
+        :param str cache_algorithm: the compressor and its version
+        :param int target_length: length of router compressor to get to
+        :param dict(int,int) key_atom_map: key to atoms map
+        :param bool produce_report: whether the report should be generated
+        :param str report_folder_path: the report folder base address
+        :param ~spinnman.transceiver.Transceiver transceiver:
+            spinnMan instance
+        :param ~pacman.model.routing_tables.MulticastRoutingTables \
+                compressed_pacman_router_tables:
+            a data holder for compressed tables
+        :param progress: updated as each chip is finished, if given
+        :type progress: ~spinn_utilities.progress_bar.ProgressBar or None
+        :param merged_counts: if given, the tables were not made by this
+            compressor; the count of each is put here instead of being used
+            to take bitfields off the cores
+        :type merged_counts: dict(tuple(int,int),int) or None
+        :return: the chips not in the cache, and the key of each by chip
+        :rtype: tuple(list(tuple), dict(tuple(int,int),str))
+        """
+        uncached = list()
+        keys = dict()
+        for chip in chips:
+            router_table, _, _, sorted_bit_fields = chip
+            key = compressed_table_cache.key(
+                router_table, target_length, cache_algorithm,
+                self._bit_fields_digest(sorted_bit_fields, key_atom_map))
+            result = compressed_table_cache.get(key)
+            if result is None:
+                uncached.append(chip)
+                keys[router_table.x, router_table.y] = key
+                continue
+
+            # The bitfields this merged are the best ones, so the count is
+            # enough to know which to take off the cores
+            entries, n_merged = result
+            self._best_routing_table = [
+                Entry(e_key, mask, defaultable, route)
+                for e_key, mask, route, defaultable in entries]
+            if merged_counts is None:
+                self._best_bit_fields_by_processor = self._bit_fields_by_key(
+                    sorted_bit_fields, n_merged)
+            else:
+                merged_counts[router_table.x, router_table.y] = n_merged
+                self._best_bit_fields_by_processor = dict()
+            self._finish_chip(
+                produce_report, report_folder_path, transceiver,
+                compressed_pacman_router_tables, *chip)
+            if progress is not None:
+                progress.update()
+        return uncached, keys
+
+    def _cache_algorithm(self):
+        """ Get the name and version of the compressor this will use, to \
+            tell its tables apart from those of others in a cache
+
+        :rtype: str
+        """
+        if NativeBitFieldCompressor.is_available():
+            return CompressedTableCache.algorithm_version(
+                "host_bit_field_native",
+                NativeBitFieldCompressor.library_path())
+        return CompressedTableCache.algorithm_version(
+            "host_bit_field_python", rigs_compressor.__file__)
+
+    def _bit_fields_digest(self, sorted_bit_fields, key_atom_map):
+        """ Get a digest of the bitfields of a chip, in the order they \
+            would be merged
+
+        :param list(_BitFieldData) sorted_bit_fields: the sorted bitfields
+        :param dict(int,int) key_atom_map: key to atoms map
+        :rtype: bytes
+        """
+        digest = hashlib.sha256()
+        for bf in sorted_bit_fields:
+            digest.update(self._THREE_WORDS.pack(
+                bf.master_pop_key, key_atom_map.get(bf.master_pop_key, 0),
+                bf.processor_id))
+            digest.update(self._ONE_WORDS.pack(len(bf.bit_field)))
+            digest.update(struct.pack(
+                "<{}I".format(len(bf.bit_field)), *bf.bit_field))
+        return digest.digest()
+
+    @staticmethod
+    def _n_merged(best_bit_fields_by_processor):
+        """ Count the bitfields merged into a table
+
+        :param dict(int,list(_BitFieldData)) best_bit_fields_by_processor:
+            the bitfields merged, by key
+        :rtype: int
+        """
+        if not best_bit_fields_by_processor:
+            return 0
+        return sum(len(bit_fields)
+                   for bit_fields in best_bit_fields_by_processor.values())
+
+    def _compress_natively(
+            self, chips, target_length, time_to_try_for_each_iteration,
+            use_timer_cut_off, key_atom_map):
+        """ Compress the chips with the host library, in a pool of \
+            processes if there is more than one chip
+
+        :param list(tuple) chips: the router table, bitfield addresses,
+            bitfields by processor and sorted bitfields of each chip
+        :param int target_length: length of router compressor to get to
+        :param int time_to_try_for_each_iteration:
+            time in seconds to run each compression attempt for
+        :param bool use_timer_cut_off:
+            whether the timer cut off is to be used
+        :param dict(int,int) key_atom_map: key to atoms map
+        :return: the best table and bitfields merged of each chip in turn
+        :rtype: iterable(tuple(list(~.Entry),
+            dict(int,list(_BitFieldData))))
+        """
+        time_limit_ms = 0
+        if use_timer_cut_off:
+            time_limit_ms = int(
+                time_to_try_for_each_iteration * self._MS_TO_SEC)
+        jobs = [
+            (self._native_entries(router_table),
+             [(bf.master_pop_key,
+               min(key_atom_map[bf.master_pop_key],
+                   len(bf.bit_field) * self._BITS_PER_WORD),
+               bf.processor_id, bf.bit_field) for bf in sorted_bit_fields],
+             target_length, time_limit_ms)
+            for router_table, _, _, sorted_bit_fields in chips]
+
+        pool = None
+        if len(jobs) > 1:
+            pool = Pool(min(len(jobs), cpu_count()))
+        try:
+            if pool is None:
+                results = map(_compress_chip_natively, jobs)
+            else:
+                results = pool.imap(_compress_chip_natively, jobs)
+            for (_, _, _, sorted_bit_fields), result in zip(chips, results):
+                if result is None:
+                    raise PacmanAlgorithmFailedToGenerateOutputsException(
+                        self._CANNOT_COMPRESS_MESSAGE)
+                table, mid_point = result
+                yield (
+                    [Entry(key, mask, is_defaultable(route, source), route)
+                     for key, mask, route, source in table],
+                    self._bit_fields_by_key(sorted_bit_fields, mid_point))
+        finally:
+            if pool is not None:
+                pool.terminate()
+                pool.join()
+
+    def _native_entries(self, router_table):
+        """ Convert a routing table to the entries of the host library
+
+        :param ~.UnCompressedMulticastRoutingTable router_table:
+        :return: the entries as (key, mask, route, source); defaultable
+            entries come from the link opposite the one they go to
+        :rtype: list(tuple(int,int,int,int))
+        """
+        entries = list()
+        for entry in router_table.multicast_routing_entries:
+            route = entry.spinnaker_route
+            source = 0
+            if entry.defaultable:
+                source = source_of_defaultable_route(route)
+            entries.append((
+                entry.routing_entry_key, entry.mask, route, source))
+        return entries
+
+    def _compress_in_python(
+            self, router_table, sorted_bit_fields, target_length,
+            time_to_try_for_each_iteration, use_timer_cut_off, key_atom_map):
+        """ Compress a chip without the host library
+
+        :param ~.UnCompressedMulticastRoutingTable router_table:
+            the routing table in question to compress
+        :param list(_BitFieldData) sorted_bit_fields: the sorted bitfields
+        :param int target_length: length of router compressor to get to
+        :param int time_to_try_for_each_iteration:
+            time in seconds to run each compression attempt for
+        :param bool use_timer_cut_off:
+            whether the timer cut off is to be used
+        :param dict(int,int) key_atom_map: key to atoms map
+        :return: the best table and the bitfields merged into it
+        :rtype: tuple(list(~.Entry), dict(int,list(_BitFieldData)))
+        """
         self._start_binary_search(
             router_table, sorted_bit_fields, target_length,
             time_to_try_for_each_iteration, use_timer_cut_off, key_atom_map)
+        return self._best_routing_table, self._best_bit_fields_by_processor
+
+    def _finish_chip(
+            self, produce_report, report_folder_path, transceiver,
+            compressed_pacman_router_tables, router_table,
+            bit_field_chip_base_addresses, bit_fields_by_processor,
+            sorted_bit_fields):
+        """ Keep the best table of a chip and remove the bitfields merged \
+            into it from the cores
 
+        :param bool produce_report: whether the report should be generated
+        :param str report_folder_path: the report folder base address
+        :param ~spinnman.transceiver.Transceiver transceiver:
+            spinnMan instance
+        :param ~pacman.model.routing_tables.MulticastRoutingTables \
+                compressed_pacman_router_tables:
+            a data holder for compressed tables
+        :param ~.UnCompressedMulticastRoutingTable router_table:
+            the routing table that was compressed
+        :param dict(int,int) bit_field_chip_base_addresses:
+            maps core id to base address
+        :param dict(int,list(_BitFieldData)) bit_fields_by_processor:
+            the bitfields of each processor
+        :param list(_BitFieldData) sorted_bit_fields: the sorted bitfields
+        """
         # add final to compressed tables:
         # self._best_routing_table is a list of entries
         best_router_table = CompressedMulticastRoutingTable(
@@ -637,13 +1066,9 @@ class HostBasedBitFieldRouterCompressor(object):
             the memory blocks that represent the bitfield
         :return: the number of redundant packets being captured.
         """
-        n_packets_filtered = 0
         n_neurons = len(bitfield) * self._BITS_PER_WORD
-
-        for neuron_id in range(0, n_neurons):
-            if self._bit_for_neuron_id(bitfield, neuron_id) == 0:
-                n_packets_filtered += 1
-        return n_packets_filtered
+        n_wanted = sum(bin(word).count("1") for word in bitfield)
+        return n_neurons - n_wanted
 
     def _start_binary_search(
             self, router_table, sorted_bit_fields, target_length,
@@ -668,9 +1093,7 @@ class HostBasedBitFieldRouterCompressor(object):
             self._best_bit_fields_by_processor = []
         except MinimisationFailedError:
             raise PacmanAlgorithmFailedToGenerateOutputsException(
-                "host bitfield router compressor can't compress the "
-                "uncompressed routing tables, regardless of bitfield merging. "
-                "System is fundamentally flawed here")
+                self._CANNOT_COMPRESS_MESSAGE)
 
         find_max_success(len(sorted_bit_fields), functools.partial(
             self._binary_search_check, sorted_bit_fields=sorted_bit_fields,
@@ -700,11 +1123,8 @@ class HostBasedBitFieldRouterCompressor(object):
         """
 
         # find new set of bitfields to try from midpoint
-        new_bit_field_by_processor = DefaultOrderedDict(list)
-
-        for element in range(0, mid_point):
-            bf_data = sorted_bit_fields[element]
-            new_bit_field_by_processor[bf_data.master_pop_key].append(bf_data)
+        new_bit_field_by_processor = self._bit_fields_by_key(
+            sorted_bit_fields, mid_point)
 
         # convert bitfields into router tables
         bit_field_router_tables = self._convert_bitfields_into_router_tables(
@@ -722,6 +1142,19 @@ class HostBasedBitFieldRouterCompressor(object):
         except PacmanElementAllocationException:
             return False
 
+    @staticmethod
+    def _bit_fields_by_key(sorted_bit_fields, mid_point):
+        """ Group the best bitfields by the key they filter
+
+        :param list(_BitFieldData) sorted_bit_fields: lists of bitfields
+        :param int mid_point: how many of the best bitfields to take
+        :rtype: dict(int,list(_BitFieldData))
+        """
+        bit_fields_by_key = DefaultOrderedDict(list)
+        for bf_data in sorted_bit_fields[:mid_point]:
+            bit_fields_by_key[bf_data.master_pop_key].append(bf_data)
+        return bit_fields_by_key
+
     def _run_algorithm(
             self, router_tables, target_length,
             time_to_try_for_each_iteration, use_timer_cut_off):
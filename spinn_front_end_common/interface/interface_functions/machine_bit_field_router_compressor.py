@@ -34,22 +34,25 @@ from pacman.operations.router_compressors.mundys_router_compressor.\
         get_generality as
         ordered_covering_generality)
 from spinn_front_end_common.interface.interface_functions.\
-    on_chip_router_table_compression.compression import make_source_hack
+    on_chip_router_table_compression.compression import (
+        cache_loaded_tables, make_source_hack, PROV_LOAD_TOP_NAME,
+        PROV_LOAD_CHIP_NAME, LOAD_TIME_NAME, ALGORITHM_NAME, ALGORITHM_NAMES)
 from spinn_front_end_common.utilities.utility_objs import (
-    ProvenanceDataItem, ExecutableType)
+    CompressedTableCache, ProvenanceDataItem, ExecutableType)
 from spinn_front_end_common.utilities.exceptions import (
     CantFindSDRAMToUseException)
 from spinn_front_end_common.utilities import system_control_logic
 from .load_executable_images import LoadExecutableImages
 from .host_bit_field_router_compressor import HostBasedBitFieldRouterCompressor
+from .routing_table_loader import RoutingTableLoader
 
 logger = FormatAdapter(logging.getLogger(__name__))
 
 #: sdram allocation for addresses
 SIZE_OF_SDRAM_ADDRESS_IN_BYTES = (17 * 2 * 4) + (3 * 4)
 
-# 7 pointers or int for each core. 4 Bytes for each  18 cores max
-SIZE_OF_COMMS_SDRAM = 7 * 4 * 18
+# 13 pointers, ints or bools for each core. 4 Bytes for each  18 cores max
+SIZE_OF_COMMS_SDRAM = 13 * 4 * 18
 
 SECOND_TO_MICRO_SECOND = 1000000
 
@@ -88,6 +91,9 @@ class MachineBitFieldRouterCompressor(object):
     :param bool compress_as_much_as_possible:
         whether to compress as much as possible
     :param list(ProvenanceDataItem) provenance_data_objects:
+    :param compressed_table_cache:
+        where tables compressed before are kept, if anywhere
+    :type compressed_table_cache: CompressedTableCache or None
     :return: where the compressors ran, and the provenance they generated
     :rtype: tuple(ExecutableTargets, list(ProvenanceDataItem))
     """
@@ -157,7 +163,8 @@ class MachineBitFieldRouterCompressor(object):
             target_length, routing_infos, time_to_try_for_each_iteration,
             use_timer_cut_off, machine_time_step, time_scale_factor,
             threshold_percentage, executable_targets,
-            compress_as_much_as_possible=False, provenance_data_objects=None):
+            compress_as_much_as_possible=False, provenance_data_objects=None,
+            compressed_table_cache=None):
         """ entrance for routing table compression with bit field
 
         :param ~.MulticastRoutingTables routing_tables:
@@ -178,6 +185,9 @@ class MachineBitFieldRouterCompressor(object):
         :param ExecutableTargets executable_targets:
         :param bool compress_as_much_as_possible:
         :param list(ProvenanceDataItem) provenance_data_objects:
+        :param compressed_table_cache:
+            where tables compressed before are kept, if anywhere
+        :type compressed_table_cache: CompressedTableCache or None
         :rtype: tuple(ExecutableTargets,list(ProvenanceDataItem))
         """
 
@@ -190,6 +200,18 @@ class MachineBitFieldRouterCompressor(object):
         if len(routing_tables.routing_tables) == 0:
             return ExecutableTargets(), prov_items
 
+        # chips compressed by an earlier run need no compressor
+        cache_keys = None
+        if compressed_table_cache is not None:
+            routing_tables, cache_keys = self._load_cached_tables(
+                routing_tables, transceiver, machine, app_id, machine_graph,
+                placements, executable_finder, produce_report,
+                default_report_folder, target_length, routing_infos,
+                threshold_percentage, compress_as_much_as_possible,
+                compressed_table_cache, prov_items)
+            if len(routing_tables.routing_tables) == 0:
+                return ExecutableTargets(), prov_items
+
         # new app id for this simulation
         routing_table_compressor_app_id = \
             transceiver.app_id_tracker.get_new_id()
@@ -222,6 +244,7 @@ class MachineBitFieldRouterCompressor(object):
             bit_field_sorter_executable_path, threshold_percentage)
 
         # load and run binaries
+        merged_counts = dict()
         system_control_logic.run_system_application(
             compressor_executable_targets,
             routing_table_compressor_app_id, transceiver,
@@ -231,11 +254,21 @@ class MachineBitFieldRouterCompressor(object):
                 self._check_bit_field_router_compressor_for_success,
                 host_chips=on_host_chips,
                 sorter_binary_path=bit_field_sorter_executable_path,
-                prov_data_items=prov_items),
+                prov_data_items=prov_items, merged_counts=merged_counts),
             [CPUState.FINISHED], True,
             "bit_field_compressor_on_{}_{}_{}.txt",
             [bit_field_sorter_executable_path], progress_bar)
 
+        # The sorter only says how many bitfields it merged, which is kept
+        # to be reported again when the table is taken from the cache
+        if cache_keys is not None:
+            cache_loaded_tables(
+                compressed_table_cache,
+                {chip: key for chip, key in cache_keys.items()
+                 if chip not in on_host_chips and
+                 not machine.get_chip_at(*chip).virtual},
+                app_id, transceiver, merged_counts)
+
         # start the host side compressions if needed
         if len(on_host_chips) != 0:
             logger.warning(self._ON_HOST_WARNING_MESSAGE, len(on_host_chips))
@@ -248,29 +281,33 @@ class MachineBitFieldRouterCompressor(object):
             key_atom_map = host_compressor.generate_key_to_atom_map(
                 machine_graph, routing_infos)
 
-            for (chip_x, chip_y) in progress_bar.over(on_host_chips, False):
-                bit_field_sdram_base_addresses = defaultdict(dict)
+            bit_field_sdram_base_addresses = defaultdict(dict)
+            for (chip_x, chip_y) in on_host_chips:
                 host_compressor.collect_bit_field_sdram_base_addresses(
                     chip_x, chip_y, machine, placements, transceiver,
                     bit_field_sdram_base_addresses)
 
-                host_compressor.start_compression_selection_process(
-                    router_table=routing_tables.get_routing_table_for_chip(
-                        chip_x, chip_y),
-                    produce_report=produce_report,
-                    report_folder_path=host_compressor.generate_report_path(
-                        default_report_folder),
-                    bit_field_sdram_base_addresses=(
-                        bit_field_sdram_base_addresses),
-                    transceiver=transceiver, machine_graph=machine_graph,
-                    placements=placements, machine=machine,
-                    target_length=target_length,
-                    time_to_try_for_each_iteration=(
-                        time_to_try_for_each_iteration),
-                    use_timer_cut_off=use_timer_cut_off,
-                    compressed_pacman_router_tables=(
-                        compressed_pacman_router_tables),
-                    key_atom_map=key_atom_map)
+            # the chips are compressed at the same time where possible
+            host_compressor.compress_chips(
+                router_tables=[
+                    routing_tables.get_routing_table_for_chip(
+                        chip_x, chip_y)
+                    for (chip_x, chip_y) in on_host_chips],
+                produce_report=produce_report,
+                report_folder_path=host_compressor.generate_report_path(
+                    default_report_folder),
+                bit_field_sdram_base_addresses=(
+                    bit_field_sdram_base_addresses),
+                transceiver=transceiver, machine_graph=machine_graph,
+                placements=placements, machine=machine,
+                target_length=target_length,
+                time_to_try_for_each_iteration=(
+                    time_to_try_for_each_iteration),
+                use_timer_cut_off=use_timer_cut_off,
+                compressed_pacman_router_tables=(
+                    compressed_pacman_router_tables),
+                key_atom_map=key_atom_map, progress=progress_bar,
+                compressed_table_cache=compressed_table_cache)
 
             # load host compressed routing tables
             for table in compressed_pacman_router_tables.routing_tables:
@@ -292,6 +329,86 @@ class MachineBitFieldRouterCompressor(object):
         :return: The name of the compressor aplx file to use
         """
 
+    def _load_cached_tables(
+            self, routing_tables, transceiver, machine, app_id,
+            machine_graph, placements, executable_finder, produce_report,
+            default_report_folder, target_length, routing_infos,
+            threshold_percentage, compress_as_much_as_possible,
+            compressed_table_cache, prov_data_items):
+        """ Load the tables of the chips that have them in the cache \
+            straight into the routers
+
+        The bitfields of every chip are read to make the keys, so this
+        costs time even when nothing is in the cache yet.
+
+        :param ~.MulticastRoutingTables routing_tables: the routing tables
+        :param ~.Transceiver transceiver: SpiNNMan instance
+        :param ~.Machine machine: the spinn machine instance
+        :param int app_id: the app id of the application
+        :param ~.MachineGraph machine_graph: machine graph
+        :param ~.Placements placements: placements on machine
+        :param ~.ExecutableFinder executable_finder:
+            where the binaries are located
+        :param bool produce_report: whether to report the cached tables
+        :param str default_report_folder: where reports go
+        :param int target_length: length of router compressor to get to
+        :param ~.RoutingInfo routing_infos: routing infos
+        :param int threshold_percentage:
+            the percentage of bitfields to do on chip
+        :param bool compress_as_much_as_possible:
+            whether to compress as much as possible
+        :param CompressedTableCache compressed_table_cache: the cache
+        :param list(ProvenanceDataItem) prov_data_items:
+            the store of data items
+        :return: the tables still to compress, and the key of each by chip
+        :rtype: tuple(~.MulticastRoutingTables, dict(tuple(int,int),str))
+        """
+        # The result depends on both binaries and on the settings
+        algorithm = "{}:{}:{}:{}".format(
+            CompressedTableCache.algorithm_version(
+                self._BIT_FIELD_SORTER_AND_SEARCH_EXECUTOR_APLX,
+                executable_finder.get_executable_path(
+                    self._BIT_FIELD_SORTER_AND_SEARCH_EXECUTOR_APLX)),
+            CompressedTableCache.algorithm_version(
+                self.compressor_aplx,
+                executable_finder.get_executable_path(self.compressor_aplx)),
+            compress_as_much_as_possible, threshold_percentage)
+
+        host_compressor = HostBasedBitFieldRouterCompressor()
+        bit_field_sdram_base_addresses = defaultdict(dict)
+        for table in routing_tables.routing_tables:
+            host_compressor.collect_bit_field_sdram_base_addresses(
+                table.x, table.y, machine, placements, transceiver,
+                bit_field_sdram_base_addresses)
+        report_folder_path = None
+        if produce_report:
+            report_folder_path = host_compressor.generate_report_path(
+                default_report_folder)
+
+        # the sorter ranks the bitfields its own way, so which it merged is
+        # not known; all stay on the cores, where they still filter
+        cached_tables = MulticastRoutingTables()
+        merged_counts = dict()
+        keys = host_compressor.finish_cached_chips(
+            routing_tables.routing_tables, produce_report,
+            report_folder_path, bit_field_sdram_base_addresses, transceiver,
+            machine_graph, placements, machine, target_length, cached_tables,
+            host_compressor.generate_key_to_atom_map(
+                machine_graph, routing_infos),
+            compressed_table_cache, algorithm, merged_counts)
+        if cached_tables.routing_tables:
+            RoutingTableLoader()(cached_tables, app_id, transceiver, machine)
+        for (x, y), n_merged in merged_counts.items():
+            prov_data_items.append(ProvenanceDataItem(
+                [PROV_TOP_NAME, PROV_CHIP_NAME.format(x, y), MERGED_NAME],
+                str(n_merged)))
+
+        uncached_tables = MulticastRoutingTables()
+        for table in routing_tables.routing_tables:
+            if (table.x, table.y) in keys:
+                uncached_tables.add_routing_table(table)
+        return uncached_tables, keys
+
     def _generate_core_subsets(
             self, routing_tables, executable_finder, machine, progress_bar,
             system_executable_targets):
@@ -357,7 +474,7 @@ class MachineBitFieldRouterCompressor(object):
 
     def _check_bit_field_router_compressor_for_success(
             self, executable_targets, transceiver, host_chips,
-            sorter_binary_path, prov_data_items):
+            sorter_binary_path, prov_data_items, merged_counts):
         """ Goes through the cores checking for cores that have failed to\
             generate the compressed routing tables with bitfield
 
@@ -369,6 +486,8 @@ class MachineBitFieldRouterCompressor(object):
         :param str sorter_binary_path: the path to the sorter binary
         :param list(ProvenanceDataItem) prov_data_items:
             the store of data items
+        :param dict(tuple(int,int),int) merged_counts:
+            filled in with the number of bitfields merged on each chip
         :rtype: bool
         """
         sorter_cores = executable_targets.get_cores_for_binary(
@@ -403,6 +522,28 @@ class MachineBitFieldRouterCompressor(object):
                     return False
                 prov_data_items.append(ProvenanceDataItem(
                     names, str(total_bit_fields_merged)))
+                merged_counts[x, y] = total_bit_fields_merged
+
+                # the sorter reports how long loading the router took
+                user_3_base_address = \
+                    transceiver.get_user_3_register_address_from_core(p)
+                load_time = struct.unpack(
+                    "<I", transceiver.read_memory(
+                        x, y, user_3_base_address, self._USER_BYTES))[0]
+                prov_data_items.append(ProvenanceDataItem(
+                    [PROV_LOAD_TOP_NAME, PROV_LOAD_CHIP_NAME.format(x, y),
+                     LOAD_TIME_NAME], load_time))
+
+                # and which algorithm made the table it loaded
+                user_0_base_address = \
+                    transceiver.get_user_0_register_address_from_core(p)
+                algorithm = struct.unpack(
+                    "<I", transceiver.read_memory(
+                        x, y, user_0_base_address, self._USER_BYTES))[0]
+                prov_data_items.append(ProvenanceDataItem(
+                    [PROV_LOAD_TOP_NAME, PROV_LOAD_CHIP_NAME.format(x, y),
+                     ALGORITHM_NAME],
+                    ALGORITHM_NAMES.get(algorithm, str(algorithm))))
         return True
 
     def _load_data(
@@ -835,3 +976,15 @@ class MachineBitFieldPairRouterCompressor(MachineBitFieldRouterCompressor):
     @overrides(MachineBitFieldRouterCompressor.compressor_aplx)
     def compressor_aplx(self):
         return "bit_field_pair_compressor.aplx"
+
+
+class MachineBitFieldAdaptiveRouterCompressor(
+        MachineBitFieldRouterCompressor):
+    """ Compresses with the Pair Algorithm, and then with the unordered \
+        Algorithm only on a chip the Pair result does not fit.
+    """
+
+    @property
+    @overrides(MachineBitFieldRouterCompressor.compressor_aplx)
+    def compressor_aplx(self):
+        return "bit_field_adaptive_compressor.aplx"
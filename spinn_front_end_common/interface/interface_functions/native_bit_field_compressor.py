@@ -0,0 +1,210 @@
+# Copyright (c) 2020 The University of Manchester
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+import ctypes
+import os
+from spinn_front_end_common import common_model_binaries
+
+#: The algorithms the host library can be built with
+PAIR = "pair"
+ORDERED_COVERING = "ordered_covering"
+
+# The link bits of a route
+_LINK_MASK = 0x3F
+
+# Half the number of links; a link's opposite is this many links round
+_HALF_LINKS = 3
+
+
+class _EntryStruct(ctypes.Structure):
+    """ An entry_t of routing_table.h
+    """
+    _fields_ = [
+        ("key", ctypes.c_uint32),
+        ("mask", ctypes.c_uint32),
+        ("route", ctypes.c_uint32),
+        ("source", ctypes.c_uint32)]
+
+
+class _FilterInfoStruct(ctypes.Structure):
+    """ A filter_info_t of filter_info.h
+    """
+    _fields_ = [
+        ("key", ctypes.c_uint32),
+        ("n_atoms", ctypes.c_uint32),
+        ("data", ctypes.POINTER(ctypes.c_uint32))]
+
+
+def source_of_defaultable_route(route):
+    """ Get the source link for an entry that the router could do by \
+        default routing, so that the compressor can see that it may drop it.
+
+    :param int route: the route of the entry, which goes to a single link
+    :return: the route bit of the link opposite the one the route goes to
+    :rtype: int
+    """
+    link_bits = route & _LINK_MASK
+    return ((link_bits << _HALF_LINKS) | (link_bits >> _HALF_LINKS)) & \
+        _LINK_MASK
+
+
+def is_defaultable(route, source):
+    """ Determine if an entry could be left to default routing, as \
+        remove_default_routes.h does.
+
+    :param int route: the route of the entry
+    :param int source: the source of the entry
+    :rtype: bool
+    """
+    return (
+        bin(route).count("1") == 1 and bool(route & _LINK_MASK) and
+        bin(source).count("1") == 1 and bool(source & _LINK_MASK) and
+        source_of_defaultable_route(route) == source)
+
+
+class NativeBitFieldCompressor(object):
+    """ Runs the table generator and compressor of the bit field compressor \
+        binaries on the host, through the library built by the compressor \
+        benchmark Makefile.
+
+    The uncompressed table and bit fields of a chip are converted once, and
+    can then be compressed for as many midpoints as the search needs. The
+    library can only do one compression at a time in a process.
+    """
+
+    __slots__ = [
+        "_bit_fields",
+        "_entries",
+        "_library",
+        "_n_bit_fields",
+        "_n_entries",
+        "_processor_ids",
+        "_words"]
+
+    # The version of bit_field_host_compressor.h the binding matches
+    _VERSION = 1
+
+    # The name of the library of each algorithm
+    _LIBRARY_NAME = "libbit_field_host_compressor_{}.so"
+
+    # Failure codes of host_compressor_run()
+    FAILED = -1
+    FAILED_MALLOC = -2
+    OUT_OF_TIME = -3
+    BAD_INPUT = -4
+
+    # The libraries loaded so far, by algorithm
+    _libraries = dict()
+
+    def __init__(self, entries, bit_fields, algorithm=ORDERED_COVERING):
+        """
+        :param list(tuple(int,int,int,int)) entries:
+            the uncompressed table as (key, mask, route, source)
+        :param list(tuple(int,int,int,list(int))) bit_fields:
+            the bit fields, best first, as (key, n_atoms, processor ID,
+            words)
+        :param str algorithm: the compressor to use
+        :raises OSError: if the library has not been built
+        """
+        self._library = self._load(algorithm)
+        self._n_entries = len(entries)
+        self._entries = (_EntryStruct * max(self._n_entries, 1))(*entries)
+        self._n_bit_fields = len(bit_fields)
+        n = max(self._n_bit_fields, 1)
+        self._bit_fields = (_FilterInfoStruct * n)()
+        self._processor_ids = (ctypes.c_int * n)()
+        # The words must live as long as the filters pointing at them
+        self._words = list()
+        for i, (key, n_atoms, processor_id, words) in enumerate(bit_fields):
+            data = (ctypes.c_uint32 * max(len(words), 1))(*words)
+            self._words.append(data)
+            self._bit_fields[i].key = key
+            self._bit_fields[i].n_atoms = n_atoms
+            self._bit_fields[i].data = ctypes.cast(
+                data, ctypes.POINTER(ctypes.c_uint32))
+            self._processor_ids[i] = processor_id
+
+    @classmethod
+    def library_path(cls, algorithm=ORDERED_COVERING):
+        """ Get where the library of an algorithm is built to
+
+        :param str algorithm: the compressor to use
+        :rtype: str
+        """
+        return os.path.join(
+            os.path.dirname(common_model_binaries.__file__),
+            cls._LIBRARY_NAME.format(algorithm))
+
+    @classmethod
+    def _load(cls, algorithm):
+        """ Load the library of an algorithm, if not already loaded
+
+        :param str algorithm: the compressor to use
+        :rtype: ~ctypes.CDLL
+        :raises OSError: if the library has not been built or does not match
+        """
+        if algorithm not in cls._libraries:
+            path = cls.library_path(algorithm)
+            library = ctypes.CDLL(path)
+            if library.host_compressor_version() != cls._VERSION:
+                raise OSError("{} is not version {}".format(
+                    path, cls._VERSION))
+            library.host_compressor_run.restype = ctypes.c_int
+            library.host_compressor_run.argtypes = [
+                ctypes.POINTER(_EntryStruct), ctypes.c_uint32,
+                ctypes.POINTER(_FilterInfoStruct),
+                ctypes.POINTER(ctypes.c_int), ctypes.c_int, ctypes.c_int,
+                ctypes.c_int, ctypes.c_int, ctypes.POINTER(_EntryStruct),
+                ctypes.c_uint32]
+            cls._libraries[algorithm] = library
+        return cls._libraries[algorithm]
+
+    @classmethod
+    def is_available(cls, algorithm=ORDERED_COVERING):
+        """ Determine if the library of an algorithm has been built
+
+        :param str algorithm: the compressor to use
+        :rtype: bool
+        """
+        try:
+            cls._load(algorithm)
+            return True
+        except OSError:
+            return False
+
+    def run(self, mid_point, target_length, time_limit_ms=0):
+        """ Merge the best bit fields into the table and compress it
+
+        :param int mid_point: how many of the best bit fields to merge in
+        :param int target_length: the most entries the table may end with
+        :param int time_limit_ms:
+            how long the compressor may run for, or 0 for no limit
+        :return: the compressed table as (key, mask, route, source), or
+            `None` if it did not compress to the target length
+        :rtype: list(tuple(int,int,int,int)) or None
+        :raises ValueError: if the inputs were not consistent
+        """
+        compressed = (_EntryStruct * max(target_length, 1))()
+        n_compressed = self._library.host_compressor_run(
+            self._entries, self._n_entries, self._bit_fields,
+            self._processor_ids, self._n_bit_fields, mid_point,
+            target_length, time_limit_ms, compressed, target_length)
+        if n_compressed == self.BAD_INPUT:
+            raise ValueError(
+                "The bit fields and table could not be compressed together")
+        if n_compressed < 0:
+            return None
+        return [(e.key, e.mask, e.route, e.source)
+                for e in compressed[:n_compressed]]
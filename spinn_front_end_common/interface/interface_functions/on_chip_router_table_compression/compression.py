@@ -22,21 +22,37 @@ from spinn_utilities.executable_finder import ExecutableFinder
 from spinn_machine import CoreSubsets, Router
 from spinnman.model import ExecutableTargets
 from spinnman.model.enums import CPUState
+from pacman.model.routing_tables import (
+    MulticastRoutingTables, CompressedMulticastRoutingTable)
+from pacman.operations.router_compressors import Entry
 from spinn_front_end_common.utilities.exceptions import SpinnFrontEndException
 from spinn_front_end_common.utilities.system_control_logic import (
     run_system_application)
-from spinn_front_end_common.utilities.utility_objs import ExecutableType
+from spinn_front_end_common.utilities.utility_objs import (
+    CompressedTableCache, ExecutableType, ProvenanceDataItem)
+from spinn_front_end_common.interface.interface_functions.\
+    routing_table_loader import (
+        RoutingTableLoader, PROV_LOAD_TOP_NAME, PROV_LOAD_CHIP_NAME)
 logger = logging.getLogger(__name__)
 _FOUR_WORDS = struct.Struct("<IIII")
 _THREE_WORDS = struct.Struct("<III")
 # The SDRAM Tag used by the application - note this is fixed in the APLX
 _SDRAM_TAG = 1
+# The user register the rebuildable binaries report the load time in
+_LOAD_TIME_REGISTER = 2
+# The user register the rebuildable binaries report the algorithm used in
+_ALGORITHM_REGISTER = 3
+# provenance data item names
+LOAD_TIME_NAME = "load_time_us"
+ALGORITHM_NAME = "compression_algorithm"
+# The algorithms as reported by the binaries; see compressor_path_t
+ALGORITHM_NAMES = {0: "none", 1: "pair", 2: "ordered_covering"}
 
 
 def mundy_on_chip_router_compression(
         routing_tables, transceiver, machine, app_id,
         system_provenance_folder, compress_only_when_needed=True,
-        compress_as_much_as_possible=False):
+        compress_as_much_as_possible=False, compressed_table_cache=None):
     """ Load routing tables and compress them using Mundy's algorithm.
 
     This uses an aplx built by Mundy which no longer compiles but still works
@@ -56,6 +72,9 @@ def mundy_on_chip_router_compression(
     :param bool compress_only_when_needed:
         If True, the compressor will only compress if the table doesn't fit in
         the current router space, otherwise it will just load the table
+    :param compressed_table_cache:
+        where tables compressed before are kept, if anywhere
+    :type compressed_table_cache: CompressedTableCache or None
     :return:
     """
     # pylint: disable=too-many-arguments
@@ -63,7 +82,8 @@ def mundy_on_chip_router_compression(
     compression = Compression(
         app_id, binary_path, compress_as_much_as_possible,
         machine, system_provenance_folder, routing_tables, transceiver,
-        "Running Mundy routing table compression on chip")
+        "Running Mundy routing table compression on chip",
+        compressed_table_cache)
     compression._compress_only_when_needed = compress_only_when_needed
     compression.compress(register=0)
 
@@ -71,7 +91,7 @@ def mundy_on_chip_router_compression(
 def pair_compression(
         routing_tables, transceiver, executable_finder,
         machine, app_id, provenance_file_path,
-        compress_as_much_as_possible=True):
+        compress_as_much_as_possible=True, compressed_table_cache=None):
     """ Load routing tables and compress then using the Pair Algorithm.
 
     See pacman/operations/router_compressors/pair_compressor.py which is the
@@ -91,6 +111,11 @@ def pair_compression(
         the router space, otherwise it will try to reduce until it until it
         can't reduce it any more
     :param executable_finder: tracker of binaries.
+    :param compressed_table_cache:
+        where tables compressed before are kept, if anywhere
+    :type compressed_table_cache: CompressedTableCache or None
+    :return: how long each chip took to load its table into the router
+    :rtype: list(ProvenanceDataItem)
      """
     # pylint: disable=too-many-arguments
     binary_path = executable_finder.get_executable_path(
@@ -98,14 +123,16 @@ def pair_compression(
     compression = Compression(
         app_id, binary_path, compress_as_much_as_possible,
         machine, provenance_file_path, routing_tables, transceiver,
-        "Running pair routing table compression on chip")
-    compression.compress(register=1)
+        "Running pair routing table compression on chip",
+        compressed_table_cache)
+    return compression.compress(
+        register=1, load_time_register=_LOAD_TIME_REGISTER)
 
 
 def unordered_compression(
         routing_tables, transceiver, executable_finder,
         machine, app_id, provenance_file_path,
-        compress_as_much_as_possible=True):
+        compress_as_much_as_possible=True, compressed_table_cache=None):
     """ Load routing tables and compress then using the unordered Algorithm.
 
     To the best of our knowledge this is the same algorithm as the
@@ -126,6 +153,11 @@ def unordered_compression(
         the router space, otherwise it will try to reduce until it until it
         can't reduce it any more
     :param executable_finder: tracker of binaries.
+    :param compressed_table_cache:
+        where tables compressed before are kept, if anywhere
+    :type compressed_table_cache: CompressedTableCache or None
+    :return: how long each chip took to load its table into the router
+    :rtype: list(ProvenanceDataItem)
      """
     # pylint: disable=too-many-arguments
     binary_path = executable_finder.get_executable_path(
@@ -133,8 +165,55 @@ def unordered_compression(
     compression = Compression(
         app_id, binary_path, compress_as_much_as_possible,
         machine, provenance_file_path, routing_tables, transceiver,
-        "Running unordered routing table compression on chip")
-    compression.compress(register=1)
+        "Running unordered routing table compression on chip",
+        compressed_table_cache)
+    return compression.compress(
+        register=1, load_time_register=_LOAD_TIME_REGISTER)
+
+
+def adaptive_compression(
+        routing_tables, transceiver, executable_finder,
+        machine, app_id, provenance_file_path,
+        compress_as_much_as_possible=True, compressed_table_cache=None):
+    """ Load routing tables and compress them using the Pair Algorithm, and \
+        then the unordered Algorithm on any chip the Pair result does not fit.
+
+    Most tables fit once compressed with the faster Pair Algorithm, so most
+    chips never need the slower one. Which was used on each chip is reported
+    as provenance.
+
+    :param ~pacman.model.routing_tables.MulticastRoutingTables routing_tables:
+        the memory routing tables to be compressed
+    :param ~spinnman.Transceiver transceiver: the spinnman interface
+    :param ~spinn_utilities.executable_finder.ExecutableFinder \
+            executable_finder:
+    :param ~spinn_machine.Machine machine:
+        the SpiNNaker machine representation
+    :param int app_id: the application ID used by the main application
+    :param str provenance_file_path: the path to where to write the data
+    :param bool compress_as_much_as_possible:
+        If False, the compressor will only reduce the table until it fits in
+        the router space, otherwise it will try to reduce until it until it
+        can't reduce it any more
+    :param executable_finder: tracker of binaries.
+    :param compressed_table_cache:
+        where tables compressed before are kept, if anywhere
+    :type compressed_table_cache: CompressedTableCache or None
+    :return: how long each chip took to load its table into the router, and
+        which algorithm compressed it
+    :rtype: list(ProvenanceDataItem)
+     """
+    # pylint: disable=too-many-arguments
+    binary_path = executable_finder.get_executable_path(
+        "simple_adaptive_compressor.aplx")
+    compression = Compression(
+        app_id, binary_path, compress_as_much_as_possible,
+        machine, provenance_file_path, routing_tables, transceiver,
+        "Running adaptive routing table compression on chip",
+        compressed_table_cache)
+    return compression.compress(
+        register=1, load_time_register=_LOAD_TIME_REGISTER,
+        algorithm_register=_ALGORITHM_REGISTER)
 
 
 def make_source_hack(entry):
@@ -153,6 +232,72 @@ def make_source_hack(entry):
     return 0
 
 
+def load_cached_tables(
+        routing_tables, compressed_table_cache, key_of_table, app_id,
+        transceiver, machine):
+    """ Load the tables whose compressed versions are in a cache straight \
+        into the routers, so that no compressor has to run for them
+
+    :param ~pacman.model.routing_tables.MulticastRoutingTables \
+            routing_tables:
+        the uncompressed tables
+    :param CompressedTableCache compressed_table_cache: the cache
+    :param callable key_of_table:
+        gives the key of the compressed version of an uncompressed table
+    :param int app_id: the application ID used by the main application
+    :param ~spinnman.Transceiver transceiver: the spinnman interface
+    :param ~spinn_machine.Machine machine:
+        the SpiNNaker machine representation
+    :return: the tables still to compress, and the key of each by chip
+    :rtype: tuple(~pacman.model.routing_tables.MulticastRoutingTables,
+        dict(tuple(int,int),str))
+    """
+    uncached = MulticastRoutingTables()
+    cached = MulticastRoutingTables()
+    keys = dict()
+    for table in routing_tables.routing_tables:
+        key = key_of_table(table)
+        result = compressed_table_cache.get(key)
+        if result is None:
+            uncached.add_routing_table(table)
+            keys[table.x, table.y] = key
+            continue
+        compressed = CompressedMulticastRoutingTable(table.x, table.y)
+        for e_key, mask, route, defaultable in result[0]:
+            compressed.add_multicast_routing_entry(
+                Entry(e_key, mask, defaultable, route)
+                .to_MulticastRoutingEntry())
+        cached.add_routing_table(compressed)
+
+    if cached.routing_tables:
+        logger.info(
+            "Loading %d compressed routing tables from the cache",
+            len(cached.routing_tables))
+        RoutingTableLoader()(cached, app_id, transceiver, machine)
+    return uncached, keys
+
+
+def cache_loaded_tables(
+        compressed_table_cache, keys, app_id, transceiver, counts=None):
+    """ Add the tables that compressors have loaded into routers to a \
+        cache
+
+    :param CompressedTableCache compressed_table_cache: the cache
+    :param dict(tuple(int,int),str) keys:
+        the key to store the table of each chip under
+    :param int app_id: the application ID the tables were loaded with
+    :param ~spinnman.Transceiver transceiver: the spinnman interface
+    :param counts: a number to store with the table of each chip, if any
+    :type counts: dict(tuple(int,int),int) or None
+    """
+    for (x, y), key in keys.items():
+        routes = transceiver.get_multicast_routes(x, y, app_id)
+        count = 0 if counts is None else counts.get((x, y), 0)
+        compressed_table_cache.put(key, (
+            (route.routing_entry_key, route.mask, route.spinnaker_route,
+             route.defaultable) for route in routes), count)
+
+
 class Compression(object):
     """ Compressor that uses a on chip router compressor
     """
@@ -162,6 +307,7 @@ class Compression(object):
          "_binary_path",
          "_compress_as_much_as_possible",
          "_compress_only_when_needed",
+         "_compressed_table_cache",
          "_compressor_app_id",
          "_machine",
          "_progresses_text",
@@ -172,7 +318,7 @@ class Compression(object):
     def __init__(
             self, app_id, binary_path, compress_as_much_as_possible,
             machine, provenance_file_path, routing_tables, transceiver,
-            progresses_text):
+            progresses_text, compressed_table_cache=None):
         """
         :param int app_id: the application ID used by the main application
         :param str binary_path: What
@@ -184,6 +330,9 @@ class Compression(object):
                 routing_tables:
         :param ~spinnman.Transceiver transceiver:
         :param str progresses_text: Text to use in progress bar
+        :param compressed_table_cache:
+            where tables compressed before are kept, if anywhere
+        :type compressed_table_cache: CompressedTableCache or None
         """
         self._app_id = app_id
         self._binary_path = binary_path
@@ -196,14 +345,43 @@ class Compression(object):
         self._routing_tables = routing_tables
         self._progresses_text = progresses_text
         self._compressor_app_id = None
+        self._compressed_table_cache = compressed_table_cache
 
-    def compress(self, register):
+    def compress(
+            self, register, load_time_register=None,
+            algorithm_register=None):
         """ Apply the on-machine compression algorithm.
 
         :param int register: number of user register to check
+        :param load_time_register: number of user register the binary
+            reports how long it took to load the router in, if it does
+        :type load_time_register: int or None
+        :param algorithm_register: number of user register the binary
+            reports the algorithm it compressed with in, if it does
+        :type algorithm_register: int or None
+        :return: how long each chip took to load its table into the router,
+            and which algorithm compressed it
+        :rtype: list(ProvenanceDataItem)
         """
         # pylint: disable=too-many-arguments
 
+        # tables compressed by an earlier run need no compressor
+        keys = None
+        if self._compressed_table_cache is not None:
+            # The compressors make the table fit the router, and how far
+            # they go depends on the flags
+            algorithm = "{}:{}:{}".format(
+                CompressedTableCache.algorithm_version(
+                    os.path.basename(self._binary_path), self._binary_path),
+                self._compress_as_much_as_possible,
+                self._compress_only_when_needed)
+            self._routing_tables, keys = load_cached_tables(
+                self._routing_tables, self._compressed_table_cache,
+                functools.partial(self._cache_key, algorithm), self._app_id,
+                self._transceiver, self._machine)
+            if not self._routing_tables.routing_tables:
+                return []
+
         # build progress bar
         progress_bar = ProgressBar(
             len(self._routing_tables.routing_tables) * 2,
@@ -231,6 +409,95 @@ class Compression(object):
             [CPUState.FINISHED], False, "compressor_on_{}_{}_{}.txt",
             [self._binary_path], progress_bar)
 
+        if keys is not None:
+            cache_loaded_tables(
+                self._compressed_table_cache, keys, self._app_id,
+                self._transceiver)
+
+        prov_items = list()
+        if load_time_register is not None:
+            prov_items.extend(self._read_load_times(
+                executable_targets, load_time_register))
+        if algorithm_register is not None:
+            prov_items.extend(self._read_algorithms(
+                executable_targets, algorithm_register))
+        return prov_items
+
+    def _read_load_times(self, executable_targets, register):
+        """ Read how long each compressor took to load its router
+
+        :param ExecutableTargets executable_targets:
+        :param int register: number of user register to read
+        :rtype: list(ProvenanceDataItem)
+        """
+        prov_items = list()
+        for core_subset in executable_targets.all_core_subsets:
+            x = core_subset.x
+            y = core_subset.y
+            for p in core_subset.processor_ids:
+                load_time = self._read_user(x, y, p, register)
+                prov_items.append(ProvenanceDataItem(
+                    [PROV_LOAD_TOP_NAME, PROV_LOAD_CHIP_NAME.format(x, y),
+                     LOAD_TIME_NAME], load_time))
+        return prov_items
+
+    def _read_algorithms(self, executable_targets, register):
+        """ Read which algorithm each compressor compressed its table with
+
+        :param ExecutableTargets executable_targets:
+        :param int register: number of user register to read
+        :rtype: list(ProvenanceDataItem)
+        """
+        prov_items = list()
+        counts = dict()
+        for core_subset in executable_targets.all_core_subsets:
+            x = core_subset.x
+            y = core_subset.y
+            for p in core_subset.processor_ids:
+                algorithm = self._read_user(x, y, p, register)
+                name = ALGORITHM_NAMES.get(algorithm, str(algorithm))
+                counts[name] = counts.get(name, 0) + 1
+                prov_items.append(ProvenanceDataItem(
+                    [PROV_LOAD_TOP_NAME, PROV_LOAD_CHIP_NAME.format(x, y),
+                     ALGORITHM_NAME], name))
+        for name in sorted(counts):
+            logger.info("%d chips compressed by %s", counts[name], name)
+        return prov_items
+
+    def _read_user(self, x, y, p, register):
+        """ Read a user register of a core
+
+        :param int x:
+        :param int y:
+        :param int p:
+        :param int register: number of user register to read
+        :rtype: int
+        """
+        if register == 0:
+            return self._transceiver.read_user_0(x, y, p)
+        elif register == 1:
+            return self._transceiver.read_user_1(x, y, p)
+        elif register == 2:
+            return self._transceiver.read_user_2(x, y, p)
+        elif register == 3:
+            address = self._transceiver.\
+                get_user_3_register_address_from_core(p)
+            return struct.unpack("<I", self._transceiver.read_memory(
+                x, y, address, 4))[0]
+        raise Exception("Incorrect register")
+
+    def _cache_key(self, algorithm, routing_table):
+        """ Get the key of the compressed version of a table in the cache
+
+        :param str algorithm: the compressor and its settings
+        :param ~.AbstractMulticastRoutingTable routing_table:
+        :rtype: str
+        """
+        router = self._machine.get_chip_at(
+            routing_table.x, routing_table.y).router
+        return self._compressed_table_cache.key(
+            routing_table, router.n_available_multicast_entries, algorithm)
+
     def _load_routing_table(self, table):
         """
         :param ~.MulticastRoutingTables routing_table:
@@ -258,14 +525,7 @@ class Compression(object):
             y = core_subset.y
             for p in core_subset.processor_ids:
                 # Read the result from specified register
-                if register == 0:
-                    result = transceiver.read_user_0(x, y, p)
-                elif register == 1:
-                    result = transceiver.read_user_1(x, y, p)
-                elif register == 2:
-                    result = transceiver.read_user_2(x, y, p)
-                else:
-                    raise Exception("Incorrect register")
+                result = self._read_user(x, y, p, register)
                 # The result is 0 if success, otherwise failure
                 if result != 0:
                     raise SpinnFrontEndException(
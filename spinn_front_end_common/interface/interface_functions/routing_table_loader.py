@@ -13,16 +13,64 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+import logging
+import numpy
+from spinn_utilities.log import FormatAdapter
 from spinn_utilities.progress_bar import ProgressBar
+from spinn_front_end_common.utilities.utility_objs import ProvenanceDataItem
+
+logger = FormatAdapter(logging.getLogger(__name__))
+
+PROV_LOAD_TOP_NAME = "router_table_load_provenance"
+PROV_LOAD_CHIP_NAME = "router_at_chip_{}_{}"
+DEFAULT_ROUTED_NAME = "entries_left_to_default_routing"
+
+
+def remove_default_routes(entries):
+    """ Leave out the entries of a routing table that the router would \
+        do the same by default routing.
+
+    An entry marked as defaultable is only left out if no entry after it
+    would then catch any of its keys and send them somewhere else.
+
+    :param list(~spinn_machine.MulticastRoutingEntry) entries:
+        the entries of the table, in order
+    :return: the entries still needed, in the same order
+    :rtype: list(~spinn_machine.MulticastRoutingEntry)
+    """
+    entries = list(entries)
+    if not any(entry.defaultable for entry in entries):
+        return entries
+    keys = numpy.array(
+        [entry.routing_entry_key for entry in entries], dtype="uint32")
+    masks = numpy.array([entry.mask for entry in entries], dtype="uint32")
+    routes = numpy.array(
+        [entry.spinnaker_route for entry in entries], dtype="uint32")
+    needed = list()
+    for i, entry in enumerate(entries):
+        if entry.defaultable:
+            later = slice(i + 1, None)
+            caught = (
+                (keys[later] & entry.mask) ==
+                (masks[later] & entry.routing_entry_key))
+            elsewhere = routes[later] != entry.spinnaker_route
+            if not numpy.any(caught & elsewhere):
+                continue
+        needed.append(entry)
+    return needed
 
 
 class RoutingTableLoader(object):
     """ Loads routes into initialised routers.
 
+    Entries that default routing does the same are left out first.
+
     :param ~pacman.model.routing_tables.MulticastRoutingTables router_tables:
     :param int app_id:
     :param ~spinnman.transceiver.Transceiver transceiver:
     :param ~spinn_machine.Machine machine:
+    :return: how many entries of each table were left to default routing
+    :rtype: list(ProvenanceDataItem)
     """
     __slots__ = []
 
@@ -32,15 +80,31 @@ class RoutingTableLoader(object):
         :param int app_id:
         :param ~.Transceiver transceiver:
         :param ~.Machine machine:
+        :rtype: list(ProvenanceDataItem)
         """
         progress = ProgressBar(router_tables.routing_tables,
                                "Loading routing data onto the machine")
 
         # load each router table that is needed for the application to run into
         # the chips SDRAM
+        prov_items = list()
+        n_removed = 0
         for table in progress.over(router_tables.routing_tables):
             if (not machine.get_chip_at(table.x, table.y).virtual
                     and table.multicast_routing_entries):
-                transceiver.load_multicast_routes(
-                    table.x, table.y, table.multicast_routing_entries,
-                    app_id=app_id)
+                entries = remove_default_routes(
+                    table.multicast_routing_entries)
+                n_default = len(table.multicast_routing_entries) - len(
+                    entries)
+                n_removed += n_default
+                prov_items.append(ProvenanceDataItem(
+                    [PROV_LOAD_TOP_NAME,
+                     PROV_LOAD_CHIP_NAME.format(table.x, table.y),
+                     DEFAULT_ROUTED_NAME], n_default))
+                if entries:
+                    transceiver.load_multicast_routes(
+                        table.x, table.y, entries, app_id=app_id)
+        if n_removed:
+            logger.info("Left {} routing entries to default routing",
+                        n_removed)
+        return prov_items
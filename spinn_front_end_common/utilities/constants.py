@@ -112,6 +112,19 @@ class BUFFERING_OPERATIONS(Enum):
     BUFFER_WRITE = 1
 
 
+class RECORDING_ENCODINGS(Enum):
+    """ How the records of a recording region are encoded on the machine;\
+        see recording_encodings in recording.h
+    """
+
+    #: Records are stored as they are recorded
+    NONE = 0
+    #: Each record is stored as its size in bytes, then for each group of up\
+    #: to 32 of its words, a word with a bit set for each word of the group\
+    #: that is not zero, followed by those words
+    ZERO_WORDS = 1
+
+
 #: partition IDs preallocated to functionality
 PARTITION_ID_FOR_MULTICAST_DATA_SPEED_UP = "DATA_SPEED_UP_ROAD"
 
@@ -13,6 +13,7 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+from .compressed_table_cache import CompressedTableCache
 from .data_written import DataWritten
 from .dpri_flags import DPRIFlags
 from .executable_finder import ExecutableFinder
@@ -23,6 +24,6 @@ from .provenance_data_item import ProvenanceDataItem
 from .reinjection_status import ReInjectionStatus
 
 __all__ = [
-    "DataWritten", "DPRIFlags", "ExecutableFinder",
+    "CompressedTableCache", "DataWritten", "DPRIFlags", "ExecutableFinder",
     "ExecutableType", "LivePacketGatherParameters", "PowerUsed",
     "ProvenanceDataItem", "ReInjectionStatus"]
@@ -0,0 +1,159 @@
+# Copyright (c) 2020 The University of Manchester
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+import hashlib
+import logging
+import os
+import struct
+import tempfile
+from spinn_utilities.log import FormatAdapter
+
+logger = FormatAdapter(logging.getLogger(__name__))
+
+_HEADER = struct.Struct("<II")
+_ENTRY = struct.Struct("<IIII")
+
+
+class CompressedTableCache(object):
+    """ A store of compressed routing tables that lasts between runs, so \
+        that a table already compressed once need not be compressed again.
+
+    Tables are found by a hash of everything the compressed table depends
+    on: the uncompressed entries, the length to compress to and the
+    algorithm (including its version) that did the compressing. Each table
+    is kept in a file of its own in the cache directory, so several
+    processes can share a cache.
+    """
+
+    __slots__ = [
+        "_directory"]
+
+    # Change this when the way keys or files are made changes
+    _FORMAT_VERSION = 1
+
+    # The name of the file holding a table
+    _FILE_NAME = "{}.rt"
+
+    # How much of a file to hash at once
+    _BLOCK_SIZE = 1 << 16
+
+    def __init__(self, directory):
+        """
+        :param str directory: where the tables are kept; made if needed
+        """
+        self._directory = directory
+        if not os.path.exists(directory):
+            os.makedirs(directory)
+
+    @staticmethod
+    def algorithm_version(name, path=None):
+        """ Get a description of an algorithm that changes whenever the \
+            code that does it does
+
+        :param str name: the name of the algorithm
+        :param path: the binary or library that runs it, if any
+        :type path: str or None
+        :rtype: str
+        """
+        if path is None:
+            return name
+        digest = hashlib.sha256()
+        with open(path, "rb") as f:
+            for block in iter(
+                    lambda: f.read(CompressedTableCache._BLOCK_SIZE), b""):
+                digest.update(block)
+        return "{}:{}".format(name, digest.hexdigest())
+
+    def key(self, routing_table, target_length, algorithm, extra=b""):
+        """ Work out the key of the compressed version of a table
+
+        :param routing_table: the uncompressed table
+        :type routing_table:
+            ~pacman.model.routing_tables.AbstractMulticastRoutingTable
+        :param int target_length: the length the table is compressed to
+        :param str algorithm: the algorithm and its version; see
+            :py:meth:`algorithm_version`
+        :param bytes extra: anything else the result depends on, such as
+            the bitfields merged in
+        :return: the key
+        :rtype: str
+        """
+        digest = hashlib.sha256()
+        name = algorithm.encode("utf-8")
+        digest.update(struct.pack(
+            "<IiI", self._FORMAT_VERSION, target_length, len(name)))
+        digest.update(name)
+        digest.update(struct.pack("<I", routing_table.number_of_entries))
+        for entry in routing_table.multicast_routing_entries:
+            digest.update(_ENTRY.pack(
+                entry.routing_entry_key, entry.mask, entry.spinnaker_route,
+                int(entry.defaultable)))
+        digest.update(extra)
+        return digest.hexdigest()
+
+    def _path(self, key):
+        return os.path.join(self._directory, self._FILE_NAME.format(key))
+
+    def get(self, key):
+        """ Get a table from the cache
+
+        :param str key: the key of the table
+        :return: the entries as (key, mask, route, defaultable) and a count
+            stored with them, or `None` if the table is not in the cache
+        :rtype: tuple(list(tuple(int,int,int,bool)),int) or None
+        """
+        try:
+            with open(self._path(key), "rb") as f:
+                data = f.read()
+        except IOError:
+            return None
+        try:
+            n_entries, count = _HEADER.unpack_from(data, 0)
+            if len(data) != _HEADER.size + n_entries * _ENTRY.size:
+                raise struct.error("wrong length")
+            entries = [
+                (e_key, mask, route, bool(defaultable))
+                for e_key, mask, route, defaultable in (
+                    _ENTRY.unpack_from(data, _HEADER.size + i * _ENTRY.size)
+                    for i in range(n_entries))]
+        except struct.error:
+            logger.warning("Ignoring damaged cached table {}", key)
+            return None
+        return entries, count
+
+    def put(self, key, entries, count=0):
+        """ Add a table to the cache
+
+        :param str key: the key of the table
+        :param iterable(tuple(int,int,int,bool)) entries:
+            the entries as (key, mask, route, defaultable)
+        :param int count: a number to store with the table, such as how
+            many bitfields were merged into it
+        """
+        entries = list(entries)
+        data = bytearray(_HEADER.pack(len(entries), count))
+        for e_key, mask, route, defaultable in entries:
+            data += _ENTRY.pack(e_key, mask, route, int(defaultable))
+
+        # Write to the side and rename, so a reader never sees half a table
+        fd, temp_path = tempfile.mkstemp(dir=self._directory)
+        try:
+            with os.fdopen(fd, "wb") as f:
+                f.write(data)
+            os.rename(temp_path, self._path(key))
+        except OSError:
+            logger.warning("Could not cache table {}", key)
+            if os.path.exists(temp_path):
+                os.remove(temp_path)
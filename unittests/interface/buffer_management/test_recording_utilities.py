@@ -0,0 +1,88 @@
+# Copyright (c) 2020 The University of Manchester
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+import struct
+import unittest
+import numpy
+from spinn_front_end_common.interface.buffer_management.recording_utilities \
+    import (
+        decode_recorded_data, get_recording_header_array,
+        get_recording_header_size)
+from spinn_front_end_common.interface.buffer_management.storage_objects \
+    import ChannelBufferState
+from spinn_front_end_common.utilities.constants import RECORDING_ENCODINGS
+from spinn_front_end_common.utilities.exceptions import (
+    SpinnFrontEndException)
+
+
+def _encode(record):
+    """ Encode a record as recording.c does with ZERO_WORDS
+    """
+    padded = bytes(record) + bytes(bytearray(-len(record) % 4))
+    words = numpy.frombuffer(padded, dtype="<u4")
+    encoded = [len(record)]
+    for first in range(0, len(words), 32):
+        group = words[first:first + 32]
+        encoded.append(sum(1 << i for i, word in enumerate(group) if word))
+        encoded.extend(int(word) for word in group if word)
+    return struct.pack("<{}I".format(len(encoded)), *encoded)
+
+
+class TestRecordingUtilities(unittest.TestCase):
+
+    def test_header_encodings(self):
+        header = get_recording_header_array(
+            [100, 200], encodings=[
+                RECORDING_ENCODINGS.NONE, RECORDING_ENCODINGS.ZERO_WORDS])
+        self.assertEqual(len(header) * 4, get_recording_header_size(2))
+        self.assertEqual(header[-4:], [100, 200, 0, 1])
+        header = get_recording_header_array([100])
+        self.assertEqual(header[-2:], [100, 0])
+
+    def test_decode_zero_words(self):
+        bits = numpy.zeros(40, dtype="<u4")
+        bits[3] = 0x10
+        bits[35] = 0xFFFFFFFF
+        records = [
+            struct.pack("<I", 7) + bits.tobytes(), b"", b"\x01\x00\x02",
+            bytes(bytearray(range(1, 140)))]
+        data = b"".join(_encode(record) for record in records)
+        self.assertLess(len(_encode(records[0])), len(records[0]))
+        decoded = decode_recorded_data(
+            data, RECORDING_ENCODINGS.ZERO_WORDS.value)
+        self.assertEqual(bytes(decoded), b"".join(records))
+
+    def test_decode_none(self):
+        data = b"\x01\x02\x03"
+        self.assertEqual(
+            decode_recorded_data(data, RECORDING_ENCODINGS.NONE.value), data)
+
+    def test_decode_bad(self):
+        encoded = _encode(bytes(bytearray(range(1, 50))))
+        with self.assertRaises(SpinnFrontEndException):
+            decode_recorded_data(
+                encoded[:-4], RECORDING_ENCODINGS.ZERO_WORDS.value)
+        with self.assertRaises(SpinnFrontEndException):
+            decode_recorded_data(encoded, 7)
+
+    def test_channel_state_encoding(self):
+        state = ChannelBufferState.create_from_bytearray(
+            struct.pack("<IIIIIBBBB", 1, 2, 3, 4, 5, 6, 0, 1, 1))
+        self.assertEqual(state.region_id, 6)
+        self.assertEqual(state.encoding, RECORDING_ENCODINGS.ZERO_WORDS.value)
+
+
+if __name__ == "__main__":
+    unittest.main()
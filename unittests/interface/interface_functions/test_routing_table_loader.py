@@ -0,0 +1,83 @@
+# Copyright (c) 2020 The University of Manchester
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+import unittest
+from spinn_machine import MulticastRoutingEntry, virtual_machine
+from pacman.model.routing_tables import (
+    MulticastRoutingTables, UnCompressedMulticastRoutingTable)
+from spinn_front_end_common.interface.interface_functions import (
+    RoutingTableLoader)
+from spinn_front_end_common.interface.interface_functions.\
+    routing_table_loader import remove_default_routes
+
+
+class _MockTransceiver(object):
+
+    def __init__(self):
+        self.loaded = dict()
+
+    def load_multicast_routes(self, x, y, routes, app_id):
+        self.loaded[x, y] = list(routes)
+
+
+class TestRoutingTableLoader(unittest.TestCase):
+
+    def setUp(self):
+        # Keys 0x1000 to 0x100F go straight on along link 0
+        self._straight = MulticastRoutingEntry(
+            0x1000, 0xFFFFFFF0, link_ids=[0], defaultable=True)
+        # Keys 0x10 to 0x1F go straight on along link 1, but are caught
+        # by the entry after them if left to default routing
+        self._caught = MulticastRoutingEntry(
+            0x10, 0xFFFFFFF0, link_ids=[1], defaultable=True)
+        self._catcher = MulticastRoutingEntry(
+            0x0, 0xFFFFFF00, processor_ids=[1])
+        # Keys 0x2000 to 0x200F are caught by the entry after them, but
+        # are sent the same way
+        self._same = MulticastRoutingEntry(
+            0x2000, 0xFFFFFFF0, link_ids=[2], defaultable=True)
+        self._same_catcher = MulticastRoutingEntry(
+            0x2000, 0xFFFFFF00, link_ids=[2])
+
+    def test_remove_default_routes(self):
+        entries = [
+            self._straight, self._caught, self._catcher, self._same,
+            self._same_catcher]
+        self.assertEqual(
+            remove_default_routes(entries),
+            [self._caught, self._catcher, self._same_catcher])
+
+    def test_entry_after_catcher_removed(self):
+        # The catcher comes first, so sees the keys before default routing
+        entries = [self._catcher, self._caught]
+        self.assertEqual(remove_default_routes(entries), [self._catcher])
+
+    def test_call(self):
+        table = UnCompressedMulticastRoutingTable(0, 0)
+        for entry in [self._straight, self._caught, self._catcher]:
+            table.add_multicast_routing_entry(entry)
+        tables = MulticastRoutingTables()
+        tables.add_routing_table(table)
+        transceiver = _MockTransceiver()
+
+        prov_items = RoutingTableLoader()(
+            tables, 30, transceiver, virtual_machine(2, 2))
+        self.assertEqual(
+            transceiver.loaded[0, 0], [self._caught, self._catcher])
+        self.assertEqual([item.value for item in prov_items], [1])
+
+
+if __name__ == '__main__':
+    unittest.main()
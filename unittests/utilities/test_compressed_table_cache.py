@@ -0,0 +1,98 @@
+# Copyright (c) 2020 The University of Manchester
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+import os
+import shutil
+import tempfile
+import unittest
+from spinn_front_end_common.utilities.utility_objs import CompressedTableCache
+
+
+class FakeEntry(object):
+
+    def __init__(self, key, mask, route, defaultable=False):
+        self.routing_entry_key = key
+        self.mask = mask
+        self.spinnaker_route = route
+        self.defaultable = defaultable
+
+
+class FakeTable(object):
+
+    def __init__(self, entries):
+        self.multicast_routing_entries = entries
+
+    @property
+    def number_of_entries(self):
+        return len(self.multicast_routing_entries)
+
+
+class TestCompressedTableCache(unittest.TestCase):
+
+    def setUp(self):
+        self._directory = tempfile.mkdtemp()
+        self._table = FakeTable([
+            FakeEntry(0x0, 0xFFFFFFF0, 0x800),
+            FakeEntry(0x10, 0xFFFFFFF0, 0x1, True)])
+
+    def tearDown(self):
+        shutil.rmtree(self._directory)
+
+    def test_key_depends_on_inputs(self):
+        cache = CompressedTableCache(self._directory)
+        key = cache.key(self._table, 1023, "pair")
+        self.assertEqual(key, cache.key(self._table, 1023, "pair"))
+        self.assertNotEqual(key, cache.key(self._table, 1000, "pair"))
+        self.assertNotEqual(key, cache.key(self._table, 1023, "unordered"))
+        self.assertNotEqual(key, cache.key(self._table, 1023, "pair", b"x"))
+        other = FakeTable(self._table.multicast_routing_entries[:1])
+        self.assertNotEqual(key, cache.key(other, 1023, "pair"))
+
+    def test_put_and_get(self):
+        cache = CompressedTableCache(self._directory)
+        key = cache.key(self._table, 1023, "pair")
+        self.assertIsNone(cache.get(key))
+        entries = [(0x0, 0xFFFFFFE0, 0x801, False)]
+        cache.put(key, entries, 3)
+        self.assertEqual(cache.get(key), (entries, 3))
+
+        # A new cache on the same directory sees the same tables
+        cache = CompressedTableCache(self._directory)
+        self.assertEqual(cache.get(key), (entries, 3))
+
+    def test_damaged_table_ignored(self):
+        cache = CompressedTableCache(self._directory)
+        key = cache.key(self._table, 1023, "pair")
+        cache.put(key, [(0x0, 0xFFFFFFE0, 0x801, False)])
+        path = os.path.join(self._directory, "{}.rt".format(key))
+        with open(path, "r+b") as f:
+            f.truncate(10)
+        self.assertIsNone(cache.get(key))
+
+    def test_algorithm_version(self):
+        path = os.path.join(self._directory, "binary.aplx")
+        with open(path, "wb") as f:
+            f.write(b"one")
+        first = CompressedTableCache.algorithm_version("binary", path)
+        with open(path, "wb") as f:
+            f.write(b"two")
+        self.assertNotEqual(
+            first, CompressedTableCache.algorithm_version("binary", path))
+        self.assertEqual(
+            "binary", CompressedTableCache.algorithm_version("binary"))
+
+
+if __name__ == '__main__':
+    unittest.main()